@@ -0,0 +1,317 @@
+/*---------------------------------------------
+ * Weatherboard adaptive sampling rate
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "adaptive.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+#define SSIZE  256
+
+
+/*---------------------------*/
+/* Per channel adaptive rate */
+/*---------------------------*/
+
+typedef struct {
+	int          enabled;
+	unsigned int fast_period;     // ms
+	double       threshold;       // Units per minute
+	double       window;          // secs
+	int          fast;
+	double       anchor_t;
+	double       anchor_v;
+	double       quiet_since;
+} adaptive_t;
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static adaptive_t    chan_rate[NCHANNELS];
+static int           n_enabled   = 0;
+static double        hold        = ADAPTIVE_DEFAULT_HOLD;
+static double        budget      = 0.0;      // Fast acquisitions/hour (0 unlimited)
+static double        tokens      = 0.0;
+static double        refilled    = (-1.0);
+static unsigned long n_switches  = 0;
+
+
+
+
+/*-----------------------------------------------*/
+/* Parse adaptive rate specification:            */
+/*                                               */
+/*    <chan>[,<chan>...]=<fast secs>:<threshold> */
+/*                                               */
+/* threshold is rate of change per minute        */
+/*-----------------------------------------------*/
+
+int adaptive_parse(const char *spec)
+{
+	int    c,
+	       sel[NCHANNELS];
+	double fast,
+	       threshold;
+	char   tmpstr[SSIZE] = "",
+	       *value        = (char *)NULL,
+	       *tok          = (char *)NULL,
+	       *saveptr      = (char *)NULL;
+
+	(void)strncpy(tmpstr,spec,SSIZE - 1);
+
+	if ((value = strchr(tmpstr,'=')) == (char *)NULL)
+		return(-1);
+
+	*value++ = '\0';
+
+	for (c=0; c<NCHANNELS; ++c)
+		sel[c] = FALSE;
+
+	for (tok = strtok_r(tmpstr,",",&saveptr); tok != (char *)NULL; tok = strtok_r((char *)NULL,",",&saveptr)) {
+		if ((c = channel_lookup(tok)) < 0)
+			return(-1);
+
+		sel[c] = TRUE;
+	}
+
+	if (sscanf(value,"%lf:%lf",&fast,&threshold) != 2 || fast < 0.001 || threshold <= 0.0)
+		return(-1);
+
+	for (c=0; c<NCHANNELS; ++c) {
+		if (sel[c] == TRUE) {
+			if (chan_rate[c].enabled == FALSE)
+				++n_enabled;
+
+			chan_rate[c].enabled     = TRUE;
+			chan_rate[c].fast_period = (unsigned int)(fast * 1000.0 + 0.5);
+			chan_rate[c].threshold   = threshold;
+			chan_rate[c].window      = ADAPTIVE_MIN_WINDOW;
+			chan_rate[c].fast        = FALSE;
+			chan_rate[c].anchor_t    = (-1.0);
+			chan_rate[c].quiet_since = (-1.0);
+		}
+	}
+
+	return(0);
+}
+
+
+
+
+/*------------------------------------------*/
+/* Budget of fast acquisitions per hour (0  */
+/* for no limit)                            */
+/*------------------------------------------*/
+
+int adaptive_set_budget(double per_hour)
+{
+	if (per_hour < 0.0)
+		return(-1);
+
+	budget = per_hour;
+	tokens = per_hour;
+	return(0);
+}
+
+double adaptive_budget(void)
+{
+	return(budget);
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Time channels must be quiet before backing */
+/* off to the base rate                       */
+/*--------------------------------------------*/
+
+int adaptive_set_hold(double secs)
+{
+	if (secs < 0.0)
+		return(-1);
+
+	hold = secs;
+	return(0);
+}
+
+double adaptive_hold(void)
+{
+	return(hold);
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Rate of change window (normally the base   */
+/* period of the channel's sensor)            */
+/*--------------------------------------------*/
+
+void adaptive_set_window(unsigned int chan, double secs)
+{
+	chan_rate[chan].window = secs < ADAPTIVE_MIN_WINDOW ? ADAPTIVE_MIN_WINDOW : secs;
+}
+
+
+
+
+/*---------------------------------------*/
+/* Accessors (fast period is 0 if chan   */
+/* is not adaptive)                      */
+/*---------------------------------------*/
+
+int adaptive_enabled(void)
+{
+	return(n_enabled > 0 ? TRUE : FALSE);
+}
+
+unsigned int adaptive_fast_period(unsigned int chan)
+{
+	return(chan_rate[chan].enabled == TRUE ? chan_rate[chan].fast_period : 0);
+}
+
+double adaptive_threshold(unsigned int chan)
+{
+	return(chan_rate[chan].threshold);
+}
+
+int adaptive_fast(unsigned int chan)
+{
+	return(chan_rate[chan].fast);
+}
+
+unsigned long adaptive_switches(void)
+{
+	return(n_switches);
+}
+
+
+
+
+/*-----------------------------------------*/
+/* Refill budget (token bucket holding at  */
+/* most an hour's budget) up to time t     */
+/*-----------------------------------------*/
+
+static void refill(double t)
+{
+	if (refilled >= 0.0 && t > refilled) {
+		tokens += (t - refilled) * budget / 3600.0;
+
+		if (tokens > budget)
+			tokens = budget;
+	}
+
+	refilled = t;
+}
+
+
+
+
+/*-------------------------------------------*/
+/* Charge one fast acquisition to the budget */
+/*-------------------------------------------*/
+
+void adaptive_charge(double t)
+{
+	if (budget <= 0.0)
+		return;
+
+	refill(t);
+	tokens -= 1.0;
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* New sample v of chan at time t (secs). Returns   */
+/* TRUE if chan should now be sampled at its fast   */
+/* period                                           */
+/*--------------------------------------------------*/
+
+int adaptive_update(unsigned int chan, double t, double v)
+{
+	double     rate,
+	           reserve;
+	int        affordable = TRUE;
+	adaptive_t *a         = &chan_rate[chan];
+
+	if (a->enabled == FALSE || isfinite(v) == 0)
+		return(FALSE);
+
+	/*----------------------------------------------*/
+	/* Budget hysteresis: once exhausted, a reserve */
+	/* must build up before going fast again        */
+	/*----------------------------------------------*/
+
+	if (budget > 0.0) {
+		refill(t);
+
+		reserve    = a->fast == TRUE ? 1.0 : fmax(1.0,budget * ADAPTIVE_RESERVE);
+		affordable = tokens >= reserve ? TRUE : FALSE;
+	}
+
+	if (a->anchor_t < 0.0) {
+		a->anchor_t = t;
+		a->anchor_v = v;
+		return(a->fast);
+	}
+
+
+	/*----------------------------------------------*/
+	/* Change since the anchor, over at least the   */
+	/* window, so a step shows up at once but noise */
+	/* between close samples is not amplified       */
+	/*----------------------------------------------*/
+
+	rate = fabs(v - a->anchor_v) * 60.0 / fmax(t - a->anchor_t,a->window);
+
+	if (t - a->anchor_t >= a->window) {
+		a->anchor_t = t;
+		a->anchor_v = v;
+	}
+
+
+	/*------------*/
+	/* Hysteresis */
+	/*------------*/
+
+	if (a->fast == FALSE) {
+		if (rate > a->threshold && affordable == TRUE) {
+			a->fast        = TRUE;
+			a->quiet_since = (-1.0);
+			++n_switches;
+		}
+	}
+
+	else if (affordable == FALSE) {
+		a->fast = FALSE;
+		++n_switches;
+	}
+
+	else if (rate < a->threshold * ADAPTIVE_HYSTERESIS) {
+		if (a->quiet_since < 0.0)
+			a->quiet_since = t;
+		else if (t - a->quiet_since >= hold) {
+			a->fast = FALSE;
+			++n_switches;
+		}
+	}
+
+	else
+		a->quiet_since = (-1.0);
+
+	return(a->fast);
+}
@@ -0,0 +1,52 @@
+#ifndef __ADAPTIVE_H__
+#define __ADAPTIVE_H__
+
+/*---------------------------------------------
+ * Weatherboard adaptive sampling rate
+ *
+ * A channel switches its sensor to a fast
+ * period while it is changing quickly (rate of
+ * change, per minute, above its threshold) and
+ * back to the base period once it has been
+ * below the threshold times ADAPTIVE_HYSTERESIS
+ * for the hold time. Rate of change is taken
+ * over at least the rate window (the base
+ * period), so sample noise is not amplified
+ * at the fast rate. Fast acquisitions draw on
+ * an (optional) hourly budget; once it is
+ * spent ADAPTIVE_RESERVE of it must refill
+ * before a channel may go fast again.
+ *-------------------------------------------*/
+
+#include "channels.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define ADAPTIVE_HYSTERESIS    0.5
+#define ADAPTIVE_DEFAULT_HOLD  300.0
+#define ADAPTIVE_MIN_WINDOW    10.0
+#define ADAPTIVE_RESERVE       0.1
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int           adaptive_parse      (const char *spec);
+extern int           adaptive_set_budget (double per_hour);
+extern double        adaptive_budget     (void);
+extern int           adaptive_set_hold   (double secs);
+extern double        adaptive_hold       (void);
+extern void          adaptive_set_window (unsigned int chan, double secs);
+extern int           adaptive_enabled    (void);
+extern unsigned int  adaptive_fast_period(unsigned int chan);
+extern double        adaptive_threshold  (unsigned int chan);
+extern int           adaptive_update     (unsigned int chan, double t, double v);
+extern int           adaptive_fast       (unsigned int chan);
+extern void          adaptive_charge     (double t);
+extern unsigned long adaptive_switches   (void);
+
+#endif //__ADAPTIVE_H__
@@ -0,0 +1,874 @@
+/*---------------------------------------------
+ * Weatherboard compressed archive
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "archive.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+
+#define COLUMN_SIZE            (ARCHIVE_MAX_RECORDS*12 + 16)    // Worst case 96 bits a value
+#define NO_WINDOW              64
+
+
+/*----------------------------------*/
+/* Column bit stream being built or */
+/* read                             */
+/*----------------------------------*/
+
+typedef struct {
+	unsigned char *buf;
+	size_t        bits;
+	size_t        limit;                     // Reading: bits in the column
+	int           overrun;
+	uint64_t      prev;                      // Last value (XOR columns)
+	int           lead;                      // Last window (XOR columns)
+	int           trail;
+	long long     prev_v;                    // Last value (Rice columns)
+	long long     prev_t;                    // Time column
+	long long     prev_delta;
+} bitstream_t;
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static uint64_t      pending[COLFMT_NCOLS][ARCHIVE_MAX_RECORDS];   // Block being built (coded values)
+static unsigned char column[COLFMT_NCOLS][COLUMN_SIZE];
+static bitstream_t   stream[COLFMT_NCOLS];
+static unsigned int  n_records = 0;
+static int           block_flags;
+static long long     t_first;
+static long long     t_last;
+static unsigned int  n_blocks  = 0;
+static long long     log_column[COLFMT_NCOLS][COLFMT_MAX_RECORDS];
+static unsigned char log_state[COLFMT_NCOLS][COLFMT_MAX_RECORDS];
+static unsigned char colbuf[COLUMN_SIZE];                   // Column being read
+
+
+
+
+/*----------------------------------------*/
+/* Little endian integers and strings     */
+/*----------------------------------------*/
+
+static unsigned char *put_le(unsigned char *p, uint64_t v, int bytes)
+{
+	int i;
+
+	for (i=0; i<bytes; ++i, v >>= 8)
+		*p++ = (unsigned char)(v & 0xff);
+
+	return(p);
+}
+
+static uint64_t get_le(const unsigned char *p, int bytes)
+{
+	int      i;
+	uint64_t v = 0;
+
+	for (i=bytes-1; i>=0; --i)
+		v = (v << 8) | p[i];
+
+	return(v);
+}
+
+static void put_string(FILE *out, const char *s)
+{
+	size_t len = strlen(s);
+
+	if (len > 255)
+		len = 255;
+
+	(void)fputc((int)len,out);
+	(void)fwrite((const void *)s,1,len,out);
+}
+
+static int get_string(FILE *in, char *s)
+{
+	int len;
+
+	if ((len = fgetc(in)) == EOF || fread((void *)s,1,(size_t)len,in) != (size_t)len)
+		return(-1);
+
+	s[len] = '\0';
+	return(0);
+}
+
+static uint64_t zigzag(long long v)
+{
+	return(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static long long unzigzag(uint64_t v)
+{
+	return((long long)(v >> 1) ^ -(long long)(v & 1));
+}
+
+
+
+
+/*------------------------------------------*/
+/* Bit streams (most significant bit first) */
+/*------------------------------------------*/
+
+static void put_bits(bitstream_t *s, uint64_t v, int n)
+{
+	int room,
+	    take;
+
+	while (n > 0) {
+		room = 8 - (int)(s->bits & 7);
+		take = n < room ? n : room;
+
+		s->buf[s->bits >> 3] |= (unsigned char)(((v >> (n - take)) & ((1U << take) - 1)) << (room - take));
+		s->bits += (size_t)take;
+		n       -= take;
+	}
+}
+
+static uint64_t get_bits(bitstream_t *s, int n)
+{
+	int      room,
+	         take;
+	uint64_t v = 0;
+
+	if (s->bits + (size_t)n > s->limit) {
+		s->overrun = TRUE;
+		return(0);
+	}
+
+	while (n > 0) {
+		room = 8 - (int)(s->bits & 7);
+		take = n < room ? n : room;
+
+		v        = (v << take) | ((s->buf[s->bits >> 3] >> (room - take)) & ((1U << take) - 1));
+		s->bits += (size_t)take;
+		n       -= take;
+	}
+
+	return(v);
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Time: delta of delta (ms), in the smallest */
+/* bucket that holds it                       */
+/*--------------------------------------------*/
+
+static void put_time(bitstream_t *s, long long t)
+{
+	long long delta = t - s->prev_t,
+	          dod   = delta - s->prev_delta;
+
+	s->prev_t     = t;
+	s->prev_delta = delta;
+
+	if (dod == 0)
+		put_bits(s,0,1);
+	else if (dod >= -63 && dod <= 64) {
+		put_bits(s,2,2);
+		put_bits(s,(uint64_t)(dod + 63),7);
+	} else if (dod >= -255 && dod <= 256) {
+		put_bits(s,6,3);
+		put_bits(s,(uint64_t)(dod + 255),9);
+	} else if (dod >= -2047 && dod <= 2048) {
+		put_bits(s,14,4);
+		put_bits(s,(uint64_t)(dod + 2047),12);
+	} else {
+		put_bits(s,15,4);
+		put_bits(s,(uint64_t)dod,64);
+	}
+}
+
+static long long get_time(bitstream_t *s)
+{
+	long long dod;
+
+	if (get_bits(s,1) == 0)
+		dod = 0;
+	else if (get_bits(s,1) == 0)
+		dod = (long long)get_bits(s,7) - 63;
+	else if (get_bits(s,1) == 0)
+		dod = (long long)get_bits(s,9) - 255;
+	else if (get_bits(s,1) == 0)
+		dod = (long long)get_bits(s,12) - 2047;
+	else
+		dod = (long long)get_bits(s,64);
+
+	s->prev_delta += dod;
+	s->prev_t     += s->prev_delta;
+
+	return(s->prev_t);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Value: XOR with the previous one. Its set bits */
+/* are written within the last window (leading    */
+/* and trailing zeros) if they fit, else with a   */
+/* new window                                     */
+/*------------------------------------------------*/
+
+static void put_value(bitstream_t *s, uint64_t v)
+{
+	int      lead,
+	         trail;
+	uint64_t x = v ^ s->prev;
+
+	s->prev = v;
+
+	if (x == 0) {
+		put_bits(s,0,1);
+		return;
+	}
+
+	lead  = __builtin_clzll(x);
+	trail = __builtin_ctzll(x);
+
+	if (s->lead != NO_WINDOW && lead >= s->lead && trail >= s->trail) {
+		put_bits(s,2,2);
+		put_bits(s,x >> s->trail,64 - s->lead - s->trail);
+	} else {
+		put_bits(s,3,2);
+		put_bits(s,(uint64_t)lead,6);
+		put_bits(s,(uint64_t)(64 - lead - trail - 1),6);
+		put_bits(s,x >> trail,64 - lead - trail);
+
+		s->lead  = lead;
+		s->trail = trail;
+	}
+}
+
+static uint64_t get_value(bitstream_t *s)
+{
+	int len;
+
+	if (get_bits(s,1) == 0)
+		return(s->prev);
+
+	if (get_bits(s,1) == 1) {
+		s->lead  = (int)get_bits(s,6);
+		len      = (int)get_bits(s,6) + 1;
+		s->trail = 64 - s->lead - len;
+
+		if (s->trail < 0) {
+			s->overrun = TRUE;
+			return(0);
+		}
+	} else if (s->lead == NO_WINDOW) {
+		s->overrun = TRUE;
+		return(0);
+	}
+
+	s->prev ^= get_bits(s,64 - s->lead - s->trail) << s->trail;
+	return(s->prev);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Start a column bit stream on buf (time columns */
+/* start from t)                                  */
+/*------------------------------------------------*/
+
+static void start_stream(bitstream_t *s, unsigned char *buf, size_t limit, long long t)
+{
+	s->buf        = buf;
+	s->bits       = 0;
+	s->limit      = limit;
+	s->overrun    = FALSE;
+	s->prev       = 0;
+	s->prev_v     = 0;
+	s->lead       = NO_WINDOW;
+	s->trail      = 0;
+	s->prev_t     = t;
+	s->prev_delta = 0;
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Rice coded deltas: zigzag(value - previous) as   */
+/* a unary quotient (>> k) and k remainder bits. A  */
+/* coded value that is missing or -0, or whose      */
+/* quotient would reach ARCHIVE_RICE_ESCAPE, is     */
+/* written whole (escape). Returns the bits it      */
+/* takes (nothing is written if s is NULL)          */
+/*--------------------------------------------------*/
+
+static int escaped(uint64_t v)
+{
+	return(v == ARCHIVE_MISSING || v == ARCHIVE_NEGZERO ? TRUE : FALSE);
+}
+
+static size_t put_rice(bitstream_t *s, const uint64_t *v, unsigned int n, int k)
+{
+	unsigned int i;
+	size_t       bits = 0;
+	long long    prev = 0;
+	uint64_t     d,
+	             q;
+
+	for (i=0; i<n; ++i) {
+		d = zigzag(unzigzag(v[i]) - prev);
+		q = d >> k;
+
+		if (escaped(v[i]) == TRUE || q >= ARCHIVE_RICE_ESCAPE) {
+			bits += ARCHIVE_RICE_ESCAPE + 64;
+
+			if (s != (bitstream_t *)NULL) {
+				put_bits(s,((uint64_t)1 << ARCHIVE_RICE_ESCAPE) - 1,ARCHIVE_RICE_ESCAPE);
+				put_bits(s,v[i],64);
+			}
+		} else {
+			bits += (size_t)q + 1 + (size_t)k;
+
+			if (s != (bitstream_t *)NULL) {
+				put_bits(s,(((uint64_t)1 << q) - 1) << 1,(int)q + 1);
+				put_bits(s,d,k);
+			}
+		}
+
+		prev = escaped(v[i]) == TRUE ? 0 : unzigzag(v[i]);
+	}
+
+	return(bits);
+}
+
+static uint64_t get_rice(bitstream_t *s, int k)
+{
+	uint64_t q = 0;
+
+	while (q < ARCHIVE_RICE_ESCAPE && s->overrun == FALSE && get_bits(s,1) == 1)
+		++q;
+
+	if (q == ARCHIVE_RICE_ESCAPE) {
+		s->prev   = get_bits(s,64);
+		s->prev_v = escaped(s->prev) == TRUE ? 0 : unzigzag(s->prev);
+	} else {
+		s->prev_v += unzigzag((q << k) | get_bits(s,k));
+		s->prev    = zigzag(s->prev_v);
+	}
+
+	return(s->prev);
+}
+
+
+
+
+/*---------------------------------------------------*/
+/* Code value column c of the block being built: as  */
+/* XOR, or as Rice coded deltas (with the best k) if */
+/* that is smaller                                   */
+/*---------------------------------------------------*/
+
+static void put_column(int c)
+{
+	int          k,
+	             best_k = (-1);
+	unsigned int i;
+	size_t       bits,
+	             best   = 0;
+	bitstream_t  *s     = &stream[c];
+
+	start_stream(s,column[c],COLUMN_SIZE*8,0);
+	put_bits(s,ARCHIVE_MODE_XOR,8);
+
+	for (i=0; i<n_records; ++i)
+		put_value(s,pending[c][i]);
+
+	for (k=0; k<=ARCHIVE_RICE_MAX_K; ++k) {
+		if ((bits = put_rice((bitstream_t *)NULL,pending[c],n_records,k) + 8) < s->bits && (best_k < 0 || bits < best)) {
+			best   = bits;
+			best_k = k;
+		}
+	}
+
+	if (best_k >= 0) {
+		(void)memset((void *)column[c],0,(s->bits + 7) / 8);
+
+		start_stream(s,column[c],COLUMN_SIZE*8,0);
+		put_bits(s,(uint64_t)(ARCHIVE_MODE_RICE + best_k),8);
+		(void)put_rice(s,pending[c],n_records,best_k);
+	}
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Write the block being built (if any) to out   */
+/*-----------------------------------------------*/
+
+static void write_block(FILE *out)
+{
+	int           c;
+	unsigned int  i;
+	unsigned char header[ARCHIVE_BLOCK_HEADER],
+	              *p = header;
+
+	if (n_records == 0)
+		return;
+
+	start_stream(&stream[COLFMT_COL_TIME],column[COLFMT_COL_TIME],COLUMN_SIZE*8,t_first);
+	for (i=0; i<n_records; ++i)
+		put_time(&stream[COLFMT_COL_TIME],(long long)pending[COLFMT_COL_TIME][i]);
+
+	for (c=COLFMT_COL_DECISION; c<COLFMT_NCOLS; ++c)
+		put_column(c);
+
+	p    = put_le(p,ARCHIVE_BLOCK_MAGIC,4);
+	p    = put_le(p,n_records,4);
+	*p++ = (unsigned char)block_flags;
+	p    = put_le(p,(uint64_t)t_first,8);
+	p    = put_le(p,(uint64_t)t_last,8);
+
+	for (c=0; c<COLFMT_NCOLS; ++c)
+		p = put_le(p,(stream[c].bits + 7) / 8,4);
+
+	(void)fwrite((const void *)header,1,ARCHIVE_BLOCK_HEADER,out);
+	for (c=0; c<COLFMT_NCOLS; ++c) {
+		(void)fwrite((const void *)column[c],1,(stream[c].bits + 7) / 8,out);
+		(void)memset((void *)column[c],0,(stream[c].bits + 7) / 8);
+	}
+
+	n_records = 0;
+	++n_blocks;
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Add record i of the binary log block just read  */
+/* (flags are its time stamp style) to the archive */
+/* block being built, writing that first if it is  */
+/* full or has another style                       */
+/*-------------------------------------------------*/
+
+static void add_record(FILE *out, unsigned int i, int flags)
+{
+	int       c;
+	long long t = log_column[COLFMT_COL_TIME][i];
+
+	if (n_records == ARCHIVE_MAX_RECORDS || (n_records > 0 && flags != block_flags))
+		write_block(out);
+
+	if (n_records == 0) {
+		block_flags = flags;
+		t_first     = t;
+	}
+
+	pending[COLFMT_COL_TIME][n_records]     = (uint64_t)t;
+	pending[COLFMT_COL_DECISION][n_records] = (uint64_t)(log_column[COLFMT_COL_DECISION][i] + 1);
+
+	for (c=0; c<NCHANNELS; ++c) {
+		if (log_state[COLFMT_COL_CHANNEL(c)][i] == COLFMT_MISSING)
+			pending[COLFMT_COL_CHANNEL(c)][n_records] = ARCHIVE_MISSING;
+		else if (log_state[COLFMT_COL_CHANNEL(c)][i] == COLFMT_NEGZERO)
+			pending[COLFMT_COL_CHANNEL(c)][n_records] = ARCHIVE_NEGZERO;
+		else
+			pending[COLFMT_COL_CHANNEL(c)][n_records] = zigzag(log_column[COLFMT_COL_CHANNEL(c)][i]);
+	}
+
+	t_last = t;
+	++n_records;
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Whether the archive's header matches log's     */
+/* (same station, board, channels and scales)     */
+/*------------------------------------------------*/
+
+static int same_header(const archive_reader_t *r, const colfmt_reader_t *log)
+{
+	int c;
+
+	if (r->board != log->board || r->nchannels != log->nchannels || strcmp(r->station,log->station) != 0)
+		return(FALSE);
+
+	for (c=0; c<NCHANNELS; ++c) {
+		if (strcmp(r->key[c],log->key[c]) != 0 || strcmp(r->unit[c],log->unit[c]) != 0 || r->scale[c] != log->scale[c])
+			return(FALSE);
+	}
+
+	return(TRUE);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Open archive for appending: check its header   */
+/* matches log's, or write one (from log's) if it */
+/* is new. end is set to the time of its last     */
+/* record (-1 if it has none)                     */
+/*------------------------------------------------*/
+
+static FILE *open_archive(const char *archive, const colfmt_reader_t *log, long long *end)
+{
+	int              c,
+	                 status;
+	unsigned char    buf[4];
+	FILE             *out = (FILE *)NULL;
+	archive_reader_t r;
+
+	*end = (-1);
+
+	if (archive_open(&r,archive) == 0) {
+		if (same_header(&r,log) == FALSE) {
+			archive_close(&r);
+			return((FILE *)NULL);
+		}
+
+		while ((status = archive_next(&r)) > 0)
+			*end = r.t_last;
+
+		archive_close(&r);
+
+		if (status < 0)
+			return((FILE *)NULL);
+
+		return(fopen(archive,"ab"));
+	}
+
+	if (access(archive,F_OK) == 0 || errno != ENOENT || (out = fopen(archive,"wb")) == (FILE *)NULL)
+		return((FILE *)NULL);
+
+	(void)fwrite((const void *)ARCHIVE_MAGIC,1,8,out);
+	(void)fwrite((const void *)buf,1,(size_t)(put_le(buf,ARCHIVE_VERSION,2) - buf),out);
+	(void)fputc(log->board,out);
+	(void)fputc(NCHANNELS,out);
+	put_string(out,log->station);
+
+	for (c=0; c<NCHANNELS; ++c) {
+		put_string(out,log->key[c]);
+		put_string(out,log->unit[c]);
+		(void)fwrite((const void *)buf,1,(size_t)(put_le(buf,log->scale[c],4) - buf),out);
+	}
+
+	return(out);
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Compact binary log (plain or gzip) into archive  */
+/* (created if need be). Records no later than the  */
+/* archive's last are skipped, so a log may be      */
+/* compacted again. A log whose header differs     */
+/* from the archive's is refused. Blocks are synced */
+/* before this returns (the log may then be         */
+/* removed); if anything fails the archive is       */
+/* truncated back. Returns the records added or -1  */
+/*--------------------------------------------------*/
+
+long archive_compact(const char *archive, const char *log)
+{
+	int             c,
+	                status;
+	unsigned int    i;
+	long            added = 0,
+	                start;
+	long long       end;
+	FILE            *out  = (FILE *)NULL;
+	colfmt_reader_t r;
+
+	n_blocks  = 0;
+	n_records = 0;
+
+	if (colfmt_open(&r,log) < 0)
+		return(-1);
+
+	if ((out = open_archive(archive,&r,&end)) == (FILE *)NULL) {
+		colfmt_close(&r);
+		return(-1);
+	}
+
+	(void)fseek(out,0L,SEEK_END);
+	start = ftell(out);
+
+	while ((status = colfmt_next(&r)) > 0) {
+		for (c=0; c<COLFMT_NCOLS; ++c) {
+			if (colfmt_column(&r,c,log_column[c],log_state[c]) < 0)
+				break;
+		}
+
+		if (c < COLFMT_NCOLS) {
+			status = (-1);
+			break;
+		}
+
+		for (i=0; i<r.records; ++i) {
+			if (log_column[COLFMT_COL_TIME][i] > end) {
+				add_record(out,i,r.flags);
+				end = log_column[COLFMT_COL_TIME][i];
+				++added;
+			}
+		}
+	}
+
+	write_block(out);
+	colfmt_close(&r);
+
+	if (status < 0 || fflush(out) != 0 || ferror(out) != 0 || fdatasync(fileno(out)) != 0) {
+		(void)ftruncate(fileno(out),(off_t)start);
+		(void)fclose(out);
+		return(-1);
+	}
+
+	(void)fclose(out);
+	return(added);
+}
+
+unsigned int archive_blocks(void)
+{
+	return(n_blocks);
+}
+
+
+
+
+/*-------------------------------------------*/
+/* Reader: open archive path and read its    */
+/* header                                    */
+/*-------------------------------------------*/
+
+int archive_open(archive_reader_t *r, const char *path)
+{
+	int           c;
+	unsigned char buf[8];
+
+	(void)memset((void *)r,0,sizeof(archive_reader_t));
+
+	if ((r->in = fopen(path,"rb")) == (FILE *)NULL)
+		return(-1);
+
+	if (fread((void *)buf,1,8,r->in) != 8 || memcmp(buf,ARCHIVE_MAGIC,8) != 0 ||
+	    fread((void *)buf,1,2,r->in) != 2 || get_le(buf,2) != ARCHIVE_VERSION)
+		goto bad;
+
+	r->board     = fgetc(r->in);
+	r->nchannels = fgetc(r->in);
+
+	if (r->board == EOF || r->nchannels != NCHANNELS || get_string(r->in,r->station) < 0)
+		goto bad;
+
+	for (c=0; c<NCHANNELS; ++c) {
+		if (get_string(r->in,r->key[c]) < 0 || get_string(r->in,r->unit[c]) < 0 || fread((void *)buf,1,4,r->in) != 4)
+			goto bad;
+
+		r->scale[c] = (unsigned int)get_le(buf,4);
+	}
+
+	r->blocks  = ftell(r->in);
+	r->columns = r->blocks;
+	return(0);
+
+bad:
+	(void)fclose(r->in);
+	r->in = (FILE *)NULL;
+	return(-1);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Move on to the next block (reading only its    */
+/* header). Returns 1 if there is a block, 0 at   */
+/* the end of the archive and -1 on error         */
+/*------------------------------------------------*/
+
+int archive_next(archive_reader_t *r)
+{
+	int           c;
+	long          skip = 0;
+	size_t        n;
+	unsigned char header[ARCHIVE_BLOCK_HEADER],
+	              *p   = header + 8;
+
+	for (c=0; r->records > 0 && c<COLFMT_NCOLS; ++c)
+		skip += (long)r->collen[c];
+
+	if (fseek(r->in,r->columns + skip,SEEK_SET) < 0)
+		return(-1);
+
+	r->records = 0;
+
+	if ((n = fread((void *)header,1,ARCHIVE_BLOCK_HEADER,r->in)) < ARCHIVE_BLOCK_HEADER)
+		return(n == 0 ? 0 : (-1));
+
+	if (get_le(header,4) != ARCHIVE_BLOCK_MAGIC)
+		return(-1);
+
+	r->records = (unsigned int)get_le(header + 4,4);
+	r->flags   = *p++;
+	r->t_first = (long long)get_le(p,8);
+	r->t_last  = (long long)get_le(p + 8,8);
+	p         += 16;
+
+	for (c=0; c<COLFMT_NCOLS; ++c, p += 4)
+		r->collen[c] = (unsigned int)get_le(p,4);
+
+	if (r->records == 0 || r->records > ARCHIVE_MAX_RECORDS)
+		return(-1);
+
+	r->columns = ftell(r->in);
+	return(1);
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Position r so that archive_next reads the first  */
+/* block with records at or after time ms. The      */
+/* block index is built (from the block headers) on */
+/* the first seek. Returns 1 if there is such a     */
+/* block, 0 if not and -1 on error                  */
+/*--------------------------------------------------*/
+
+int archive_seek(archive_reader_t *r, long long ms)
+{
+	int          status;
+	unsigned int lo,
+	             hi,
+	             mid,
+	             size = 0;
+
+	if (r->offset == (long *)NULL) {
+		r->columns = r->blocks;
+		r->records = 0;
+
+		while ((status = archive_next(r)) > 0) {
+			if (r->nblocks == size) {
+				size = size == 0 ? 256 : size * 2;
+
+				if ((r->offset = (long *)realloc((void *)r->offset,size * sizeof(long)))           == (long *)NULL ||
+				    (r->last   = (long long *)realloc((void *)r->last,size * sizeof(long long))) == (long long *)NULL)
+					return(-1);
+			}
+
+			r->offset[r->nblocks] = r->columns - ARCHIVE_BLOCK_HEADER;
+			r->last[r->nblocks++] = r->t_last;
+		}
+
+		if (status < 0)
+			return(-1);
+	}
+
+	for (lo=0, hi=r->nblocks; lo < hi; ) {
+		mid = (lo + hi) / 2;
+
+		if (r->last[mid] < ms)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	r->records = 0;
+
+	if (lo == r->nblocks) {
+		(void)fseek(r->in,0L,SEEK_END);
+		r->columns = ftell(r->in);
+		return(0);
+	}
+
+	r->columns = r->offset[lo];
+	return(1);
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Decode column col of the current block into out  */
+/* (times in ms, decisions, or channel values times */
+/* their scale) and state (COLFMT_MISSING, VALUE or */
+/* NEGZERO). Returns the record count or -1         */
+/*--------------------------------------------------*/
+
+int archive_column(archive_reader_t *r, int col, long long *out, unsigned char *state)
+{
+	int          c,
+	             mode = ARCHIVE_MODE_XOR;
+	unsigned int i;
+	long         off  = 0;
+	uint64_t     v;
+	bitstream_t  s;
+
+	if (col < 0 || col >= COLFMT_NCOLS || r->collen[col] > COLUMN_SIZE)
+		return(-1);
+
+	for (c=0; c<col; ++c)
+		off += (long)r->collen[c];
+
+	if (fseek(r->in,r->columns + off,SEEK_SET) < 0 || fread((void *)colbuf,1,r->collen[col],r->in) != r->collen[col])
+		return(-1);
+
+	start_stream(&s,colbuf,(size_t)r->collen[col] * 8,r->t_first);
+
+	if (col != COLFMT_COL_TIME && (mode = (int)get_bits(&s,8)) > ARCHIVE_MODE_RICE + ARCHIVE_RICE_MAX_K)
+		return(-1);
+
+	for (i=0; i<r->records && s.overrun == FALSE; ++i) {
+		state[i] = COLFMT_VALUE;
+
+		if (col == COLFMT_COL_TIME) {
+			out[i] = get_time(&s);
+			continue;
+		}
+
+		v = mode == ARCHIVE_MODE_XOR ? get_value(&s) : get_rice(&s,mode - ARCHIVE_MODE_RICE);
+
+		if (col == COLFMT_COL_DECISION)
+			out[i] = (long long)v - 1;
+		else if (v == ARCHIVE_MISSING) {
+			out[i]   = 0;
+			state[i] = COLFMT_MISSING;
+		} else if (v == ARCHIVE_NEGZERO) {
+			out[i]   = 0;
+			state[i] = COLFMT_NEGZERO;
+		} else
+			out[i] = unzigzag(v);
+	}
+
+	return(s.overrun == FALSE ? (int)r->records : (-1));
+}
+
+void archive_close(archive_reader_t *r)
+{
+	if (r->in != (FILE *)NULL)
+		(void)fclose(r->in);
+
+	(void)free((void *)r->offset);
+	(void)free((void *)r->last);
+
+	r->in     = (FILE *)NULL;
+	r->offset = (long *)NULL;
+	r->last   = (long long *)NULL;
+}
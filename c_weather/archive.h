@@ -0,0 +1,119 @@
+#ifndef __ARCHIVE_H__
+#define __ARCHIVE_H__
+
+/*---------------------------------------------
+ * Weatherboard compressed archive
+ *
+ * Long-term store for binary logs (Gorilla
+ * style). The file header is the binary log's
+ * (station, board, channel keys, units and
+ * scales); blocks of up to ARCHIVE_MAX_RECORDS
+ * records follow, appended as logs are
+ * compacted. A block header gives the record
+ * count, time stamp style, first and last
+ * record times (ms since the epoch) and the
+ * byte length of each column. Each column is a
+ * bit stream (most significant bit first):
+ *
+ *    time      delta of delta (ms):
+ *                 0                  '0'
+ *                 [-63,64]           '10'   + 7
+ *                 [-255,256]         '110'  + 9
+ *                 [-2047,2048]       '1110' + 12
+ *                 otherwise          '1111' + 64
+ *    decision  decision + 1, and
+ *    channel   zigzag(value * scale), after
+ *              a mode byte: 0 for XOR with
+ *              the previous value (Gorilla)
+ *                 same value         '0'
+ *                 within last window '10'   + bits
+ *                 new window         '11'   + 6
+ *                                    (leading
+ *                                    zeros) + 6
+ *                                    (bits - 1)
+ *                                    + bits
+ *              or 1 + k for Rice coded
+ *              deltas: zigzag(value -
+ *              previous) >> k in unary,
+ *              then its low k bits (a
+ *              missing or -0 value, or a
+ *              quotient of ARCHIVE_RICE_ESCAPE
+ *              or more, is escaped: that many
+ *              1 bits, then the value whole)
+ *
+ * The writer picks whichever mode is smaller
+ * for each column of each block: XOR when
+ * values repeat or step, Rice deltas for the
+ * sample noise of most channels. Values are
+ * fixed-point integers, not floats: logged
+ * values are already rounded to the scale,
+ * and the float bit patterns of decimal
+ * fractions differ in every low bit. Blocks
+ * decode on their own, and the reader finds
+ * the block holding a given time from the
+ * block headers alone.
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include "colfmt.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define ARCHIVE_MAGIC          "WBARC\r\n\032"   // 8 bytes (with the NUL)
+#define ARCHIVE_BLOCK_MAGIC    0x4b415257UL      // "WRAK"
+#define ARCHIVE_VERSION        1
+#define ARCHIVE_MAX_RECORDS    4096              // Per block
+#define ARCHIVE_BLOCK_HEADER   (4 + 4 + 1 + 8 + 8 + 4*COLFMT_NCOLS)
+#define ARCHIVE_MISSING        UINT64_MAX        // Coded channel values
+#define ARCHIVE_NEGZERO        (UINT64_MAX - 1)
+#define ARCHIVE_MODE_XOR       0                 // Column modes
+#define ARCHIVE_MODE_RICE      1                 // + k
+#define ARCHIVE_RICE_MAX_K     40
+#define ARCHIVE_RICE_ESCAPE    32
+
+
+/*--------------------------------------*/
+/* Reader: file header, the current     */
+/* block's header and (once a seek has  */
+/* needed it) the block index           */
+/*--------------------------------------*/
+
+typedef struct {
+	FILE         *in;
+	int          board;
+	int          nchannels;
+	char         station[COLFMT_SSIZE];
+	char         key[NCHANNELS][COLFMT_SSIZE];
+	char         unit[NCHANNELS][COLFMT_SSIZE];
+	unsigned int scale[NCHANNELS];
+	unsigned int records;                      // Current block
+	int          flags;
+	long long    t_first;
+	long long    t_last;
+	unsigned int collen[COLFMT_NCOLS];
+	long         columns;                      // File offset of its first column
+	long         blocks;                       // File offset of the first block
+	long         *offset;                      // Block index (offset and last time)
+	long long    *last;
+	unsigned int nblocks;
+} archive_reader_t;
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern long         archive_compact (const char *archive, const char *log);
+extern unsigned int archive_blocks  (void);
+
+extern int          archive_open    (archive_reader_t *r, const char *path);
+extern int          archive_next    (archive_reader_t *r);
+extern int          archive_seek    (archive_reader_t *r, long long ms);
+extern int          archive_column  (archive_reader_t *r, int col, long long *out, unsigned char *state);
+extern void         archive_close   (archive_reader_t *r);
+
+#endif //__ARCHIVE_H__
@@ -13,7 +13,7 @@
 /* Global variables */
 /*------------------*/
 
-int    bme280Fd;
+int    bme280Fd = (-1);
 struct bme280_t bme280;
 
 
@@ -21,10 +21,68 @@ struct bme280_t bme280;
 /* Functions */
 /*-----------*/
 
-s32 bme280_begin(const char *device)
+/*-----------------------------------------------*/
+/* Poll register reg (every BME280_POLL_USECS)   */
+/* until (value & mask) == want. Returns -1 on   */
+/* timeout                                       */
+/*-----------------------------------------------*/
+
+static int poll_register(u8 reg, u8 mask, u8 want, long timeout)
 {
-	int status   = 0;
-	s32 com_rslt = 0;
+	u8   value  = 0;
+	long waited = 0;
+
+	while (1) {
+		if (bme280_read_register(reg, &value, 1) == 0 && (value & mask) == want)
+			return(0);
+
+		if (waited >= timeout)
+			return(-1);
+
+		(void)usleep(BME280_POLL_USECS);
+		waited += BME280_POLL_USECS;
+	}
+}
+
+
+/*-----------------------------------------------*/
+/* Poll until the first conversion has completed */
+/* (reset value 0x80000 replaced, not measuring) */
+/*-----------------------------------------------*/
+
+static int wait_conversion(long timeout)
+{
+	s32  raw    = 0;
+	long waited = 0;
+
+	while (1) {
+		if (bme280_read_uncomp_temperature(&raw) == 0 && raw != 0x80000 &&
+		    poll_register(BME280_STAT_REG, BME280_STAT_REG_MEASURING__MSK, 0, 0) == 0)
+			return(0);
+
+		if (waited >= timeout)
+			return(-1);
+
+		(void)usleep(BME280_POLL_USECS);
+		waited += BME280_POLL_USECS;
+	}
+}
+
+
+/*-----------------------------------------------*/
+/* Probe for a BME280 (V2 board): open the bus   */
+/* and check the chip id. The bus stays open for */
+/* bme280_begin                                  */
+/*-----------------------------------------------*/
+
+s32 bme280_probe(const char *device)
+{
+	int status = 0;
+	u8  wbuf   = BME280_CHIP_ID_REG,
+	    id     = 0;
+
+	if (bme280Fd >= 0)
+		return(0);
 
 	bme280Fd = open(device, O_RDWR);
 	if (bme280Fd < 0) {
@@ -40,24 +98,69 @@ s32 bme280_begin(const char *device)
 		(void)fflush(stderr);
 
 		(void)close(bme280Fd);
+		bme280Fd = (-1);
+		return (-1);
+	}
+
+	if (write(bme280Fd, &wbuf, 1) != 1 || read(bme280Fd, &id, 1) != 1 || id != 0x60) {
+		(void)close(bme280Fd);
+		bme280Fd = (-1);
 		return (-1);
 	}
 
+	return(0);
+}
+
+
+/*-----------------------------------------------*/
+/* Initialise the BME280. A soft reset puts it   */
+/* in sleep mode (with reset data registers) so  */
+/* oversampling is set without the driver's per  */
+/* setting resets. Then wait for the NVM copy    */
+/* and for the first conversion (no blind waits) */
+/*-----------------------------------------------*/
+
+s32 bme280_begin(const char *device)
+{
+	s32 com_rslt = 0;
+
+	if (bme280_probe(device) < 0)
+		return(-1);
+
 	I2C_routine();
 	if (bme280_init(&bme280) < 0) {
 		return(-1);
 	}
 
-	com_rslt += bme280_set_power_mode(BME280_NORMAL_MODE);
+	com_rslt += bme280_set_soft_rst();
+	if (poll_register(BME280_STAT_REG, BME280_STAT_REG_IM_UPDATE__MSK, 0, BME280_READY_TIMEOUT) < 0)
+		return(-1);
+
 	com_rslt += bme280_set_oversamp_humidity(BME280_OVERSAMP_2X);
 	com_rslt += bme280_set_oversamp_pressure(BME280_OVERSAMP_2X);
 	com_rslt += bme280_set_oversamp_temperature(BME280_OVERSAMP_2X);
+	com_rslt += bme280_set_power_mode(BME280_NORMAL_MODE);
+
+	if (wait_conversion(BME280_READY_TIMEOUT) < 0)
+		return(-1);
 
-	(void)usleep(100000);
 	return(com_rslt);
 }
 
 
+/*-----------------------------------------------*/
+/* Close the bus (so a re-probe starts afresh)   */
+/*-----------------------------------------------*/
+
+void bme280_end(void)
+{
+	if (bme280Fd >= 0)
+		(void)close(bme280Fd);
+
+	bme280Fd = (-1);
+}
+
+
 float bme280_readAltitude(int pressure, float seaLevel)
 {
 	float atmospheric = (float)pressure/100.0;
@@ -75,7 +178,9 @@ s8 BME280_I2C_bus_write(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
 	for (stringpos = BME280_INIT_VALUE; stringpos < cnt; stringpos++) {
 		wbuf[1] = *(reg_data + stringpos);
 		wbuf[0] = reg_addr + stringpos;
-		(void)write(bme280Fd, wbuf, 2);
+
+		if (write(bme280Fd, wbuf, 2) != 2)
+			iError = -1;
 	}
 
 	return ((s8)iError);
@@ -92,10 +197,8 @@ s8 BME280_I2C_bus_read(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
 
 	for (stringpos = BME280_INIT_VALUE; stringpos < cnt; stringpos++) {
 		rbuf[0] = reg_addr + stringpos;
-		(void)write(bme280Fd, rbuf, 1);
-		(void)read(bme280Fd, rbuf, 1);
 
-		if (rbuf[0] < 0)
+		if (write(bme280Fd, rbuf, 1) != 1 || read(bme280Fd, rbuf, 1) != 1)
 		   iError = -1;
 		else
 	           *(reg_data + stringpos) = rbuf[0];
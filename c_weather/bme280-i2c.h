@@ -3,11 +3,21 @@
 #include "bme280.h"
 
 
+/*-------------------------------------------*/
+/* Readiness polling (interval and timeout)  */
+/*-------------------------------------------*/
+
+#define BME280_POLL_USECS      500
+#define BME280_READY_TIMEOUT   100000
+
+
 /*---------------------*/
 /* Function prototypes */
 /*---------------------*/
 
+s32 bme280_probe          (const char *device);
 s32 bme280_begin          (const char *device);
+void bme280_end           (void);
 float bme280_readAltitude (int pressure, float seaLevel);
 
 s8 I2C_routine            (void);
@@ -21,7 +21,7 @@ extern int     do_verbose;
 /* Global variables */
 /*------------------*/
 
-int   bmp180Fd;
+int   bmp180Fd = (-1);
 
 short ac1,
       ac2,
@@ -39,6 +39,13 @@ unsigned short ac4,
 unsigned char oversampling;
 
 
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static int io_errors = 0;          // Failed transfers since last BMP180_failed()
+
+
 /*-----------*/
 /* Functions */
 /*-----------*/
@@ -47,6 +54,10 @@ int bmp180_begin(const char *device)
 {
 	int status = 0;
 
+	// re-probe: drop the old session
+	if (bmp180Fd >= 0)
+		(void)close(bmp180Fd);
+
 	bmp180Fd = open(device, O_RDWR);
 	if (bmp180Fd < 0) {
 
@@ -55,7 +66,7 @@ int bmp180_begin(const char *device)
 			(void)fflush(stderr);
 		}
 
-		exit(-1);
+		return(-1);
 	}
 
 	status = ioctl(bmp180Fd, I2C_SLAVE, BMP180_ADDRESS);
@@ -66,7 +77,8 @@ int bmp180_begin(const char *device)
 		}
 
 		(void)close(bmp180Fd);
-		exit(-1);
+		bmp180Fd = (-1);
+		return(-1);
 	}
 
 	if (BMP180_I2C_read8(BMP180_CHIPID) != 0x55) {
@@ -76,9 +88,24 @@ int bmp180_begin(const char *device)
 			(void)fflush(stderr);
 		}
 
-		exit(-1);
+		(void)close(bmp180Fd);
+		bmp180Fd = (-1);
+		return(-1);
 	}
+
+	io_errors = 0;
 	readCoefficients();
+
+	return(BMP180_failed() == TRUE ? -1 : 0);
+}
+
+// TRUE if any transfer failed since the last call
+int BMP180_failed(void)
+{
+	int failed = io_errors > 0 ? TRUE : FALSE;
+
+	io_errors = 0;
+	return(failed);
 }
 
 void BMP180_I2C_writeCommand(unsigned char reg, unsigned char value)
@@ -88,13 +115,16 @@ void BMP180_I2C_writeCommand(unsigned char reg, unsigned char value)
 	wbuf[0] = reg;
 	wbuf[1] = value;
 
-	(void)write(bmp180Fd, wbuf, 2);
+	if (write(bmp180Fd, wbuf, 2) != 2)
+		++io_errors;
 }
 
 unsigned char BMP180_I2C_read8(unsigned char reg)
 {
-	(void)write(bmp180Fd, &reg, 1);
-	(void)read(bmp180Fd, &reg, 1);
+	if (write(bmp180Fd, &reg, 1) != 1 || read(bmp180Fd, &reg, 1) != 1) {
+		++io_errors;
+		reg = 0;
+	}
 
 	return reg;
 }
@@ -103,8 +133,8 @@ unsigned short BMP180_I2C_read16(unsigned char reg)
 {
 	unsigned char rbuf[2] = "";
 
-	(void)write(bmp180Fd, &reg, 1);
-	(void)read(bmp180Fd, rbuf, 2);
+	if (write(bmp180Fd, &reg, 1) != 1 || read(bmp180Fd, rbuf, 2) != 2)
+		++io_errors;
 
 	return (unsigned short)(rbuf[0] << 8 | rbuf[1]);
 }
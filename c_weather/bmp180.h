@@ -58,6 +58,7 @@ extern unsigned char oversampling;
 /*--------------------*/
 
 extern int            bmp180_begin(const char *device);
+extern int            BMP180_failed(void);
 extern void           BMP180_I2C_writeCommand(unsigned char reg, unsigned char value);
 extern unsigned char  BMP180_I2C_read8(unsigned char reg);
 extern unsigned short BMP180_I2C_read16(unsigned char reg);
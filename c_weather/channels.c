@@ -0,0 +1,51 @@
+/*---------------------------------------------
+ * Weatherboard data channels
+ *-------------------------------------------*/
+
+#include <string.h>
+#include "channels.h"
+
+
+/*-----------------------------------------*/
+/* Channel names (as used in the log line) */
+/*-----------------------------------------*/
+
+const char *const channel_name[NCHANNELS] = { "uvi",
+                                              "vis",
+                                              "ir",
+                                              "temp",
+                                              "humidity",
+                                              "dew point",
+                                              "pressure" };
+
+
+/*--------------------------------------------*/
+/* Channel keys (as used on the command line) */
+/*--------------------------------------------*/
+
+const char *const channel_key[NCHANNELS]  = { "uvi",
+                                              "vis",
+                                              "ir",
+                                              "temp",
+                                              "humidity",
+                                              "dewpoint",
+                                              "pressure" };
+
+
+
+
+/*------------------------------------------------*/
+/* Get channel index from key (-1 if no such key) */
+/*------------------------------------------------*/
+
+int channel_lookup(const char *key)
+{
+	int c;
+
+	for (c=0; c<NCHANNELS; ++c) {
+		if (strcmp(key,channel_key[c]) == 0)
+			return(c);
+	}
+
+	return(-1);
+}
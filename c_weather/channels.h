@@ -0,0 +1,34 @@
+#ifndef __CHANNELS_H__
+#define __CHANNELS_H__
+
+/*---------------------------------------------
+ * Weatherboard data channels
+ * (indices shared by the processing stages)
+ *-------------------------------------------*/
+
+
+/*-----------------*/
+/* Channel indices */
+/*-----------------*/
+
+#define CHAN_UVI               0
+#define CHAN_VIS               1
+#define CHAN_IR                2
+#define CHAN_TEMPERATURE       3
+#define CHAN_HUMIDITY          4
+#define CHAN_DEW_POINT         5
+#define CHAN_PRESSURE          6
+
+#define NCHANNELS              7
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern const char *const channel_name[NCHANNELS];
+extern const char *const channel_key[NCHANNELS];
+
+extern int               channel_lookup(const char *key);
+
+#endif //__CHANNELS_H__
@@ -0,0 +1,398 @@
+/*---------------------------------------------
+ * Weatherboard binary columnar log format
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <zlib.h>
+#include "colfmt.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+
+#define COLUMN_SIZE            (COLFMT_MAX_RECORDS*COLFMT_VARINT_MAX)
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static const char *const channel_unit[NCHANNELS] = { "", "lux", "lux", "C", "%", "C", "hpa" };
+
+static unsigned char column[COLFMT_NCOLS][COLUMN_SIZE];     // Block being built
+static unsigned int  collen[COLFMT_NCOLS];
+static unsigned int  n_records = 0;
+static long long     t0        = 0;
+static long long     last_t    = 0;
+static long long     last_v[NCHANNELS];
+static unsigned char colbuf[COLUMN_SIZE];                   // Column being read
+
+
+
+
+/*----------------------------------------*/
+/* Little endian integers and varints     */
+/*----------------------------------------*/
+
+static unsigned char *put_le(unsigned char *p, uint64_t v, int bytes)
+{
+	int i;
+
+	for (i=0; i<bytes; ++i, v >>= 8)
+		*p++ = (unsigned char)(v & 0xff);
+
+	return(p);
+}
+
+static uint64_t get_le(const unsigned char *p, int bytes)
+{
+	int      i;
+	uint64_t v = 0;
+
+	for (i=bytes-1; i>=0; --i)
+		v = (v << 8) | p[i];
+
+	return(v);
+}
+
+static void put_varint(unsigned int col, uint64_t v)
+{
+	unsigned char *p = &column[col][collen[col]];
+
+	while (v >= 0x80) {
+		*p++ = (unsigned char)(v | 0x80);
+		v  >>= 7;
+	}
+
+	*p++         = (unsigned char)v;
+	collen[col]  = (unsigned int)(p - column[col]);
+}
+
+static uint64_t zigzag(long long v)
+{
+	return(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static long long unzigzag(uint64_t v)
+{
+	return((long long)(v >> 1) ^ -(long long)(v & 1));
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Write the file header: station, board and  */
+/* the channels (key, unit, scale)            */
+/*--------------------------------------------*/
+
+static void put_string(FILE *stream, const char *s)
+{
+	size_t len = strlen(s);
+
+	if (len > 255)
+		len = 255;
+
+	(void)fputc((int)len,stream);
+	(void)fwrite((const void *)s,1,len,stream);
+}
+
+int colfmt_header(FILE *stream, const char *station, int board)
+{
+	int           c;
+	unsigned char buf[8];
+
+	(void)fwrite((const void *)COLFMT_MAGIC,1,8,stream);
+	(void)fwrite((const void *)buf,1,(size_t)(put_le(buf,COLFMT_VERSION,2) - buf),stream);
+	(void)fputc(board,stream);
+	(void)fputc(NCHANNELS,stream);
+	put_string(stream,station);
+
+	for (c=0; c<NCHANNELS; ++c) {
+		put_string(stream,channel_key[c]);
+		put_string(stream,channel_unit[c]);
+		(void)fwrite((const void *)buf,1,(size_t)(put_le(buf,COLFMT_SCALE,4) - buf),stream);
+	}
+
+	n_records = 0;
+	return(ferror(stream) != 0 ? (-1) : 0);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Add a record (time ms, deadband decision and a  */
+/* value per channel) to the block being built.    */
+/* Returns -1 if the block is full                 */
+/*-------------------------------------------------*/
+
+int colfmt_add(long long ms, int decision, const float *value)
+{
+	int       c;
+	long long v;
+
+	if (n_records == COLFMT_MAX_RECORDS)
+		return(-1);
+
+	if (n_records == 0) {
+		for (c=0; c<COLFMT_NCOLS; ++c)
+			collen[c] = 0;
+		for (c=0; c<NCHANNELS; ++c)
+			last_v[c] = 0;
+
+		t0 = last_t = ms;
+	}
+
+	put_varint(COLFMT_COL_TIME,zigzag(ms - last_t));
+	put_varint(COLFMT_COL_DECISION,(uint64_t)(decision + 1));
+	last_t = ms;
+
+	for (c=0; c<NCHANNELS; ++c) {
+		if (isfinite(value[c]) == 0 || fabs((double)value[c]) * COLFMT_SCALE > 9.0e15)
+			put_varint(COLFMT_COL_CHANNEL(c),0);
+		else if ((v = (long long)rint((double)value[c] * COLFMT_SCALE)) == 0 && signbit(value[c]) != 0) {
+			put_varint(COLFMT_COL_CHANNEL(c),1);
+			last_v[c] = 0;
+		} else {
+			put_varint(COLFMT_COL_CHANNEL(c),zigzag(v - last_v[c]) + 2);
+			last_v[c] = v;
+		}
+	}
+
+	++n_records;
+	return(0);
+}
+
+unsigned int colfmt_pending(void)
+{
+	return(n_records);
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Bytes the pending block will take (0 if it  */
+/* is empty)                                   */
+/*---------------------------------------------*/
+
+size_t colfmt_size(void)
+{
+	int    c;
+	size_t size = COLFMT_BLOCK_HEADER;
+
+	if (n_records == 0)
+		return(0);
+
+	for (c=0; c<COLFMT_NCOLS; ++c)
+		size += collen[c];
+
+	return(size);
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Write the pending block (if any) with flags   */
+/* (COLFMT_MSECS, time stamp style) and start a  */
+/* new one                                       */
+/*-----------------------------------------------*/
+
+int colfmt_block(FILE *stream, int flags)
+{
+	int           c;
+	unsigned char header[COLFMT_BLOCK_HEADER],
+	              *p = header;
+
+	if (n_records == 0)
+		return(0);
+
+	p  = put_le(p,COLFMT_BLOCK_MAGIC,4);
+	p  = put_le(p,n_records,4);
+	*p++ = (unsigned char)flags;
+	p  = put_le(p,(uint64_t)t0,8);
+
+	for (c=0; c<COLFMT_NCOLS; ++c)
+		p = put_le(p,collen[c],4);
+
+	(void)fwrite((const void *)header,1,COLFMT_BLOCK_HEADER,stream);
+	for (c=0; c<COLFMT_NCOLS; ++c)
+		(void)fwrite((const void *)column[c],1,collen[c],stream);
+
+	n_records = 0;
+	return(ferror(stream) != 0 ? (-1) : 0);
+}
+
+
+
+
+/*-------------------------------------------*/
+/* Reader: open path (plain or gzip, as the  */
+/* live log may be) and read its header      */
+/*-------------------------------------------*/
+
+static int get_string(gzFile in, char *s)
+{
+	int len;
+
+	if ((len = gzgetc(in)) < 0 || gzread(in,s,(unsigned int)len) != len)
+		return(-1);
+
+	s[len] = '\0';
+	return(0);
+}
+
+int colfmt_open(colfmt_reader_t *r, const char *path)
+{
+	int           c;
+	unsigned char buf[8];
+
+	(void)memset((void *)r,0,sizeof(colfmt_reader_t));
+
+	if ((r->in = gzopen(path,"rb")) == (gzFile)NULL)
+		return(-1);
+
+	if (gzread(r->in,buf,8) != 8 || memcmp(buf,COLFMT_MAGIC,8) != 0 ||
+	    gzread(r->in,buf,2) != 2 || get_le(buf,2) != COLFMT_VERSION)
+		goto bad;
+
+	r->board     = gzgetc(r->in);
+	r->nchannels = gzgetc(r->in);
+
+	if (r->board < 0 || r->nchannels != NCHANNELS || get_string(r->in,r->station) < 0)
+		goto bad;
+
+	for (c=0; c<NCHANNELS; ++c) {
+		if (get_string(r->in,r->key[c]) < 0 || get_string(r->in,r->unit[c]) < 0 || gzread(r->in,buf,4) != 4)
+			goto bad;
+
+		r->scale[c] = (unsigned int)get_le(buf,4);
+	}
+
+	r->columns = gztell(r->in);
+	return(0);
+
+bad:
+	(void)gzclose(r->in);
+	r->in = (gzFile)NULL;
+	return(-1);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Move on to the next block, skipping whatever   */
+/* is left of this one. Returns 1 if there is a   */
+/* block, 0 at the end of the file (or of what    */
+/* has been written so far) and -1 on error       */
+/*------------------------------------------------*/
+
+int colfmt_next(colfmt_reader_t *r)
+{
+	int           c,
+	              n;
+	z_off_t       skip = 0;
+	unsigned char header[COLFMT_BLOCK_HEADER],
+	              *p   = header + 8;
+
+	if (r->records > 0) {
+		for (c=0; c<COLFMT_NCOLS; ++c)
+			skip += (z_off_t)r->collen[c];
+
+		if (gzseek(r->in,r->columns + skip,SEEK_SET) < 0)
+			return(-1);
+	}
+
+	if ((n = gzread(r->in,header,COLFMT_BLOCK_HEADER)) < COLFMT_BLOCK_HEADER)
+		return(n < 0 ? (-1) : 0);
+
+	if (get_le(header,4) != COLFMT_BLOCK_MAGIC)
+		return(-1);
+
+	r->records = (unsigned int)get_le(header + 4,4);
+	r->flags   = *p++;
+	r->t0      = (long long)get_le(p,8);
+	p         += 8;
+
+	for (c=0; c<COLFMT_NCOLS; ++c, p += 4)
+		r->collen[c] = (unsigned int)get_le(p,4);
+
+	if (r->records == 0 || r->records > COLFMT_MAX_RECORDS)
+		return(-1);
+
+	r->columns = gztell(r->in);
+	return(1);
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Decode column col of the current block into out  */
+/* (times in ms, decisions, or channel values times */
+/* their scale) and state (COLFMT_MISSING, VALUE or */
+/* NEGZERO). Returns the record count or -1         */
+/*--------------------------------------------------*/
+
+int colfmt_column(colfmt_reader_t *r, int col, long long *out, unsigned char *state)
+{
+	int          c;
+	unsigned int i,
+	             pos  = 0,
+	             shift;
+	z_off_t      off  = 0;
+	uint64_t     v;
+	long long    last = col == COLFMT_COL_TIME ? r->t0 : 0;
+
+	if (col < 0 || col >= COLFMT_NCOLS || r->collen[col] > COLUMN_SIZE)
+		return(-1);
+
+	for (c=0; c<col; ++c)
+		off += (z_off_t)r->collen[c];
+
+	if (gzseek(r->in,r->columns + off,SEEK_SET) < 0 || gzread(r->in,colbuf,r->collen[col]) != (int)r->collen[col])
+		return(-1);
+
+	for (i=0; i<r->records; ++i) {
+		for (v=0, shift=0; pos < r->collen[col]; shift += 7) {
+			v |= (uint64_t)(colbuf[pos] & 0x7f) << shift;
+			if ((colbuf[pos++] & 0x80) == 0)
+				break;
+		}
+
+		state[i] = COLFMT_VALUE;
+
+		if (col == COLFMT_COL_DECISION)
+			out[i] = (long long)v - 1;
+		else if (col == COLFMT_COL_TIME)
+			out[i] = last = last + unzigzag(v);
+		else if (v == 0) {
+			out[i]   = 0;
+			state[i] = COLFMT_MISSING;
+		} else if (v == 1) {
+			out[i]   = last = 0;
+			state[i] = COLFMT_NEGZERO;
+		} else
+			out[i] = last = last + unzigzag(v - 2);
+	}
+
+	return((int)r->records);
+}
+
+void colfmt_close(colfmt_reader_t *r)
+{
+	if (r->in != (gzFile)NULL)
+		(void)gzclose(r->in);
+
+	r->in = (gzFile)NULL;
+}
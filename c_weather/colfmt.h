@@ -0,0 +1,94 @@
+#ifndef __COLFMT_H__
+#define __COLFMT_H__
+
+/*---------------------------------------------
+ * Weatherboard binary columnar log format
+ *
+ * A file header (station, board, and for each
+ * channel its key, unit and scale) is followed
+ * by self-contained blocks of records. A block
+ * header gives the record count, time stamp
+ * style, the first record's time (ms since the
+ * epoch) and the byte length of each column;
+ * columns follow, one after another:
+ *
+ *    time      ms since the previous record
+ *              (zigzag, so it may step back)
+ *    decision  deadband decision + 1
+ *    channel   value * scale, less the previous
+ *              value (0 for a missing value,
+ *              1 for one that rounds to -0,
+ *              else zigzag delta + 2)
+ *
+ * each entry an unsigned LEB128 varint. Values
+ * start from 0 in each block, so any block (and
+ * any column in it) decodes on its own: a
+ * reader skips the columns it does not want.
+ * Integers in the headers are little endian.
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <zlib.h>
+#include "channels.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define COLFMT_MAGIC           "WBCOL\r\n\032"   // 8 bytes (with the NUL)
+#define COLFMT_BLOCK_MAGIC     0x4b424257UL      // "WBBK"
+#define COLFMT_VERSION         1
+#define COLFMT_SCALE           100               // 0.01 resolution, as the text log
+#define COLFMT_MAX_RECORDS     1024              // Per block
+#define COLFMT_VARINT_MAX      10
+#define COLFMT_COL_TIME        0
+#define COLFMT_COL_DECISION    1
+#define COLFMT_COL_CHANNEL(c)  (2 + (c))
+#define COLFMT_NCOLS           (2 + NCHANNELS)
+#define COLFMT_BLOCK_HEADER    (4 + 4 + 1 + 8 + 4*COLFMT_NCOLS)
+#define COLFMT_MSECS           0x01              // Block flags: time stamps show ms
+#define COLFMT_STYLE_SHIFT     1                 // Time stamp style (tstamp format)
+#define COLFMT_SSIZE           256
+#define COLFMT_MISSING         0                 // Decoded value states
+#define COLFMT_VALUE           1
+#define COLFMT_NEGZERO         2                 // 0, shown as -0.00
+
+
+/*--------------------------------------*/
+/* Reader: file header and the current  */
+/* block's header                       */
+/*--------------------------------------*/
+
+typedef struct {
+	gzFile       in;
+	int          board;
+	int          nchannels;
+	char         station[COLFMT_SSIZE];
+	char         key[NCHANNELS][COLFMT_SSIZE];
+	char         unit[NCHANNELS][COLFMT_SSIZE];
+	unsigned int scale[NCHANNELS];
+	unsigned int records;                      // Current block
+	int          flags;
+	long long    t0;
+	unsigned int collen[COLFMT_NCOLS];
+	z_off_t      columns;                      // File offset of its first column
+} colfmt_reader_t;
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int          colfmt_header (FILE *stream, const char *station, int board);
+extern int          colfmt_add    (long long ms, int decision, const float *value);
+extern unsigned int colfmt_pending(void);
+extern size_t       colfmt_size   (void);
+extern int          colfmt_block  (FILE *stream, int flags);
+
+extern int          colfmt_open   (colfmt_reader_t *r, const char *path);
+extern int          colfmt_next   (colfmt_reader_t *r);
+extern int          colfmt_column (colfmt_reader_t *r, int col, long long *out, unsigned char *state);
+extern void         colfmt_close  (colfmt_reader_t *r);
+
+#endif //__COLFMT_H__
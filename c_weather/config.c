@@ -0,0 +1,147 @@
+/*---------------------------------------------
+ * Weatherboard configuration file
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "config.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define SSIZE  256
+
+
+
+
+/*-------------------------------------*/
+/* Strip leading and trailing space    */
+/*-------------------------------------*/
+
+static char *strip(char *str)
+{
+	size_t len;
+
+	while (isspace((unsigned char)*str) != 0)
+		++str;
+
+	len = strlen(str);
+	while (len > 0 && isspace((unsigned char)str[len - 1]) != 0)
+		str[--len] = '\0';
+
+	return(str);
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Read configuration file path into cfg. A key  */
+/* given more than once takes its last value.    */
+/* Returns 0, -1 if the file can't be read or    */
+/* the (1 based) number of the first bad line    */
+/*-----------------------------------------------*/
+
+int config_load(const char *path, config_t *cfg)
+{
+	int          line_no = 0;
+	unsigned int i;
+	char         line[SSIZE] = "",
+	             *key        = (char *)NULL,
+	             *value      = (char *)NULL;
+	FILE         *stream     = (FILE *)NULL;
+
+	(void)memset((void *)cfg,0,sizeof(config_t));
+
+	if ((stream = fopen(path,"r")) == (FILE *)NULL)
+		return(-1);
+
+	while (fgets(line,SSIZE,stream) != (char *)NULL) {
+		++line_no;
+
+		key = strip(line);
+		if (*key == '\0' || *key == '#')
+			continue;
+
+		if ((value = strchr(key,'=')) == (char *)NULL) {
+			(void)fclose(stream);
+			return(line_no);
+		}
+
+		*value++ = '\0';
+		key      = strip(key);
+		value    = strip(value);
+
+		if (*key == '\0' || strlen(key) >= CONFIG_KEY_SIZE || strlen(value) >= CONFIG_VALUE_SIZE) {
+			(void)fclose(stream);
+			return(line_no);
+		}
+
+		for (i=0; i<cfg->n_items; ++i) {
+			if (strcmp(cfg->key[i],key) == 0)
+				break;
+		}
+
+		if (i == CONFIG_MAX_ITEMS) {
+			(void)fclose(stream);
+			return(line_no);
+		}
+
+		if (i == cfg->n_items)
+			++cfg->n_items;
+
+		(void)strcpy(cfg->key[i],key);
+		(void)strcpy(cfg->value[i],value);
+	}
+
+	(void)fclose(stream);
+	return(0);
+}
+
+
+
+
+/*------------------------------------------*/
+/* Value of key (NULL if it was not given)  */
+/*------------------------------------------*/
+
+const char *config_get(const config_t *cfg, const char *key)
+{
+	unsigned int i;
+
+	for (i=0; i<cfg->n_items; ++i) {
+		if (strcmp(cfg->key[i],key) == 0)
+			return(cfg->value[i]);
+	}
+
+	return((const char *)NULL);
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* First key which is not in the (NULL ended)    */
+/* list known, or NULL if all keys are known     */
+/*-----------------------------------------------*/
+
+const char *config_unknown(const config_t *cfg, const char *const *known)
+{
+	unsigned int i,
+	             k;
+
+	for (i=0; i<cfg->n_items; ++i) {
+		for (k=0; known[k] != (const char *)NULL; ++k) {
+			if (strcmp(cfg->key[i],known[k]) == 0)
+				break;
+		}
+
+		if (known[k] == (const char *)NULL)
+			return(cfg->key[i]);
+	}
+
+	return((const char *)NULL);
+}
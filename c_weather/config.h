@@ -0,0 +1,44 @@
+#ifndef __CONFIG_H__
+#define __CONFIG_H__
+
+/*---------------------------------------------
+ * Weatherboard configuration file
+ *
+ * One setting per line, "<key> = <value>"
+ * (keys are the command line options without
+ * the leading '-'). Blank lines and lines
+ * starting with '#' are ignored. The file is
+ * only tokenised here; values are checked by
+ * the caller.
+ *-------------------------------------------*/
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define CONFIG_MAX_ITEMS       32
+#define CONFIG_KEY_SIZE        32
+#define CONFIG_VALUE_SIZE      256
+
+
+/*---------------------*/
+/* Configuration items */
+/*---------------------*/
+
+typedef struct {
+	unsigned int n_items;
+	char         key[CONFIG_MAX_ITEMS][CONFIG_KEY_SIZE];
+	char         value[CONFIG_MAX_ITEMS][CONFIG_VALUE_SIZE];
+} config_t;
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int        config_load(const char *path, config_t *cfg);
+extern const char *config_get(const config_t *cfg, const char *key);
+extern const char *config_unknown(const config_t *cfg, const char *const *known);
+
+#endif //__CONFIG_H__
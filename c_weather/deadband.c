@@ -0,0 +1,246 @@
+/*---------------------------------------------
+ * Weatherboard deadband change detection
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "deadband.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+#define SSIZE  256
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static double        threshold[NCHANNELS];
+static int           enabled[NCHANNELS];
+static int           by_name[NCHANNELS];
+static float         last[NCHANNELS];
+static double        last_emit    = (-1.0);
+static double        heartbeat    = DEADBAND_DEFAULT_HEARTBEAT;
+static int           n_enabled    = 0;
+static unsigned long n_suppressed = 0;
+static unsigned long n_emitted    = 0;
+
+
+
+
+/*-----------------------------------------------*/
+/* Parse deadband specification:                 */
+/*                                               */
+/*    [<chan>[,<chan>...]=]<threshold>           */
+/*                                               */
+/* If no channels are given the deadband applies */
+/* to all channels not given one by name (in any */
+/* order)                                        */
+/*-----------------------------------------------*/
+
+int deadband_parse(const char *spec)
+{
+	int    c,
+	       end   = 0,
+	       named = FALSE,
+	       sel[NCHANNELS];
+	double delta;
+	char   tmpstr[SSIZE] = "",
+	       *value        = (char *)NULL,
+	       *tok          = (char *)NULL,
+	       *saveptr      = (char *)NULL;
+
+	(void)strncpy(tmpstr,spec,SSIZE - 1);
+
+	if ((value = strchr(tmpstr,'=')) != (char *)NULL) {
+		*value++ = '\0';
+		named    = TRUE;
+
+		for (c=0; c<NCHANNELS; ++c)
+			sel[c] = FALSE;
+
+		for (tok = strtok_r(tmpstr,",",&saveptr); tok != (char *)NULL; tok = strtok_r((char *)NULL,",",&saveptr)) {
+			if ((c = channel_lookup(tok)) < 0)
+				return(-1);
+
+			sel[c] = TRUE;
+		}
+	} else {
+		value = tmpstr;
+
+		for (c=0; c<NCHANNELS; ++c)
+			sel[c] = by_name[c] == TRUE ? FALSE : TRUE;
+	}
+
+	if (sscanf(value,"%lf%n",&delta,&end) != 1 || value[end] != '\0' || delta < 0.0)
+		return(-1);
+
+	for (c=0; c<NCHANNELS; ++c) {
+		if (sel[c] == TRUE) {
+			threshold[c] = delta;
+			enabled[c]   = TRUE;
+
+			if (named == TRUE)
+				by_name[c] = TRUE;
+		}
+	}
+
+	n_enabled = 0;
+	for (c=0; c<NCHANNELS; ++c) {
+		if (enabled[c] == TRUE)
+			++n_enabled;
+	}
+
+	return(0);
+}
+
+
+
+
+/*----------------------------------------*/
+/* Set/get heartbeat (max silence) period */
+/*----------------------------------------*/
+
+int deadband_set_heartbeat(double secs)
+{
+	if (secs <= 0.0)
+		return(-1);
+
+	heartbeat = secs;
+	return(0);
+}
+
+double deadband_heartbeat(void)
+{
+	return(heartbeat);
+}
+
+
+
+
+/*----------------------------------------*/
+/* TRUE if any channel has a deadband set */
+/*----------------------------------------*/
+
+int deadband_enabled(void)
+{
+	return(n_enabled > 0 ? TRUE : FALSE);
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Deadband for channel chan (negative if none) */
+/*----------------------------------------------*/
+
+double deadband_threshold(unsigned int chan)
+{
+	return(enabled[chan] == TRUE ? threshold[chan] : (-1.0));
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Whether v would be logged differently from the  */
+/* reference value (rounded to the log resolution, */
+/* keeping the sign of a logged -0.00)             */
+/*-------------------------------------------------*/
+
+static int logged_change(float v, float ref)
+{
+	double r     = rint((double)v * DEADBAND_RESOLUTION),
+	       r_ref = rint((double)ref * DEADBAND_RESOLUTION);
+
+	return((r != r_ref || (signbit(r) != 0) != (signbit(r_ref) != 0)) ? TRUE : FALSE);
+}
+
+
+
+
+/*-------------------------------------------------------*/
+/* Decide whether record (values taken at time t) should */
+/* be emitted. Channels without a deadband count as      */
+/* changed if their logged value changes. Emitted values */
+/* become the new reference                              */
+/*-------------------------------------------------------*/
+
+int deadband_check(const float *values, double t)
+{
+	unsigned int c;
+	int          decision = DEADBAND_SUPPRESS;
+
+	if (last_emit < 0.0 || t - last_emit >= heartbeat)
+		decision = DEADBAND_HEARTBEAT;
+	else {
+		for (c=0; c<NCHANNELS; ++c) {
+			/* a channel dropping out (NaN) or coming back is a change */
+			if ((isnan(values[c]) != 0) != (isnan(last[c]) != 0)) {
+				decision = DEADBAND_CHANGE;
+				break;
+			}
+
+			if (isnan(values[c]) != 0)
+				continue;
+
+			if (enabled[c] == TRUE ? fabs((double)values[c] - (double)last[c]) > threshold[c] : logged_change(values[c],last[c]) == TRUE) {
+				decision = DEADBAND_CHANGE;
+				break;
+			}
+		}
+	}
+
+	if (decision == DEADBAND_SUPPRESS) {
+		++n_suppressed;
+		return(decision);
+	}
+
+	for (c=0; c<NCHANNELS; ++c)
+		last[c] = values[c];
+
+	last_emit = t;
+	++n_emitted;
+
+	return(decision);
+}
+
+
+
+
+/*------------------------------------*/
+/* Marker appended to emitted records */
+/*------------------------------------*/
+
+const char *deadband_marker(int decision)
+{
+	if (decision == DEADBAND_CHANGE)
+		return("  mark: C");
+	else if (decision == DEADBAND_HEARTBEAT)
+		return("  mark: H");
+
+	return("");
+}
+
+
+
+
+/*-----------------------------*/
+/* Suppressed/emitted counters */
+/*-----------------------------*/
+
+unsigned long deadband_suppressed(void)
+{
+	return(n_suppressed);
+}
+
+unsigned long deadband_emitted(void)
+{
+	return(n_emitted);
+}
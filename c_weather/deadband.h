@@ -0,0 +1,43 @@
+#ifndef __DEADBAND_H__
+#define __DEADBAND_H__
+
+/*---------------------------------------------
+ * Weatherboard deadband change detection
+ *
+ * A record is emitted only if a channel has
+ * moved beyond its deadband since the last
+ * emitted record, or if the heartbeat (max
+ * silence) interval has expired.
+ *-------------------------------------------*/
+
+#include "channels.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define DEADBAND_OFF               (-1)
+#define DEADBAND_SUPPRESS          0
+#define DEADBAND_CHANGE            1
+#define DEADBAND_HEARTBEAT         2
+
+#define DEADBAND_DEFAULT_HEARTBEAT 900.0
+#define DEADBAND_RESOLUTION        100.0     // Logged values per unit (%.2f)
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int           deadband_parse        (const char *spec);
+extern int           deadband_set_heartbeat(double secs);
+extern double        deadband_heartbeat    (void);
+extern int           deadband_enabled      (void);
+extern double        deadband_threshold    (unsigned int chan);
+extern int           deadband_check        (const float *values, double t);
+extern const char   *deadband_marker       (int decision);
+extern unsigned long deadband_suppressed   (void);
+extern unsigned long deadband_emitted      (void);
+
+#endif //__DEADBAND_H__
@@ -0,0 +1,147 @@
+/*---------------------------------------------
+ * Weatherboard event loop
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/signalfd.h>
+#include "evloop.h"
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static int                epfd      = (-1);
+static int                sigfd     = (-1);
+static struct epoll_event pending[EVLOOP_MAX_EVENTS];
+static int                n_pending = 0;
+static int                next      = 0;
+
+
+
+
+/*---------------------------------------------*/
+/* Block signals and route them (and any fds   */
+/* added later) through epoll. Returns -1 on   */
+/* error                                       */
+/*---------------------------------------------*/
+
+int evloop_init(const int *signals, unsigned int n_signals)
+{
+	unsigned int i;
+	sigset_t     mask;
+
+	(void)sigemptyset(&mask);
+	for (i=0; i<n_signals; ++i)
+		(void)sigaddset(&mask,signals[i]);
+
+	if (sigprocmask(SIG_BLOCK,&mask,(sigset_t *)NULL) < 0)
+		return(-1);
+
+	if ((sigfd = signalfd(-1,&mask,SFD_NONBLOCK | SFD_CLOEXEC)) < 0)
+		return(-1);
+
+	if ((epfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+		return(-1);
+
+	return(evloop_add(sigfd,EPOLLIN,EVLOOP_SIGNAL));
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Register, modify or remove fd (tag is the   */
+/* value returned with its events). Event data */
+/* holds both fd (high word) and tag           */
+/*---------------------------------------------*/
+
+static int control(int op, int fd, uint32_t events, int tag)
+{
+	struct epoll_event ev;
+
+	ev.events   = events;
+	ev.data.u64 = (uint64_t)(uint32_t)fd << 32 | (uint32_t)tag;
+
+	return(epoll_ctl(epfd,op,fd,&ev));
+}
+
+int evloop_add(int fd, uint32_t events, int tag)
+{
+	return(control(EPOLL_CTL_ADD,fd,events,tag));
+}
+
+int evloop_mod(int fd, uint32_t events, int tag)
+{
+	return(control(EPOLL_CTL_MOD,fd,events,tag));
+}
+
+int evloop_del(int fd)
+{
+	int i;
+
+
+	/*------------------------------------*/
+	/* Events already fetched for this fd */
+	/* are stale once it has been removed */
+	/*------------------------------------*/
+
+	for (i=next; i<n_pending; ++i) {
+		if ((int)(pending[i].data.u64 >> 32) == fd)
+			pending[i].events = 0;
+	}
+
+	return(epoll_ctl(epfd,EPOLL_CTL_DEL,fd,(struct epoll_event *)NULL));
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Wait (at most timeout ms, -1 forever) for next */
+/* event. Signals are read from the signalfd so   */
+/* event->signum is the signal delivered. Returns */
+/* the event tag or EVLOOP_TIMEOUT                */
+/*------------------------------------------------*/
+
+int evloop_wait(evloop_event_t *event, int timeout)
+{
+	struct signalfd_siginfo info;
+
+	while (1) {
+		while (next < n_pending) {
+			struct epoll_event *ev = &pending[next++];
+
+			if (ev->events == 0)
+				continue;
+
+			event->tag    = (int)(uint32_t)(ev->data.u64 & 0xffffffff);
+			event->events = ev->events;
+			event->signum = 0;
+
+			if (event->tag == EVLOOP_SIGNAL) {
+				if (read(sigfd,&info,sizeof(info)) != sizeof(info))
+					continue;
+
+				event->signum = info.ssi_signo;
+				--next;               // May be more signals queued
+			}
+
+			return(event->tag);
+		}
+
+		next = 0;
+		if ((n_pending = epoll_wait(epfd,pending,EVLOOP_MAX_EVENTS,timeout)) < 0) {
+			n_pending = 0;
+
+			if (errno != EINTR)
+				return(EVLOOP_TIMEOUT);
+		}
+
+		else if (n_pending == 0)
+			return(EVLOOP_TIMEOUT);
+	}
+}
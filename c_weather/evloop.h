@@ -0,0 +1,50 @@
+#ifndef __EVLOOP_H__
+#define __EVLOOP_H__
+
+/*---------------------------------------------
+ * Weatherboard event loop
+ *
+ * epoll over a signalfd (signals are blocked
+ * and delivered as events, so they are handled
+ * in the main thread, not in signal context),
+ * the sampler timerfd and any other fds (e.g.
+ * the weatherpipe). Each fd is registered with
+ * a tag which is returned with its events.
+ *-------------------------------------------*/
+
+#include <stdint.h>
+#include <signal.h>
+#include <sys/epoll.h>
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define EVLOOP_SIGNAL          0       // Tag of the signalfd
+#define EVLOOP_TIMEOUT         (-1)    // evloop_wait timed out
+#define EVLOOP_MAX_EVENTS      8
+
+
+/*-------*/
+/* Event */
+/*-------*/
+
+typedef struct {
+	int          tag;
+	uint32_t     events;                // EPOLLIN, EPOLLOUT ...
+	unsigned int signum;                // EVLOOP_SIGNAL only
+} evloop_event_t;
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int evloop_init(const int *signals, unsigned int n_signals);
+extern int evloop_add (int fd, uint32_t events, int tag);
+extern int evloop_mod (int fd, uint32_t events, int tag);
+extern int evloop_del (int fd);
+extern int evloop_wait(evloop_event_t *event, int timeout);
+
+#endif //__EVLOOP_H__
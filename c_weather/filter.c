@@ -0,0 +1,266 @@
+/*---------------------------------------------
+ * Weatherboard spike rejection filter stage
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "filter.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+#define SSIZE  256
+
+#define SORT2(a,b) { if ((a) > (b)) { float _t = (a); (a) = (b); (b) = _t; } }
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static chanfilter_t chanfilter[NCHANNELS];
+static int          n_enabled = 0;
+
+
+
+
+/*-----------------------------------------------------*/
+/* Median of 3, 5, 7 or 9 values using fixed (minimal) */
+/* sorting networks. Values in p are reordered         */
+/*-----------------------------------------------------*/
+
+static float median_network(float *p, unsigned int n)
+{
+	switch (n) {
+		case 3:	SORT2(p[0],p[1]); SORT2(p[1],p[2]); SORT2(p[0],p[1]);
+			return(p[1]);
+
+		case 5:	SORT2(p[0],p[1]); SORT2(p[3],p[4]); SORT2(p[0],p[3]);
+			SORT2(p[1],p[4]); SORT2(p[1],p[2]); SORT2(p[2],p[3]);
+			SORT2(p[1],p[2]);
+			return(p[2]);
+
+		case 7:	SORT2(p[0],p[5]); SORT2(p[0],p[3]); SORT2(p[1],p[6]);
+			SORT2(p[2],p[4]); SORT2(p[0],p[1]); SORT2(p[3],p[5]);
+			SORT2(p[2],p[6]); SORT2(p[2],p[3]); SORT2(p[3],p[6]);
+			SORT2(p[4],p[5]); SORT2(p[1],p[4]); SORT2(p[1],p[3]);
+			SORT2(p[3],p[4]);
+			return(p[3]);
+
+		case 9:	SORT2(p[1],p[2]); SORT2(p[4],p[5]); SORT2(p[7],p[8]);
+			SORT2(p[0],p[1]); SORT2(p[3],p[4]); SORT2(p[6],p[7]);
+			SORT2(p[1],p[2]); SORT2(p[4],p[5]); SORT2(p[7],p[8]);
+			SORT2(p[0],p[3]); SORT2(p[5],p[8]); SORT2(p[4],p[7]);
+			SORT2(p[3],p[6]); SORT2(p[1],p[4]); SORT2(p[2],p[5]);
+			SORT2(p[4],p[7]); SORT2(p[4],p[2]); SORT2(p[6],p[4]);
+			SORT2(p[4],p[2]);
+			return(p[4]);
+	}
+
+	return(p[0]);
+}
+
+
+
+
+/*----------------------------------------------------------*/
+/* Parse filter specification:                              */
+/*                                                          */
+/*    [<chan>[,<chan>...]=]median:<N>                       */
+/*    [<chan>[,<chan>...]=]hampel:<N>[:<k>]                 */
+/*    [<chan>[,<chan>...]=]none                             */
+/*                                                          */
+/* N is 3, 5, 7 or 9. If no channels are given the filter   */
+/* applies to all measured channels (dew point is derived). */
+/*----------------------------------------------------------*/
+
+int filter_parse(const char *spec)
+{
+	int          c,
+	             type,
+	             end   = 0;
+	unsigned int n     = 0;
+	double       k     = FILTER_DEFAULT_K;
+	int          sel[NCHANNELS];
+	char         tmpstr[SSIZE]  = "",
+	             *method        = (char *)NULL,
+	             *tok           = (char *)NULL,
+	             *saveptr       = (char *)NULL;
+
+	(void)strncpy(tmpstr,spec,SSIZE - 1);
+
+
+	/*-------------------*/
+	/* Channel selection */
+	/*-------------------*/
+
+	if ((method = strchr(tmpstr,'=')) != (char *)NULL) {
+		*method++ = '\0';
+
+		for (c=0; c<NCHANNELS; ++c)
+			sel[c] = FALSE;
+
+		for (tok = strtok_r(tmpstr,",",&saveptr); tok != (char *)NULL; tok = strtok_r((char *)NULL,",",&saveptr)) {
+			if ((c = channel_lookup(tok)) < 0 || c == CHAN_DEW_POINT)
+				return(-1);
+
+			sel[c] = TRUE;
+		}
+	} else {
+		method = tmpstr;
+
+		for (c=0; c<NCHANNELS; ++c)
+			sel[c] = (c == CHAN_DEW_POINT) ? FALSE : TRUE;
+	}
+
+
+	/*-------------*/
+	/* Filter type */
+	/*-------------*/
+
+	if (strcmp(method,"none") == 0)
+		type = FILTER_NONE;
+	else if (sscanf(method,"median:%u%n",&n,&end) == 1 && method[end] == '\0')
+		type = FILTER_MEDIAN;
+	else if (sscanf(method,"hampel:%u%n:%lf%n",&n,&end,&k,&end) >= 1 && method[end] == '\0')
+		type = FILTER_HAMPEL;
+	else
+		return(-1);
+
+	if (type != FILTER_NONE && (n < 3 || n > FILTER_MAX_N || n % 2 == 0 || k <= 0.0))
+		return(-1);
+
+	for (c=0; c<NCHANNELS; ++c) {
+		if (sel[c] == FALSE)
+			continue;
+
+		chanfilter[c].type     = type;
+		chanfilter[c].n        = n;
+		chanfilter[c].k        = k;
+		chanfilter[c].head     = 0;
+		chanfilter[c].fill     = 0;
+		chanfilter[c].rejected = 0;
+	}
+
+	n_enabled = 0;
+	for (c=0; c<NCHANNELS; ++c) {
+		if (chanfilter[c].type != FILTER_NONE)
+			++n_enabled;
+	}
+
+	return(0);
+}
+
+
+
+
+/*--------------------------------------*/
+/* TRUE if any channel has a filter set */
+/*--------------------------------------*/
+
+int filter_enabled(void)
+{
+	return(n_enabled > 0 ? TRUE : FALSE);
+}
+
+
+
+
+/*------------------------------------------------------*/
+/* Buffer sample v for channel chan and return filtered */
+/* value. Until N samples have been buffered samples    */
+/* pass through unchanged                               */
+/*------------------------------------------------------*/
+
+float filter_apply(unsigned int chan, float v)
+{
+	unsigned int i;
+	float        med,
+	             mad,
+	             tmp[FILTER_MAX_N];
+	chanfilter_t *cf = &chanfilter[chan];
+
+	if (cf->type == FILTER_NONE)
+		return(v);
+
+	cf->ring[cf->head] = v;
+	cf->head           = (cf->head + 1) % cf->n;
+
+	if (cf->fill < cf->n) {
+		++cf->fill;
+
+		if (cf->fill < cf->n)
+			return(v);
+	}
+
+	(void)memcpy(tmp,cf->ring,cf->n*sizeof(float));
+	med = median_network(tmp,cf->n);
+
+
+	/*-------------------------------*/
+	/* Median filter - always median */
+	/*-------------------------------*/
+
+	if (cf->type == FILTER_MEDIAN) {
+		if (med != v)
+			++cf->rejected;
+
+		return(med);
+	}
+
+
+	/*--------------------------------------------------*/
+	/* Hampel filter - replace by median only if sample */
+	/* is more than k (scaled) MADs from the median     */
+	/*--------------------------------------------------*/
+
+	for (i=0; i<cf->n; ++i)
+		tmp[i] = fabsf(cf->ring[i] - med);
+
+	mad = 1.4826 * median_network(tmp,cf->n);
+
+	if (fabsf(v - med) > cf->k * mad) {
+		++cf->rejected;
+		return(med);
+	}
+
+	return(v);
+}
+
+
+
+
+/*-------------------------------------*/
+/* Describe filter set on channel chan */
+/*-------------------------------------*/
+
+const char *filter_describe(unsigned int chan, char *buf)
+{
+	chanfilter_t *cf = &chanfilter[chan];
+
+	if (cf->type == FILTER_MEDIAN)
+		(void)sprintf(buf,"median:%u",cf->n);
+	else if (cf->type == FILTER_HAMPEL)
+		(void)sprintf(buf,"hampel:%u:%g",cf->n,cf->k);
+	else
+		(void)strcpy(buf,"none");
+
+	return(buf);
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Number of samples replaced on channel chan */
+/*--------------------------------------------*/
+
+unsigned long filter_rejected(unsigned int chan)
+{
+	return(chanfilter[chan].rejected);
+}
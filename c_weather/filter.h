@@ -0,0 +1,53 @@
+#ifndef __FILTER_H__
+#define __FILTER_H__
+
+/*---------------------------------------------
+ * Weatherboard spike rejection filter stage
+ *
+ * Per channel median-of-N or Hampel filter
+ * over the last N buffered samples. Medians
+ * are found with fixed size sorting networks
+ * (N = 3, 5, 7 or 9).
+ *-------------------------------------------*/
+
+#include "channels.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FILTER_NONE            0
+#define FILTER_MEDIAN          1
+#define FILTER_HAMPEL          2
+
+#define FILTER_MAX_N           9
+#define FILTER_DEFAULT_K       3.0
+
+
+/*--------------------------*/
+/* Per channel filter state */
+/*--------------------------*/
+
+typedef struct {
+	int          type;
+	unsigned int n;
+	double       k;
+	float        ring[FILTER_MAX_N];
+	unsigned int head;
+	unsigned int fill;
+	unsigned long rejected;
+} chanfilter_t;
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int           filter_parse   (const char *spec);
+extern int           filter_enabled (void);
+extern float         filter_apply   (unsigned int chan, float v);
+extern const char   *filter_describe(unsigned int chan, char *buf);
+extern unsigned long filter_rejected(unsigned int chan);
+
+#endif //__FILTER_H__
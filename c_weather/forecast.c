@@ -0,0 +1,257 @@
+/*---------------------------------------------
+ * Weatherboard pressure tendency and
+ * Zambretti short range forecast
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <math.h>
+#include "forecast.h"
+
+
+/*------------------------*/
+/* Per minute mean bucket */
+/*------------------------*/
+
+typedef struct {
+	long   minute;
+	double sum;
+	long   n;
+} bucket_t;
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static bucket_t ring[FORECAST_NBUCKETS];
+static long     first_minute = (-1);
+static long     last_minute  = (-1);
+static double   altitude     = 0.0;
+static double   sealevel     = 0.0;
+
+
+/*-------------------------------------------------*/
+/* Zambretti forecasts (index z = 1..32), falling  */
+/* (1-9), steady (10-19) and rising (20-32) tables */
+/*-------------------------------------------------*/
+
+static const char zambretti_letter[] = "?ABDHORUVXABEKNPSWXZABCFGIJLMQTYZ";
+
+static const char *const zambretti_text[33] = {
+	"unknown",
+	"settled fine",
+	"fine weather",
+	"fine, becoming less settled",
+	"fairly fine, showery later",
+	"showery, becoming more unsettled",
+	"unsettled, rain later",
+	"rain at times, worse later",
+	"rain at times, becoming very unsettled",
+	"very unsettled, rain",
+	"settled fine",
+	"fine weather",
+	"fine, possibly showers",
+	"fairly fine, showers likely",
+	"showery, bright intervals",
+	"changeable, some rain",
+	"unsettled, rain at times",
+	"rain at frequent intervals",
+	"very unsettled, rain",
+	"stormy, much rain",
+	"settled fine",
+	"fine weather",
+	"becoming fine",
+	"fairly fine, improving",
+	"fairly fine, possibly showers early",
+	"showery early, improving",
+	"changeable, mending",
+	"rather unsettled, clearing later",
+	"unsettled, probably improving",
+	"unsettled, short fine intervals",
+	"very unsettled, finer at times",
+	"stormy, possibly improving",
+	"stormy, much rain" };
+
+
+
+
+/*-------------------------------------------*/
+/* Set/get station altitude (metres) used to */
+/* reduce pressure to sea level              */
+/*-------------------------------------------*/
+
+void forecast_set_altitude(double metres)
+{
+	altitude = metres;
+}
+
+double forecast_altitude(void)
+{
+	return(altitude);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Add pressure sample (hPa) taken at time t. Only */
+/* the bucket for the current minute is touched    */
+/*-------------------------------------------------*/
+
+void forecast_update(double t, double pressure, double temperature)
+{
+	long     minute = (long)floor(t / 60.0);
+	bucket_t *b     = &ring[minute % FORECAST_NBUCKETS];
+
+	if (isfinite(pressure) == 0 || pressure <= 0.0)
+		return;
+
+	if (b->minute != minute) {
+		b->minute = minute;
+		b->sum    = 0.0;
+		b->n      = 0;
+	}
+
+	b->sum += pressure;
+	++b->n;
+
+	if (first_minute < 0)
+		first_minute = minute;
+	last_minute = minute;
+
+
+	/*-------------------------------------------*/
+	/* Reduce to sea level (hypsometric formula) */
+	/*-------------------------------------------*/
+
+	if (isfinite(temperature) == 0)
+		temperature = 15.0;
+
+	sealevel = pressure * pow(1.0 - (0.0065 * altitude) / (temperature + 0.0065 * altitude + 273.15),-5.257);
+}
+
+
+
+
+/*-------------------------------------------------------*/
+/* Pressure tendency (hPa per 3 hours). The reference    */
+/* is the bucket three hours ago or, with less history   */
+/* (or a gap), the oldest bucket within the span, the    */
+/* difference being scaled to 3 hours. Search is bounded */
+/* by the (fixed) ring size                              */
+/*-------------------------------------------------------*/
+
+int forecast_tendency(double *tendency)
+{
+	long     m,
+	         from;
+	bucket_t *now = (bucket_t *)NULL,
+	         *ref = (bucket_t *)NULL;
+
+	*tendency = 0.0;
+
+	if (last_minute < 0 || last_minute - first_minute < FORECAST_MIN_SPAN)
+		return(TENDENCY_UNKNOWN);
+
+	now  = &ring[last_minute % FORECAST_NBUCKETS];
+	from = last_minute - FORECAST_SPAN;
+	if (from < first_minute)
+		from = first_minute;
+
+	for (m=from; m<=last_minute - FORECAST_MIN_SPAN; ++m) {
+		if (ring[m % FORECAST_NBUCKETS].minute == m && ring[m % FORECAST_NBUCKETS].n > 0) {
+			ref = &ring[m % FORECAST_NBUCKETS];
+			break;
+		}
+	}
+
+	if (ref == (bucket_t *)NULL)
+		return(TENDENCY_UNKNOWN);
+
+	*tendency = (now->sum / (double)now->n - ref->sum / (double)ref->n) * (double)FORECAST_SPAN / (double)(last_minute - ref->minute);
+
+	if (*tendency <= -FORECAST_STEADY_BAND)
+		return(TENDENCY_FALLING);
+	else if (*tendency >= FORECAST_STEADY_BAND)
+		return(TENDENCY_RISING);
+
+	return(TENDENCY_STEADY);
+}
+
+
+
+
+/*---------------------*/
+/* Tendency class name */
+/*---------------------*/
+
+const char *forecast_tendency_name(int tendency)
+{
+	if (tendency == TENDENCY_FALLING)
+		return("falling");
+	else if (tendency == TENDENCY_STEADY)
+		return("steady");
+	else if (tendency == TENDENCY_RISING)
+		return("rising");
+
+	return("unknown");
+}
+
+
+
+
+/*-----------------------------------------------------*/
+/* Zambretti forecast index (1-32, 0 if not available) */
+/* from sea level pressure and tendency class (as      */
+/* returned by forecast_tendency)                      */
+/*-----------------------------------------------------*/
+
+int forecast_zambretti(int tendency)
+{
+	int z,
+	    lo,
+	    hi;
+
+	switch (tendency) {
+		case TENDENCY_FALLING:	z = (int)lrint(127.0 - 0.12 * sealevel);
+					lo = 1;
+					hi = 9;
+					break;
+
+		case TENDENCY_STEADY:	z = (int)lrint(144.0 - 0.13 * sealevel);
+					lo = 10;
+					hi = 19;
+					break;
+
+		case TENDENCY_RISING:	z = (int)lrint(185.0 - 0.16 * sealevel);
+					lo = 20;
+					hi = 32;
+					break;
+
+		default:		return(0);
+	}
+
+	if (z < lo)
+		z = lo;
+	else if (z > hi)
+		z = hi;
+
+	return(z);
+}
+
+
+
+
+/*---------------------------------------*/
+/* Zambretti letter (A-Z) and text for z */
+/*---------------------------------------*/
+
+char forecast_letter(int z)
+{
+	return(zambretti_letter[z >= 0 && z <= 32 ? z : 0]);
+}
+
+const char *forecast_text(int z)
+{
+	return(zambretti_text[z >= 0 && z <= 32 ? z : 0]);
+}
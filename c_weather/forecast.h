@@ -0,0 +1,42 @@
+#ifndef __FORECAST_H__
+#define __FORECAST_H__
+
+/*---------------------------------------------
+ * Weatherboard pressure tendency and
+ * Zambretti short range forecast
+ *
+ * Pressure is kept as a ring of per minute
+ * means covering the last three hours, so the
+ * tendency is maintained in O(1) per sample.
+ *-------------------------------------------*/
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FORECAST_SPAN          180            // Minutes (3 hours)
+#define FORECAST_MIN_SPAN      60             // Minutes of history needed
+#define FORECAST_NBUCKETS      (FORECAST_SPAN + 1)
+#define FORECAST_STEADY_BAND   1.6            // hPa per 3 hours
+
+#define TENDENCY_UNKNOWN       0
+#define TENDENCY_FALLING       1
+#define TENDENCY_STEADY        2
+#define TENDENCY_RISING        3
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern void        forecast_set_altitude(double metres);
+extern double      forecast_altitude    (void);
+extern void        forecast_update      (double t, double pressure, double temperature);
+extern int         forecast_tendency    (double *tendency);
+extern const char *forecast_tendency_name(int tendency);
+extern int         forecast_zambretti   (int tendency);
+extern char        forecast_letter      (int z);
+extern const char *forecast_text        (int z);
+
+#endif //__FORECAST_H__
@@ -0,0 +1,193 @@
+/*---------------------------------------------
+ * Weatherboard (V1) temperature fusion
+ *-------------------------------------------*/
+
+#include <math.h>
+#include "fusion.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+
+
+/*--------------------------------------------*/
+/* Measurement model: z_i = T + h_i * d where */
+/* d is the BMP180 - Si702x bias difference   */
+/*--------------------------------------------*/
+
+static const double h_bias[FUSION_NSOURCES] = { 0.5, -0.5 };
+
+
+
+
+/*----------------------------------*/
+/* Initialise filter to prior state */
+/*----------------------------------*/
+
+void fusion_init(fusion_t *f)
+{
+	f->primed        = FALSE;
+	f->t_last        = 0.0;
+	f->x[0]          = 0.0;
+	f->x[1]          = 0.0;
+	f->P[0][0]       = 100.0;
+	f->P[0][1]       = 0.0;
+	f->P[1][0]       = 0.0;
+	f->P[1][1]       = 1.0;
+	f->R[0]          = 0.25;
+	f->R[1]          = 0.25;
+	f->q_temperature = 1.0e-3;	// (C^2 per second)
+	f->q_bias        = 1.0e-7;
+	f->beta          = 0.02;
+}
+
+
+
+
+/*-------------------------------------------*/
+/* TRUE if z is a plausible temperature read */
+/*-------------------------------------------*/
+
+int fusion_valid(double z)
+{
+	if (isfinite(z) == 0 || z < FUSION_MIN_TEMPERATURE || z > FUSION_MAX_TEMPERATURE)
+		return(FALSE);
+
+	return(TRUE);
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Scalar (sequential) Kalman measurement step */
+/*---------------------------------------------*/
+
+static void measure(fusion_t *f, unsigned int source, double z)
+{
+	double h[2],
+	       ph[2],
+	       k[2],
+	       s,
+	       e,
+	       hph;
+
+	h[0]  = 1.0;
+	h[1]  = h_bias[source];
+
+	ph[0] = f->P[0][0]*h[0] + f->P[0][1]*h[1];
+	ph[1] = f->P[1][0]*h[0] + f->P[1][1]*h[1];
+	s     = h[0]*ph[0] + h[1]*ph[1] + f->R[source];
+
+	k[0]  = ph[0] / s;
+	k[1]  = ph[1] / s;
+	e     = z - (h[0]*f->x[0] + h[1]*f->x[1]);
+
+	f->x[0] += k[0] * e;
+	f->x[1] += k[1] * e;
+
+	f->P[0][0] -= k[0] * ph[0];
+	f->P[0][1] -= k[0] * ph[1];
+	f->P[1][0] -= k[1] * ph[0];
+	f->P[1][1] -= k[1] * ph[1];
+
+
+	/*---------------------------------------------*/
+	/* Learn measurement noise from the (post fit) */
+	/* residual: R ~ E[r^2] + H P H'               */
+	/*---------------------------------------------*/
+
+	e   = z - (h[0]*f->x[0] + h[1]*f->x[1]);
+	hph = h[0]*(f->P[0][0]*h[0] + f->P[0][1]*h[1]) + h[1]*(f->P[1][0]*h[0] + f->P[1][1]*h[1]);
+
+	f->R[source] = (1.0 - f->beta) * f->R[source] + f->beta * (e*e + hph);
+	if (f->R[source] < 1.0e-4)
+		f->R[source] = 1.0e-4;
+}
+
+
+
+
+/*---------------------------------------------------*/
+/* Fuse readings taken at time t. Invalid readings   */
+/* (see fusion_valid) are skipped. Returns the fused */
+/* temperature (last estimate if neither is valid)   */
+/*---------------------------------------------------*/
+
+double fusion_update(fusion_t *f, double t, double z_bmp180, double z_si702x)
+{
+	int    v_bmp180 = fusion_valid(z_bmp180),
+	       v_si702x = fusion_valid(z_si702x);
+	double dt;
+
+
+	/*-----------------------------------*/
+	/* Prime from first valid reading(s) */
+	/*-----------------------------------*/
+
+	if (f->primed == FALSE) {
+		if (v_bmp180 == TRUE && v_si702x == TRUE) {
+			f->x[0] = (z_bmp180 + z_si702x) / 2.0;
+			f->x[1] =  z_bmp180 - z_si702x;
+		} else if (v_bmp180 == TRUE)
+			f->x[0] = z_bmp180;
+		else if (v_si702x == TRUE)
+			f->x[0] = z_si702x;
+		else
+			return(NAN);
+
+		f->P[0][0] = f->R[0];
+		f->primed  = TRUE;
+		f->t_last  = t;
+
+		return(f->x[0]);
+	}
+
+
+	/*----------------------------------*/
+	/* Predict (random walk in T and d) */
+	/*----------------------------------*/
+
+	dt = t - f->t_last;
+	if (dt < 0.0)
+		dt = 0.0;
+
+	f->P[0][0] += f->q_temperature * dt;
+	f->P[1][1] += f->q_bias        * dt;
+	f->t_last   = t;
+
+
+	/*--------*/
+	/* Update */
+	/*--------*/
+
+	if (v_bmp180 == TRUE)
+		measure(f,FUSION_BMP180,z_bmp180);
+
+	if (v_si702x == TRUE)
+		measure(f,FUSION_SI702X,z_si702x);
+
+	return(f->x[0]);
+}
+
+
+
+
+/*-------------------------------------------*/
+/* Learned measurement noise (variance, C^2) */
+/* and bias difference (BMP180 - Si702x, C)  */
+/*-------------------------------------------*/
+
+double fusion_noise(const fusion_t *f, unsigned int source)
+{
+	return(f->R[source]);
+}
+
+double fusion_bias(const fusion_t *f)
+{
+	return(f->x[1]);
+}
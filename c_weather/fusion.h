@@ -0,0 +1,57 @@
+#ifndef __FUSION_H__
+#define __FUSION_H__
+
+/*---------------------------------------------
+ * Weatherboard (V1) temperature fusion
+ *
+ * Two state Kalman filter fusing BMP180 and
+ * Si702x temperatures. State is the true
+ * temperature and the bias difference between
+ * the two sensors. Measurement noise for each
+ * sensor is learned online from the residuals,
+ * so each source is weighted by its estimated
+ * noise. A missing (invalid) reading is simply
+ * not applied, so the fused value falls back to
+ * the remaining source (bias corrected) at once.
+ *-------------------------------------------*/
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FUSION_NSOURCES        2
+#define FUSION_BMP180          0
+#define FUSION_SI702X          1
+
+#define FUSION_MIN_TEMPERATURE (-40.0)
+#define FUSION_MAX_TEMPERATURE 85.0
+
+
+/*--------------*/
+/* Filter state */
+/*--------------*/
+
+typedef struct {
+	int    primed;
+	double t_last;
+	double x[2];
+	double P[2][2];
+	double R[FUSION_NSOURCES];
+	double q_temperature;
+	double q_bias;
+	double beta;
+} fusion_t;
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern void   fusion_init  (fusion_t *f);
+extern int    fusion_valid (double z);
+extern double fusion_update(fusion_t *f, double t, double z_bmp180, double z_si702x);
+extern double fusion_noise (const fusion_t *f, unsigned int source);
+extern double fusion_bias  (const fusion_t *f);
+
+#endif //__FUSION_H__
@@ -0,0 +1,128 @@
+/*---------------------------------------------
+ * Weatherboard compressed (gzip) live log
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+#include "gzlog.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+
+#define GZIP_WINDOW            (15 + 16)  // 32K window, gzip wrapper
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static z_stream           zs;
+static int                enabled   = FALSE;
+static int                level     = GZLOG_DEFAULT_LEVEL;
+static int                started   = FALSE;      // A file's gzip stream is open
+static unsigned long long bytes_in  = 0;
+static unsigned long long bytes_out = 0;
+
+
+
+
+/*----------------------------------------*/
+/* Compress the log at level (1-9). The   */
+/* deflate state is allocated here, once  */
+/*----------------------------------------*/
+
+int gzlog_enable(int compression)
+{
+	if (compression < 1 || compression > 9)
+		return(-1);
+
+	(void)memset((void *)&zs,0,sizeof(z_stream));
+
+	if (deflateInit2(&zs,compression,Z_DEFLATED,GZIP_WINDOW,8,Z_DEFAULT_STRATEGY) != Z_OK)
+		return(-1);
+
+	level   = compression;
+	enabled = TRUE;
+	started = FALSE;
+	return(0);
+}
+
+int gzlog_enabled(void)
+{
+	return(enabled);
+}
+
+
+
+
+/*-----------------------------------------*/
+/* Start the gzip stream for a new log     */
+/* file (header goes out with its first    */
+/* batch)                                  */
+/*-----------------------------------------*/
+
+int gzlog_begin(void)
+{
+	if (enabled == FALSE)
+		return(-1);
+
+	started = TRUE;
+	return(deflateReset(&zs) == Z_OK ? 0 : (-1));
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Deflate len bytes of text into out (size bytes, */
+/* at least len + GZLOG_SLACK) and sync flush, or  */
+/* if finish is TRUE end the gzip stream. Returns  */
+/* the compressed length or -1 on error            */
+/*-------------------------------------------------*/
+
+long gzlog_deflate(const char *text, size_t len, int finish, char *out, size_t size)
+{
+	int status;
+
+	if (enabled == FALSE || started == FALSE)
+		return(-1);
+
+	zs.next_in   = (Bytef *)text;
+	zs.avail_in  = (uInt)len;
+	zs.next_out  = (Bytef *)out;
+	zs.avail_out = (uInt)size;
+
+	status = deflate(&zs,finish == TRUE ? Z_FINISH : Z_SYNC_FLUSH);
+
+	if ((finish == TRUE && status != Z_STREAM_END) || (finish == FALSE && status != Z_OK) || zs.avail_in != 0)
+		return(-1);
+
+	if (finish == TRUE)
+		started = FALSE;
+
+	bytes_in  += (unsigned long long)len;
+	bytes_out += (unsigned long long)(size - zs.avail_out);
+
+	return((long)(size - zs.avail_out));
+}
+
+
+
+
+/*----------------------------------*/
+/* Bytes in and out (and the ratio) */
+/*----------------------------------*/
+
+void gzlog_report(FILE *stream)
+{
+	if (enabled == FALSE || bytes_out == 0)
+		return;
+
+	(void)fprintf(stream,"    gzip log: level %d, %llu bytes in, %llu bytes out (%.1f:1)\n",level,bytes_in,bytes_out,(double)bytes_in/(double)bytes_out);
+}
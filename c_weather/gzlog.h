@@ -0,0 +1,38 @@
+#ifndef __GZLOG_H__
+#define __GZLOG_H__
+
+/*---------------------------------------------
+ * Weatherboard compressed (gzip) live log
+ *
+ * Each batch committed to the log is deflated
+ * and sync flushed (Z_SYNC_FLUSH), so what is
+ * on disk always ends on a complete block and
+ * zcat can read a log which is still being
+ * written. Closing a log finishes its gzip
+ * stream (trailer). One log is compressed at
+ * a time; the deflate state is allocated once
+ * and reset for each new file.
+ *-------------------------------------------*/
+
+#include <stdio.h>
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define GZLOG_DEFAULT_LEVEL    6
+#define GZLOG_SLACK            1024       // Room over the input for a flushed block
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int           gzlog_enable (int level);
+extern int           gzlog_enabled(void);
+extern int           gzlog_begin  (void);
+extern long          gzlog_deflate(const char *text, size_t len, int finish, char *out, size_t size);
+extern void          gzlog_report (FILE *stream);
+
+#endif //__GZLOG_H__
@@ -0,0 +1,281 @@
+/*---------------------------------------------
+ * Weatherboard sensor health
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include "health.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+
+#define PROBE_IDLE             0
+#define PROBE_REQUESTED        1
+#define PROBE_RUNNING          2
+#define PROBE_DONE             3
+
+
+/*--------------*/
+/* Sensor state */
+/*--------------*/
+
+typedef struct {
+	const char     *name;
+	health_probe_t probe;
+	int            present;
+	unsigned int   errors;          // Consecutive failed reads
+	double         backoff;         // secs
+	double         next_probe;
+	int            state;           // PROBE_IDLE ... (under lock)
+	int            result;
+	unsigned long  failures;        // Times marked absent
+	unsigned long  probes;
+} health_t;
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static health_t        sensor[HEALTH_MAX_SENSORS];
+static int             n_sensors = 0;
+static const char      *bus      = (const char *)NULL;
+static int             running   = FALSE;
+static pthread_t       prober;
+static pthread_mutex_t lock;
+static pthread_cond_t  requested = PTHREAD_COND_INITIALIZER;
+
+
+
+
+/*--------------------------------------------*/
+/* Prober thread: run requested probes. The   */
+/* lock is never held while a probe runs      */
+/*--------------------------------------------*/
+
+static void *run_probes(void *arg)
+{
+	int i,
+	    result;
+
+	(void)arg;
+
+	while (1) {
+		(void)pthread_mutex_lock(&lock);
+
+		while (1) {
+			for (i=0; i<n_sensors; ++i) {
+				if (sensor[i].state == PROBE_REQUESTED)
+					break;
+			}
+
+			if (i < n_sensors)
+				break;
+
+			(void)pthread_cond_wait(&requested,&lock);
+		}
+
+		sensor[i].state = PROBE_RUNNING;
+		(void)pthread_mutex_unlock(&lock);
+
+		result = sensor[i].probe(bus);
+
+		(void)pthread_mutex_lock(&lock);
+		sensor[i].result = result;
+		sensor[i].state  = PROBE_DONE;
+		(void)pthread_mutex_unlock(&lock);
+	}
+
+	return((void *)NULL);
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Start the prober thread (before realtime     */
+/* mode, so it keeps normal priority), with all */
+/* signals blocked so they are left to the main */
+/* thread. The lock inherits priority, so the   */
+/* realtime sampler waiting on it never waits   */
+/* behind other threads preempting the prober   */
+/*----------------------------------------------*/
+
+int health_start(const char *device)
+{
+	int                 status;
+	sigset_t            all,
+	                    old;
+	pthread_mutexattr_t attr;
+
+	bus = device;
+
+	(void)pthread_mutexattr_init(&attr);
+	(void)pthread_mutexattr_setprotocol(&attr,PTHREAD_PRIO_INHERIT);
+	(void)pthread_mutex_init(&lock,&attr);
+	(void)pthread_mutexattr_destroy(&attr);
+
+	(void)sigfillset(&all);
+	(void)pthread_sigmask(SIG_BLOCK,&all,&old);
+	status = pthread_create(&prober,(pthread_attr_t *)NULL,run_probes,(void *)NULL);
+	(void)pthread_sigmask(SIG_SETMASK,&old,(sigset_t *)NULL);
+
+	if (status != 0)
+		return(-1);
+
+	running = TRUE;
+	return(0);
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Add a sensor (present or not after its      */
+/* initial probe at time t). Returns its index */
+/*---------------------------------------------*/
+
+int health_add(const char *name, health_probe_t probe, int present, double t)
+{
+	health_t *s = (health_t *)NULL;
+
+	if (n_sensors == HEALTH_MAX_SENSORS)
+		return(-1);
+
+	s = &sensor[n_sensors];
+	(void)memset((void *)s,0,sizeof(health_t));
+
+	s->name       = name;
+	s->probe      = probe;
+	s->present    = present;
+	s->backoff    = HEALTH_MIN_BACKOFF;
+	s->next_probe = t + HEALTH_MIN_BACKOFF;
+	s->state      = PROBE_IDLE;
+
+	if (present == FALSE)
+		++s->failures;
+
+	return(n_sensors++);
+}
+
+
+
+
+/*-----------*/
+/* Accessors */
+/*-----------*/
+
+int health_sensors(void)
+{
+	return(n_sensors);
+}
+
+const char *health_name(int sensor_id)
+{
+	return(sensor[sensor_id].name);
+}
+
+int health_present(int sensor_id)
+{
+	return(sensor[sensor_id].present);
+}
+
+unsigned long health_failures(int sensor_id)
+{
+	return(sensor[sensor_id].failures);
+}
+
+unsigned long health_probes(int sensor_id)
+{
+	return(sensor[sensor_id].probes);
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Result of a read of sensor at time t. Marks  */
+/* it absent after HEALTH_FAILURES in a row     */
+/*----------------------------------------------*/
+
+void health_read(int sensor_id, int ok, double t)
+{
+	health_t *s = &sensor[sensor_id];
+
+	if (ok == TRUE) {
+		s->errors = 0;
+		return;
+	}
+
+	if (++s->errors < HEALTH_FAILURES || s->present == FALSE)
+		return;
+
+	s->present    = FALSE;
+	s->backoff    = HEALTH_MIN_BACKOFF;
+	s->next_probe = t + s->backoff;
+	++s->failures;
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Called every tick: collect finished probes and */
+/* request those which are due (never waits for   */
+/* a probe). Returns a bit mask of the sensors    */
+/* which have come back                           */
+/*------------------------------------------------*/
+
+unsigned int health_poll(double t)
+{
+	int          i,
+	             wake      = FALSE;
+	unsigned int recovered = 0;
+	health_t     *s        = (health_t *)NULL;
+
+	if (running == FALSE)
+		return(0);
+
+	(void)pthread_mutex_lock(&lock);
+
+	for (i=0; i<n_sensors; ++i) {
+		s = &sensor[i];
+
+		if (s->state == PROBE_DONE) {
+			s->state = PROBE_IDLE;
+
+			if (s->result == 0) {
+				s->present = TRUE;
+				s->errors  = 0;
+				s->backoff = HEALTH_MIN_BACKOFF;
+				recovered |= 1U << i;
+			} else {
+				s->backoff *= 2.0;
+				if (s->backoff > HEALTH_MAX_BACKOFF)
+					s->backoff = HEALTH_MAX_BACKOFF;
+
+				s->next_probe = t + s->backoff;
+			}
+		}
+
+		else if (s->state == PROBE_IDLE && s->present == FALSE && t >= s->next_probe) {
+			s->state = PROBE_REQUESTED;
+			++s->probes;
+			wake = TRUE;
+		}
+	}
+
+	if (wake == TRUE)
+		(void)pthread_cond_signal(&requested);
+
+	(void)pthread_mutex_unlock(&lock);
+
+	return(recovered);
+}
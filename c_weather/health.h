@@ -0,0 +1,51 @@
+#ifndef __HEALTH_H__
+#define __HEALTH_H__
+
+/*---------------------------------------------
+ * Weatherboard sensor health
+ *
+ * Each sensor is present or absent. After
+ * HEALTH_FAILURES consecutive failed reads a
+ * sensor is marked absent (its channels are
+ * logged as nan) and the others carry on.
+ * Absent sensors are re-probed (their begin
+ * function re-run) by a background thread
+ * with exponential backoff, from
+ * HEALTH_MIN_BACKOFF to HEALTH_MAX_BACKOFF
+ * seconds, so a probe never holds up the
+ * sampling of healthy sensors.
+ *-------------------------------------------*/
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define HEALTH_MAX_SENSORS     4
+#define HEALTH_FAILURES        3
+#define HEALTH_MIN_BACKOFF     1.0
+#define HEALTH_MAX_BACKOFF     600.0
+
+
+/*---------------------------------------*/
+/* Probe (begin) function: 0 if success  */
+/*---------------------------------------*/
+
+typedef int (*health_probe_t)(const char *device);
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int           health_start   (const char *device);
+extern int           health_add     (const char *name, health_probe_t probe, int present, double t);
+extern int           health_sensors (void);
+extern const char    *health_name   (int sensor);
+extern int           health_present (int sensor);
+extern void          health_read    (int sensor, int ok, double t);
+extern unsigned int  health_poll    (double t);
+extern unsigned long health_failures(int sensor);
+extern unsigned long health_probes  (int sensor);
+
+#endif //__HEALTH_H__
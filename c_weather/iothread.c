@@ -0,0 +1,336 @@
+/*---------------------------------------------
+ * Weatherboard log writer thread
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include "logbuf.h"
+#include "iothread.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+
+#define OP_WRITE               0
+#define OP_CLOSE               1
+#define OP_SYNC                2
+
+
+/*-----------*/
+/* Ring slot */
+/*-----------*/
+
+typedef struct {
+	int               op;
+	FILE              *stream;
+	iothread_closed_t closed;         // Called with text once stream is closed
+	size_t            len;
+	char              text[IOTHREAD_SLOT_SIZE];
+} ioslot_t;
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static ioslot_t      *slot     = (ioslot_t *)NULL;
+static atomic_uint   head      = 0;      // Next slot to write (only the writer stores it)
+static atomic_uint   tail      = 0;      // Next free slot (only the sampler stores it)
+static atomic_int    waiting   = FALSE;  // Sampler waiting on freed
+static sem_t         queued;             // Slots queued (the writer waits on it)
+static sem_t         freed;              // Posted to wake a waiting sampler
+static int           policy    = IOTHREAD_DROP;
+static int           running   = FALSE;
+static unsigned int  peak      = 0;
+static unsigned long queued_n  = 0;
+static unsigned long overflows = 0;
+static unsigned long dropped   = 0;
+static long long     blocked   = 0;      // ns
+static pthread_t     writer;
+
+
+
+
+/*-------------------------------------------*/
+/* Writer thread: write (sync or close) ring */
+/* slots in order, then hand each slot back  */
+/* (waking the sampler if it is waiting for  */
+/* room)                                     */
+/*-------------------------------------------*/
+
+static void *write_slots(void *arg)
+{
+	ioslot_t     *s = (ioslot_t *)NULL;
+	unsigned int h;
+
+	(void)arg;
+
+	while (1) {
+		while (sem_wait(&queued) != 0)
+			;
+
+		h = atomic_load_explicit(&head,memory_order_relaxed);
+		s = &slot[h % IOTHREAD_SLOTS];
+
+		if (s->op == OP_CLOSE) {
+			(void)fclose(s->stream);
+
+			if (s->closed != (iothread_closed_t)NULL)
+				s->closed(s->text);
+		}
+		else if (s->op == OP_SYNC)
+			(void)logbuf_datasync(s->stream);
+		else
+			(void)logbuf_write(s->stream,s->text,s->len);
+
+		atomic_store_explicit(&head,h + 1,memory_order_release);
+
+		if (atomic_exchange(&waiting,FALSE) == TRUE)
+			(void)sem_post(&freed);
+	}
+
+	return((void *)NULL);
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Allocate (and touch) the slots and start    */
+/* the writer. overflow is IOTHREAD_DROP (drop */
+/* and count) or IOTHREAD_BLOCK (wait for the  */
+/* writer)                                     */
+/*---------------------------------------------*/
+
+int iothread_start(int overflow)
+{
+	if ((slot = (ioslot_t *)calloc(IOTHREAD_SLOTS,sizeof(ioslot_t))) == (ioslot_t *)NULL)
+		return(-1);
+
+	(void)memset((void *)slot,0,IOTHREAD_SLOTS*sizeof(ioslot_t));
+
+	if (sem_init(&queued,0,0) != 0 || sem_init(&freed,0,0) != 0)
+		return(-1);
+
+	if (pthread_create(&writer,(pthread_attr_t *)NULL,write_slots,(void *)NULL) != 0)
+		return(-1);
+
+	policy  = overflow;
+	running = TRUE;
+	return(0);
+}
+
+int iothread_running(void)
+{
+	return(running);
+}
+
+int iothread_policy(void)
+{
+	return(policy);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Wait (sampler) until at most depth slots are   */
+/* queued. The flag is set before the ring is     */
+/* checked again, so a slot freed in between is   */
+/* either seen or posts the semaphore             */
+/*------------------------------------------------*/
+
+static void wait_depth(unsigned int depth)
+{
+	unsigned int t = atomic_load_explicit(&tail,memory_order_relaxed);
+
+	while (t - atomic_load_explicit(&head,memory_order_acquire) > depth) {
+		atomic_store(&waiting,TRUE);
+
+		if (t - atomic_load_explicit(&head,memory_order_acquire) <= depth) {
+			atomic_store(&waiting,FALSE);
+			break;
+		}
+
+		(void)sem_wait(&freed);
+	}
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Make room (sampler) for n slots. If the ring   */
+/* is too full the caller drops (and counts) its  */
+/* text or, if wait is TRUE, the sampler waits    */
+/* for the writer. Returns -1 if there is no room */
+/*------------------------------------------------*/
+
+static int reserve(unsigned int n, int wait)
+{
+	unsigned int    t = atomic_load_explicit(&tail,memory_order_relaxed);
+	struct timespec start,
+	                end;
+
+	if (t - atomic_load_explicit(&head,memory_order_acquire) <= IOTHREAD_SLOTS - n)
+		return(0);
+
+	++overflows;
+
+	if (wait == FALSE) {
+		++dropped;
+		return(-1);
+	}
+
+	(void)clock_gettime(CLOCK_MONOTONIC,&start);
+	wait_depth(IOTHREAD_SLOTS - n);
+	(void)clock_gettime(CLOCK_MONOTONIC,&end);
+
+	blocked += (long long)(end.tv_sec - start.tv_sec)*1000000000LL + (long long)(end.tv_nsec - start.tv_nsec);
+	return(0);
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Queue operation op on stream in a reserved  */
+/* slot (sampler)                              */
+/*---------------------------------------------*/
+
+static void enqueue(int op, FILE *stream, iothread_closed_t closed, const char *text, size_t len)
+{
+	unsigned int t = atomic_load_explicit(&tail,memory_order_relaxed),
+	             depth;
+	ioslot_t     *s = &slot[t % IOTHREAD_SLOTS];
+
+	s->op     = op;
+	s->stream = stream;
+	s->closed = closed;
+	s->len    = len;
+
+	if (len > 0)
+		(void)memcpy(s->text,text,len);
+
+	atomic_store_explicit(&tail,t + 1,memory_order_release);
+	(void)sem_post(&queued);
+
+	if ((depth = t + 1 - atomic_load_explicit(&head,memory_order_relaxed)) > peak)
+		peak = depth;
+
+	++queued_n;
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Queue text for stream, a slot at a time. Room  */
+/* for all of it is made first, so the text is    */
+/* queued or dropped whole (a lost middle slot    */
+/* would tear a record). Returns -1 if dropped    */
+/*------------------------------------------------*/
+
+int iothread_write(FILE *stream, const char *text, size_t len)
+{
+	unsigned int n;
+	size_t       off,
+	             chunk;
+
+	if (len > IOTHREAD_SLOTS*IOTHREAD_SLOT_SIZE)
+		len = IOTHREAD_SLOTS*IOTHREAD_SLOT_SIZE;
+
+	n = len == 0 ? 1 : (unsigned int)((len + IOTHREAD_SLOT_SIZE - 1) / IOTHREAD_SLOT_SIZE);
+
+	if (reserve(n,policy == IOTHREAD_BLOCK ? TRUE : FALSE) < 0)
+		return(-1);
+
+	off = 0;
+
+	do {
+		chunk = len - off < IOTHREAD_SLOT_SIZE ? len - off : IOTHREAD_SLOT_SIZE;
+		enqueue(OP_WRITE,stream,(iothread_closed_t)NULL,text + off,chunk);
+		off += chunk;
+	} while (off < len);
+
+	return(0);
+}
+
+int iothread_sync(FILE *stream)
+{
+	if (reserve(1,policy == IOTHREAD_BLOCK ? TRUE : FALSE) < 0)
+		return(-1);
+
+	enqueue(OP_SYNC,stream,(iothread_closed_t)NULL,(const char *)NULL,0);
+	return(0);
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Close stream once everything queued before   */
+/* has been written, then (if closed is not     */
+/* NULL) call closed with path on the writer    */
+/* thread. Waits for room rather than dropping  */
+/* (a lost close would leak the file)           */
+/*----------------------------------------------*/
+
+int iothread_close(FILE *stream, iothread_closed_t closed, const char *path)
+{
+	size_t len;
+
+	if (path == (const char *)NULL)
+		path = "";
+
+	if ((len = strlen(path) + 1) > IOTHREAD_SLOT_SIZE)
+		len = IOTHREAD_SLOT_SIZE;
+
+	(void)reserve(1,TRUE);
+	enqueue(OP_CLOSE,stream,closed,path,len);
+	return(0);
+}
+
+
+
+
+/*---------------------------------------*/
+/* Wait until the ring has been written  */
+/*---------------------------------------*/
+
+void iothread_drain(void)
+{
+	if (running == FALSE)
+		return;
+
+	wait_depth(0);
+}
+
+
+
+
+/*------------------------------------------*/
+/* Accounting (sampler side): slots queued, */
+/* peak depth, times the ring was full,     */
+/* slots dropped and time spent waiting     */
+/*------------------------------------------*/
+
+void iothread_report(FILE *stream)
+{
+	(void)fprintf(stream,"    log writer: %lu slots queued (peak depth %u/%d), full %lu times, %lu writes dropped, %.3f secs blocked (%s on overflow)\n",
+	                     queued_n,peak,IOTHREAD_SLOTS,overflows,dropped,(double)blocked/1.0e9,policy == IOTHREAD_BLOCK ? "block" : "drop");
+}
+
+unsigned long iothread_dropped(void)
+{
+	return(dropped);
+}
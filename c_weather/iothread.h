@@ -0,0 +1,59 @@
+#ifndef __IOTHREAD_H__
+#define __IOTHREAD_H__
+
+/*---------------------------------------------
+ * Weatherboard log writer thread
+ *
+ * The sampling thread never touches the disk.
+ * Text for a stream is queued (copied into a
+ * slot of a fixed ring of preallocated slots)
+ * and written, synced and closed by a normal
+ * priority writer thread. The ring has one
+ * producer (the sampler) and one consumer (the
+ * writer), so it needs no lock: each side only
+ * stores its own index, and queueing is a copy,
+ * a release store and a semaphore post. Text
+ * longer than a slot takes several. If the ring
+ * has no room for all of it the text is either
+ * dropped whole (and counted), so the sampler
+ * never waits however slow the storage is, or
+ * the sampler waits for free slots
+ * (backpressure).
+ *-------------------------------------------*/
+
+#include <stdio.h>
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define IOTHREAD_SLOTS         64
+#define IOTHREAD_SLOT_SIZE     8192
+
+#define IOTHREAD_DROP          0
+#define IOTHREAD_BLOCK         1
+
+
+/*-----------------------------------*/
+/* Called once a stream is closed    */
+/*-----------------------------------*/
+
+typedef void (*iothread_closed_t)(const char *path);
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int           iothread_start  (int overflow);
+extern int           iothread_running(void);
+extern int           iothread_policy (void);
+extern int           iothread_write  (FILE *stream, const char *text, size_t len);
+extern int           iothread_sync   (FILE *stream);
+extern int           iothread_close  (FILE *stream, iothread_closed_t closed, const char *path);
+extern void          iothread_drain  (void);
+extern void          iothread_report (FILE *stream);
+extern unsigned long iothread_dropped(void);
+
+#endif //__IOTHREAD_H__
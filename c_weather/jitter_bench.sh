@@ -0,0 +1,66 @@
+#!/bin/sh
+#---------------------------------------------
+# Weatherboard sampling jitter benchmark
+#
+# Runs the daemon against the simulated bus
+# at a 10 ms period, logging to a file, while
+# every CPU is kept busy and the disk is
+# flooded with writes. Run once normally and
+# once in realtime mode (needs root for
+# SCHED_FIFO and mlockall) and prints the
+# scheduler's wakeup latency report for each.
+# Refuses to run while another daemon owns
+# /tmp/weatherpipe.
+#
+# Usage: jitter_bench.sh [secs:30] [period:10ms]
+#---------------------------------------------
+
+SECS=${1:-30}
+PERIOD=${2:-10ms}
+WORK=$(mktemp -d /tmp/jitter.XXXXXX)
+NCPU=$(nproc)
+
+stress_start() {
+   STRESS=""
+
+   for i in $(seq 1 $NCPU); do
+      yes > /dev/null &
+      STRESS="$STRESS $!"
+   done
+
+   ( while true; do dd if=/dev/zero of=$WORK/disk bs=1M count=256 conv=fsync 2> /dev/null; done ) &
+   STRESS="$STRESS $!"
+}
+
+stress_stop() {
+   kill $STRESS 2> /dev/null
+   wait $STRESS 2> /dev/null
+   rm -f $WORK/disk
+}
+
+run() {
+   echo "==== $1 ===="
+
+   if [ -e /tmp/weatherpipe ]; then
+      echo "jitter_bench.sh: /tmp/weatherpipe exists (is weather_board already running?)" >&2
+      rm -rf $WORK
+      exit 1
+   fi
+
+   stress_start
+   ./weather_board -verbose -simulate -uperiod $PERIOD $2 -logfile $WORK/log 2> $WORK/report &
+   PID=$!
+
+   sleep $SECS
+   kill -TERM $PID
+   wait $PID 2> /dev/null
+   stress_stop
+
+   grep -E "scheduler:|log writer:|WARNING: realtime" $WORK/report
+   echo
+}
+
+run "normal"   ""
+run "realtime" "-realtime -cpu 0"
+
+rm -rf $WORK
@@ -0,0 +1,515 @@
+/*---------------------------------------------
+ * Weatherboard mergeable quantile sketches
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "kll.h"
+
+
+/*------------------------------------*/
+/* Weighted item (used for quantiles) */
+/*------------------------------------*/
+
+typedef struct {
+	float              v;
+	unsigned long long w;
+} kll_item_t;
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static uint32_t coin = 0x2545f491;
+
+
+
+
+/*----------------------------------------*/
+/* Fair coin (xorshift32) for compactions */
+/*----------------------------------------*/
+
+static unsigned int flip(void)
+{
+	coin ^= coin << 13;
+	coin ^= coin >> 17;
+	coin ^= coin << 5;
+
+	return(coin & 1);
+}
+
+
+
+
+/*-------------------*/
+/* qsort comparators */
+/*-------------------*/
+
+static int cmp_float(const void *a, const void *b)
+{
+	float x = *(const float *)a,
+	      y = *(const float *)b;
+
+	return(x < y ? -1 : (x > y ? 1 : 0));
+}
+
+static int cmp_item(const void *a, const void *b)
+{
+	float x = ((const kll_item_t *)a)->v,
+	      y = ((const kll_item_t *)b)->v;
+
+	return(x < y ? -1 : (x > y ? 1 : 0));
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Capacity of level h (top level has k items, */
+/* each level below 2/3 of the one above)      */
+/*---------------------------------------------*/
+
+static unsigned int capacity(const kll_t *sk, unsigned int h)
+{
+	unsigned int cap = (unsigned int)((double)sk->k * pow(2.0/3.0,(double)(sk->n_levels - 1 - h)));
+
+	return(cap < KLL_MIN_CAPACITY ? KLL_MIN_CAPACITY : cap);
+}
+
+
+
+
+/*------------------------*/
+/* Append item to level h */
+/*------------------------*/
+
+static int push(kll_t *sk, unsigned int h, float v)
+{
+	unsigned int nalloc;
+	float        *nlevel = (float *)NULL;
+
+	if (sk->size[h] == sk->alloc[h]) {
+		nalloc = sk->alloc[h] == 0 ? KLL_MIN_CAPACITY : 2*sk->alloc[h];
+
+		if ((nlevel = (float *)realloc(sk->level[h],nalloc*sizeof(float))) == (float *)NULL)
+			return(-1);
+
+		sk->level[h] = nlevel;
+		sk->alloc[h] = nalloc;
+	}
+
+	sk->level[h][sk->size[h]++] = v;
+	return(0);
+}
+
+
+
+
+/*----------------------------------------------------*/
+/* Compact level h: sort it and promote every other   */
+/* item (random offset) to level h+1 at double weight */
+/*----------------------------------------------------*/
+
+static int compact(kll_t *sk, unsigned int h)
+{
+	unsigned int i,
+	             keep,
+	             offset;
+
+	if (h + 1 == sk->n_levels) {
+		if (sk->n_levels == KLL_MAX_LEVELS)
+			return(-1);
+
+		++sk->n_levels;
+	}
+
+	qsort(sk->level[h],sk->size[h],sizeof(float),cmp_float);
+
+
+	/*---------------------------------------------*/
+	/* Odd number of items - the smallest stays at */
+	/* this level so promoted weight is preserved  */
+	/*---------------------------------------------*/
+
+	keep   = sk->size[h] % 2;
+	offset = flip();
+
+	for (i=keep + offset; i<sk->size[h]; i += 2) {
+		if (push(sk,h + 1,sk->level[h][i]) < 0)
+			return(-1);
+	}
+
+	sk->size[h] = keep;
+	return(0);
+}
+
+
+
+
+/*-----------------------------------------*/
+/* Compact until every level is within its */
+/* capacity                                */
+/*-----------------------------------------*/
+
+static int compress(kll_t *sk)
+{
+	unsigned int h;
+	int          compacted;
+
+	do {
+		compacted = 0;
+
+		for (h=0; h<sk->n_levels; ++h) {
+			if (sk->size[h] >= capacity(sk,h)) {
+				if (compact(sk,h) < 0)
+					return(-1);
+
+				compacted = 1;
+				break;
+			}
+		}
+	} while (compacted == 1);
+
+	return(0);
+}
+
+
+
+
+/*------------------------------*/
+/* Initialise/free/reset sketch */
+/*------------------------------*/
+
+void kll_init(kll_t *sk, unsigned int k)
+{
+	(void)memset((void *)sk,0,sizeof(kll_t));
+
+	sk->k        = k < KLL_MIN_CAPACITY ? KLL_MIN_CAPACITY : k;
+	sk->n_levels = 1;
+}
+
+void kll_free(kll_t *sk)
+{
+	unsigned int h;
+
+	for (h=0; h<KLL_MAX_LEVELS; ++h)
+		free(sk->level[h]);
+
+	kll_init(sk,sk->k);
+}
+
+void kll_reset(kll_t *sk)
+{
+	unsigned int h;
+
+	for (h=0; h<KLL_MAX_LEVELS; ++h)
+		sk->size[h] = 0;
+
+	sk->n_levels = 1;
+	sk->n        = 0;
+}
+
+
+
+
+/*-----------------------*/
+/* Add value v to sketch */
+/*-----------------------*/
+
+int kll_update(kll_t *sk, float v)
+{
+	if (isfinite(v) == 0)
+		return(0);
+
+	if (sk->n == 0 || v < sk->min)
+		sk->min = v;
+
+	if (sk->n == 0 || v > sk->max)
+		sk->max = v;
+
+	++sk->n;
+
+	if (push(sk,0,v) < 0)
+		return(-1);
+
+	if (sk->size[0] >= capacity(sk,0))
+		return(compress(sk));
+
+	return(0);
+}
+
+
+
+
+/*---------------------------*/
+/* Merge sketch src into dst */
+/*---------------------------*/
+
+int kll_merge(kll_t *dst, const kll_t *src)
+{
+	unsigned int h,
+	             i;
+
+	if (src->n == 0)
+		return(0);
+
+	if (dst->n == 0 || src->min < dst->min)
+		dst->min = src->min;
+
+	if (dst->n == 0 || src->max > dst->max)
+		dst->max = src->max;
+
+	dst->n += src->n;
+
+	if (src->n_levels > dst->n_levels)
+		dst->n_levels = src->n_levels;
+
+	for (h=0; h<src->n_levels; ++h) {
+		for (i=0; i<src->size[h]; ++i) {
+			if (push(dst,h,src->level[h][i]) < 0)
+				return(-1);
+		}
+	}
+
+	return(compress(dst));
+}
+
+
+
+
+/*--------------------------------------*/
+/* Approximate q quantile (0 <= q <= 1) */
+/*--------------------------------------*/
+
+double kll_quantile(const kll_t *sk, double q)
+{
+	unsigned int       h,
+	                   i,
+	                   n_items = 0;
+	unsigned long long total   = 0,
+	                   cum     = 0;
+	double             ret;
+	kll_item_t         *items  = (kll_item_t *)NULL;
+
+	if (sk->n == 0)
+		return(NAN);
+
+	if (q <= 0.0)
+		return(sk->min);
+	else if (q >= 1.0)
+		return(sk->max);
+
+	if ((items = (kll_item_t *)malloc(kll_retained(sk)*sizeof(kll_item_t))) == (kll_item_t *)NULL)
+		return(NAN);
+
+	for (h=0; h<sk->n_levels; ++h) {
+		for (i=0; i<sk->size[h]; ++i) {
+			items[n_items].v   = sk->level[h][i];
+			items[n_items++].w = 1ULL << h;
+			total             += 1ULL << h;
+		}
+	}
+
+	qsort(items,n_items,sizeof(kll_item_t),cmp_item);
+
+	ret = items[n_items - 1].v;
+	for (i=0; i<n_items; ++i) {
+		cum += items[i].w;
+
+		if ((double)cum >= q * (double)total) {
+			ret = items[i].v;
+			break;
+		}
+	}
+
+	free(items);
+	return(ret);
+}
+
+
+
+
+/*------------------------------------*/
+/* Number of items held by the sketch */
+/*------------------------------------*/
+
+size_t kll_retained(const kll_t *sk)
+{
+	unsigned int h;
+	size_t       n = 0;
+
+	for (h=0; h<sk->n_levels; ++h)
+		n += sk->size[h];
+
+	return(n);
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Portable (little endian) scalar encoding so */
+/* sketch files may be merged across stations  */
+/*---------------------------------------------*/
+
+static int put32(FILE *stream, uint32_t u)
+{
+	unsigned char b[4];
+
+	b[0] = u & 0xff;
+	b[1] = (u >> 8)  & 0xff;
+	b[2] = (u >> 16) & 0xff;
+	b[3] = (u >> 24) & 0xff;
+
+	return(fwrite(b,1,4,stream) == 4 ? 0 : -1);
+}
+
+static int get32(FILE *stream, uint32_t *u)
+{
+	unsigned char b[4];
+
+	if (fread(b,1,4,stream) != 4)
+		return(-1);
+
+	*u = (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+	return(0);
+}
+
+static int putf(FILE *stream, float f)
+{
+	uint32_t u;
+
+	(void)memcpy(&u,&f,4);
+	return(put32(stream,u));
+}
+
+static int getf(FILE *stream, float *f)
+{
+	uint32_t u;
+
+	if (get32(stream,&u) < 0)
+		return(-1);
+
+	(void)memcpy(f,&u,4);
+	return(0);
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Write set of n_sketches sketches to file path */
+/*-----------------------------------------------*/
+
+int kll_write_set(const char *path, const kll_t *sk, unsigned int n_sketches)
+{
+	unsigned int s,
+	             h,
+	             i;
+	int          ret     = 0;
+	FILE         *stream = (FILE *)NULL;
+
+	if ((stream = fopen(path,"w")) == (FILE *)NULL)
+		return(-1);
+
+	if (fwrite(KLL_MAGIC,1,4,stream) != 4 || put32(stream,KLL_FILE_VERSION) < 0 || put32(stream,n_sketches) < 0)
+		ret = -1;
+
+	for (s=0; ret == 0 && s<n_sketches; ++s) {
+		if (put32(stream,sk[s].k) < 0 || put32(stream,sk[s].n_levels) < 0                ||
+		    put32(stream,(uint32_t)(sk[s].n & 0xffffffff)) < 0 || put32(stream,(uint32_t)(sk[s].n >> 32)) < 0 ||
+		    putf(stream,sk[s].min) < 0 || putf(stream,sk[s].max) < 0) {
+			ret = -1;
+			break;
+		}
+
+		for (h=0; ret == 0 && h<sk[s].n_levels; ++h) {
+			if (put32(stream,sk[s].size[h]) < 0)
+				ret = -1;
+
+			for (i=0; ret == 0 && i<sk[s].size[h]; ++i)
+				ret = putf(stream,sk[s].level[h][i]);
+		}
+	}
+
+	if (fclose(stream) != 0)
+		ret = -1;
+
+	return(ret);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Read set of n_sketches sketches from file path, */
+/* merging them into sk                            */
+/*-------------------------------------------------*/
+
+int kll_read_set(const char *path, kll_t *sk, unsigned int n_sketches)
+{
+	unsigned int s,
+	             h,
+	             i;
+	uint32_t     version,
+	             n_file,
+	             k,
+	             n_levels,
+	             n_lo,
+	             n_hi,
+	             size;
+	float        v;
+	char         magic[4];
+	int          ret     = 0;
+	kll_t        tmp;
+	FILE         *stream = (FILE *)NULL;
+
+	if ((stream = fopen(path,"r")) == (FILE *)NULL)
+		return(-1);
+
+	if (fread(magic,1,4,stream) != 4 || strncmp(magic,KLL_MAGIC,4) != 0 ||
+	    get32(stream,&version) < 0   || version != KLL_FILE_VERSION      ||
+	    get32(stream,&n_file) < 0    || n_file != n_sketches) {
+		(void)fclose(stream);
+		return(-1);
+	}
+
+	for (s=0; ret == 0 && s<n_sketches; ++s) {
+		if (get32(stream,&k) < 0 || get32(stream,&n_levels) < 0 || n_levels == 0 || n_levels > KLL_MAX_LEVELS ||
+		    get32(stream,&n_lo) < 0 || get32(stream,&n_hi) < 0) {
+			ret = -1;
+			break;
+		}
+
+		kll_init(&tmp,k);
+		tmp.n_levels = n_levels;
+		tmp.n        = (unsigned long long)n_hi << 32 | n_lo;
+
+		if (getf(stream,&tmp.min) < 0 || getf(stream,&tmp.max) < 0)
+			ret = -1;
+
+		for (h=0; ret == 0 && h<n_levels; ++h) {
+			if (get32(stream,&size) < 0) {
+				ret = -1;
+				break;
+			}
+
+			for (i=0; ret == 0 && i<size; ++i) {
+				if ((ret = getf(stream,&v)) == 0)
+					ret = push(&tmp,h,v);
+			}
+		}
+
+		if (ret == 0)
+			ret = kll_merge(&sk[s],&tmp);
+
+		kll_free(&tmp);
+	}
+
+	(void)fclose(stream);
+	return(ret);
+}
@@ -0,0 +1,62 @@
+#ifndef __KLL_H__
+#define __KLL_H__
+
+/*---------------------------------------------
+ * Weatherboard mergeable quantile sketches
+ *
+ * KLL sketch (Karnin, Lang and Liberty 2016).
+ * Level h holds items of weight 2^h, level
+ * capacities shrink geometrically (by 2/3)
+ * from the top so the sketch is a few
+ * kilobytes regardless of stream length.
+ * Sketches merge level by level, so those
+ * from different files (or stations) combine
+ * into a single sketch.
+ *-------------------------------------------*/
+
+#include <stdio.h>
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define KLL_DEFAULT_K          200
+#define KLL_MAX_LEVELS         32
+#define KLL_MIN_CAPACITY       8
+#define KLL_MAGIC              "WBKL"
+#define KLL_FILE_VERSION       1
+
+
+/*--------*/
+/* Sketch */
+/*--------*/
+
+typedef struct {
+	unsigned int       k;
+	unsigned int       n_levels;
+	unsigned long long n;
+	float              min;
+	float              max;
+	float              *level[KLL_MAX_LEVELS];
+	unsigned int       size[KLL_MAX_LEVELS];
+	unsigned int       alloc[KLL_MAX_LEVELS];
+} kll_t;
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern void   kll_init     (kll_t *sk, unsigned int k);
+extern void   kll_free     (kll_t *sk);
+extern void   kll_reset    (kll_t *sk);
+extern int    kll_update   (kll_t *sk, float v);
+extern int    kll_merge    (kll_t *dst, const kll_t *src);
+extern double kll_quantile (const kll_t *sk, double q);
+extern size_t kll_retained (const kll_t *sk);
+
+extern int    kll_write_set(const char *path, const kll_t *sk, unsigned int n_sketches);
+extern int    kll_read_set (const char *path, kll_t *sk, unsigned int n_sketches);
+
+#endif //__KLL_H__
@@ -0,0 +1,225 @@
+/*---------------------------------------------
+ * Weatherboard log group commit
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "logbuf.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static const char *const sync_names[] = { "none", "batch", "rollover", (const char *)NULL };
+
+static double             period      = 0.0;           // secs (0 commit every cycle)
+static size_t             threshold   = 0;             // bytes (0 no size limit)
+static int                sync_policy = LOGBUF_SYNC_NONE;
+static double             committed   = (-1.0);        // Time of last commit
+static double             first       = (-1.0);        // First and latest sample times
+static double             latest      = (-1.0);
+static unsigned long      n_samples   = 0;
+static unsigned long      n_writes    = 0;
+static unsigned long      n_syncs     = 0;
+static unsigned long long n_bytes     = 0;
+
+
+
+
+/*-----------------------------------------------*/
+/* Parse batch specification:                    */
+/*                                               */
+/*    <period secs>[,<bytes>]                    */
+/*                                               */
+/* A batch is committed when either is reached;  */
+/* bytes is capped so a cycle's output always    */
+/* fits in the staging buffer                    */
+/*-----------------------------------------------*/
+
+int logbuf_parse_batch(const char *spec)
+{
+	double        secs;
+	unsigned long bytes = 0;
+	int           n;
+
+	if ((n = sscanf(spec,"%lf,%lu",&secs,&bytes)) < 1 || secs < 0.0 || (n == 2 && bytes == 0))
+		return(-1);
+
+	if (bytes > LOGBUF_SIZE - LOGBUF_MARGIN)
+		bytes = LOGBUF_SIZE - LOGBUF_MARGIN;
+
+	period    = secs;
+	threshold = (size_t)bytes;
+	return(0);
+}
+
+int logbuf_batching(void)
+{
+	return(period > 0.0 || threshold > 0 ? TRUE : FALSE);
+}
+
+
+
+
+/*-----------------------------------------*/
+/* Durability policy (none, batch or       */
+/* rollover). Returns -1 if name is not a  */
+/* policy                                  */
+/*-----------------------------------------*/
+
+int logbuf_set_sync(const char *name)
+{
+	int i;
+
+	for (i=0; sync_names[i] != (const char *)NULL; ++i) {
+		if (strcmp(name,sync_names[i]) == 0) {
+			sync_policy = i;
+			return(0);
+		}
+	}
+
+	return(-1);
+}
+
+int logbuf_sync(void)
+{
+	return(sync_policy);
+}
+
+const char *logbuf_sync_name(int policy)
+{
+	return(sync_names[policy]);
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Is a batch of staged bytes due for commit at     */
+/* time t (secs)? Without batching it always is;    */
+/* the staging buffer filling up forces a commit    */
+/*--------------------------------------------------*/
+
+int logbuf_due(size_t staged, double t)
+{
+	if (committed < 0.0)
+		committed = t;
+
+	if (logbuf_batching() == FALSE                 ||
+	    staged >= LOGBUF_SIZE - LOGBUF_MARGIN      ||
+	    (threshold > 0 && staged >= threshold)     ||
+	    (period > 0.0 && t - committed >= period)   ) {
+		committed = t;
+		return(TRUE);
+	}
+
+	return(FALSE);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Commit text to stream: anything stdio holds is  */
+/* flushed first, then text goes out with as few   */
+/* write calls as the kernel allows (normally one) */
+/*-------------------------------------------------*/
+
+int logbuf_write(FILE *stream, const char *text, size_t len)
+{
+	ssize_t n;
+
+	if (fflush(stream) != 0)
+		return(-1);
+
+	while (len > 0) {
+		++n_writes;
+
+		if ((n = write(fileno(stream),(const void *)text,len)) < 0) {
+			if (errno == EINTR)
+				continue;
+
+			return(-1);
+		}
+
+		text    += n;
+		len     -= (size_t)n;
+		n_bytes += (unsigned long long)n;
+	}
+
+	return(0);
+}
+
+
+
+
+/*-------------------------------------------*/
+/* Make stream's data durable. Streams which */
+/* cannot be synced (pipes, terminals) are   */
+/* not counted                               */
+/*-------------------------------------------*/
+
+int logbuf_datasync(FILE *stream)
+{
+	if (fflush(stream) != 0 || fdatasync(fileno(stream)) != 0)
+		return(-1);
+
+	++n_syncs;
+	return(0);
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Count a sample (taken at t secs) published */
+/* to the log                                 */
+/*--------------------------------------------*/
+
+void logbuf_sample(double t)
+{
+	if (first < 0.0)
+		first = t;
+
+	latest = t;
+	++n_samples;
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Cost of the policy: write and sync calls per */
+/* hour (of sampling) and bytes per sample      */
+/*----------------------------------------------*/
+
+void logbuf_report(FILE *stream)
+{
+	double hours = (latest - first) / 3600.0;
+
+	if (n_samples == 0)
+		return;
+
+	(void)fprintf(stream,"    log: batch %.3f secs",period);
+	if (threshold > 0)
+		(void)fprintf(stream," or %lu bytes",(unsigned long)threshold);
+
+	(void)fprintf(stream,", sync %s: %lu samples, %llu bytes (%.1f bytes/sample), %lu writes, %lu syncs",
+	                     sync_names[sync_policy],n_samples,n_bytes,(double)n_bytes/(double)n_samples,n_writes,n_syncs);
+
+	if (hours > 0.0)
+		(void)fprintf(stream," (%.1f syscalls/hour)",(double)(n_writes + n_syncs)/hours);
+
+	(void)fprintf(stream,"\n");
+}
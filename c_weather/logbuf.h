@@ -0,0 +1,51 @@
+#ifndef __LOGBUF_H__
+#define __LOGBUF_H__
+
+/*---------------------------------------------
+ * Weatherboard log group commit
+ *
+ * Records (and statistics summaries) are
+ * staged in memory and committed to the log
+ * with a single write once the batch is older
+ * than the batch period or bigger than the
+ * batch size, and always on rollover and
+ * shutdown. With no batch period every cycle
+ * is committed at once. Committed data may
+ * also be made durable with fdatasync: never,
+ * after every batch or only when a log file is
+ * closed. Write and sync calls, and bytes, are
+ * counted so the cost of a policy can be seen
+ * as syscalls/hour and bytes per sample.
+ *-------------------------------------------*/
+
+#include <stdio.h>
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define LOGBUF_SYNC_NONE       0
+#define LOGBUF_SYNC_BATCH      1
+#define LOGBUF_SYNC_ROLLOVER   2
+
+#define LOGBUF_SIZE            65536       // Staging buffer
+#define LOGBUF_MARGIN          8192        // Room kept for a cycle's output
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int           logbuf_parse_batch(const char *spec);
+extern int           logbuf_batching   (void);
+extern int           logbuf_set_sync   (const char *name);
+extern int           logbuf_sync       (void);
+extern const char   *logbuf_sync_name  (int policy);
+extern int           logbuf_due        (size_t staged, double t);
+extern int           logbuf_write      (FILE *stream, const char *text, size_t len);
+extern int           logbuf_datasync   (FILE *stream);
+extern void          logbuf_sample     (double t);
+extern void          logbuf_report     (FILE *stream);
+
+#endif //__LOGBUF_H__
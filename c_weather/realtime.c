@@ -0,0 +1,87 @@
+/*---------------------------------------------
+ * Weatherboard realtime (low jitter) mode
+ *-------------------------------------------*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "realtime.h"
+
+
+
+
+/*----------------------------------------*/
+/* Touch REALTIME_STACK bytes of stack so */
+/* it is mapped (and locked) up front     */
+/*----------------------------------------*/
+
+static void __attribute__((noinline)) prefault_stack(void)
+{
+	volatile unsigned char stack[REALTIME_STACK];
+
+	(void)memset((void *)stack,0,REALTIME_STACK);
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Map REALTIME_HEAP bytes of heap and hand   */
+/* it back to malloc (which keeps it, as trim */
+/* and mmap are disabled)                     */
+/*--------------------------------------------*/
+
+static void prefault_heap(void)
+{
+	unsigned char *heap = (unsigned char *)NULL;
+
+	if ((heap = (unsigned char *)malloc(REALTIME_HEAP)) == (unsigned char *)NULL)
+		return;
+
+	(void)memset((void *)heap,0,REALTIME_HEAP);
+	free(heap);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Put the calling thread into realtime mode.     */
+/* Returns a bit mask of the steps which failed   */
+/* (1 lock memory, 2 pin CPU, 4 SCHED_FIFO), 0 if */
+/* all succeeded                                  */
+/*------------------------------------------------*/
+
+int realtime_setup(int prio, int cpu)
+{
+	int                failed = 0;
+	cpu_set_t          cpus;
+	struct sched_param param;
+
+	(void)mallopt(M_TRIM_THRESHOLD,-1);
+	(void)mallopt(M_MMAP_MAX,0);
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+		failed |= 1;
+
+	prefault_stack();
+	prefault_heap();
+
+	if (cpu != REALTIME_NO_CPU) {
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu,&cpus);
+
+		if (sched_setaffinity(0,sizeof(cpus),&cpus) < 0)
+			failed |= 2;
+	}
+
+	param.sched_priority = prio;
+	if (sched_setscheduler(0,SCHED_FIFO,&param) < 0)
+		failed |= 4;
+
+	return(failed);
+}
@@ -0,0 +1,33 @@
+#ifndef __REALTIME_H__
+#define __REALTIME_H__
+
+/*---------------------------------------------
+ * Weatherboard realtime (low jitter) mode
+ *
+ * The calling (sampling) thread is run under
+ * SCHED_FIFO and pinned to one CPU. All
+ * memory is locked, and the stack and heap
+ * prefaulted (with malloc told never to give
+ * memory back) so sampling never page faults.
+ * Threads created beforehand (the log writer)
+ * keep normal priority.
+ *-------------------------------------------*/
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define REALTIME_DEFAULT_PRIO  50
+#define REALTIME_NO_CPU        (-1)
+#define REALTIME_STACK         (256*1024)
+#define REALTIME_HEAP          (4*1024*1024)
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int realtime_setup(int prio, int cpu);
+
+#endif //__REALTIME_H__
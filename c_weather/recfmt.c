@@ -0,0 +1,212 @@
+/*---------------------------------------------
+ * Weatherboard record formatter
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "recfmt.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FIELD_WIDTH    8
+#define FIXED_MAX      48      // Longest %8.2f of a float (3.4e38)
+#define MAX_SHIFT      32      // Larger exponents overflow 64 bit hundredths
+
+
+/*-------------------------------------------*/
+/* Record layout: literal text before each   */
+/* value, in record order                    */
+/*-------------------------------------------*/
+
+typedef struct {
+	const char   *text;
+	size_t       len;
+	unsigned int chan;
+} field_t;
+
+static const field_t layout[NCHANNELS] = { { "  uvi: ",            7,  CHAN_UVI         },
+                                           { "  vis: ",            7,  CHAN_VIS         },
+                                           { " lux  ir: ",         10, CHAN_IR          },
+                                           { " lux  temp: ",       12, CHAN_TEMPERATURE },
+                                           { " C  humidity: ",     14, CHAN_HUMIDITY    },
+                                           { " %  dew point ",     14, CHAN_DEW_POINT   },
+                                           { " C  pressure: ",     14, CHAN_PRESSURE    } };
+
+static const char   tail[]   = " hpa";
+static const size_t tail_len = 4;
+
+
+
+
+/*------------------------------------------*/
+/* Right justify len bytes of s in a field  */
+/* of FIELD_WIDTH (wider values overflow,   */
+/* as with printf)                          */
+/*------------------------------------------*/
+
+static int justify(char *buf, const char *s, int len)
+{
+	int pad = len < FIELD_WIDTH ? FIELD_WIDTH - len : 0;
+
+	(void)memset((void *)buf,' ',(size_t)pad);
+	(void)memcpy((void *)(buf + pad),(void *)s,(size_t)len);
+
+	return(pad + len);
+}
+
+
+
+
+/*---------------------------------------------------*/
+/* Render v as %8.2f into buf (at least FIXED_MAX    */
+/* bytes, not terminated). Returns the length.       */
+/* v = m * 2^e exactly, so the hundredths are        */
+/* m * 100 * 2^e rounded to nearest (ties to even)   */
+/*---------------------------------------------------*/
+
+int recfmt_fixed(char *buf, float v)
+{
+	int      e,
+	         k,
+	         negative;
+	uint32_t bits;
+	uint64_t n,
+	         q,
+	         rem,
+	         half;
+	char     digits[FIXED_MAX],
+	         *p = digits + FIXED_MAX;
+
+	(void)memcpy((void *)&bits,(void *)&v,sizeof(bits));
+
+	negative = (int)(bits >> 31);
+	e        = (int)((bits >> 23) & 0xff);
+	n        = (uint64_t)(bits & 0x7fffff);
+
+
+	/*---------------------------------*/
+	/* nan and inf (glibc spelling)    */
+	/*---------------------------------*/
+
+	if (e == 0xff) {
+		if (n != 0)
+			return(justify(buf,negative != 0 ? "-nan" : "nan",negative != 0 ? 4 : 3));
+
+		return(justify(buf,negative != 0 ? "-inf" : "inf",negative != 0 ? 4 : 3));
+	}
+
+	if (e == 0)
+		e = (-149);              // Denormal
+	else {
+		n |= 0x800000;
+		e -= 150;
+	}
+
+	n *= 100;
+
+
+	/*-----------------------------------------*/
+	/* Too large for 64 bit hundredths - rare, */
+	/* so leave it to printf                   */
+	/*-----------------------------------------*/
+
+	if (e > MAX_SHIFT) {
+		(void)snprintf(digits,FIXED_MAX,"%8.2f",(double)v);
+		k = (int)strlen(digits);
+		(void)memcpy((void *)buf,(void *)digits,(size_t)k);
+
+		return(k);
+	}
+
+	if (e >= 0)
+		q = n << e;
+	else if ((k = -e) >= 64)
+		q = 0;
+	else {
+		q    = n >> k;
+		rem  = n & ((1ULL << k) - 1);
+		half = 1ULL << (k - 1);
+
+		if (rem > half || (rem == half && (q & 1) != 0))
+			++q;
+	}
+
+
+	/*---------------------------------------*/
+	/* Digits, least significant first (the  */
+	/* sign is kept even if the value rounds */
+	/* to zero, as printf does)              */
+	/*---------------------------------------*/
+
+	*--p = (char)('0' + q % 10);
+	q   /= 10;
+	*--p = (char)('0' + q % 10);
+	q   /= 10;
+	*--p = '.';
+
+	do {
+		*--p = (char)('0' + q % 10);
+		q   /= 10;
+	} while (q != 0);
+
+	if (negative != 0)
+		*--p = '-';
+
+	return(justify(buf,p,(int)(digits + FIXED_MAX - p)));
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Append len bytes of s if there is room     */
+/*--------------------------------------------*/
+
+static int append(char *buf, size_t size, size_t *at, const char *s, size_t len)
+{
+	if (*at + len >= size)
+		return(-1);
+
+	(void)memcpy((void *)(buf + *at),(void *)s,len);
+	*at += len;
+
+	return(0);
+}
+
+
+
+
+/*-----------------------------------------------------*/
+/* Render record (as RECFMT_PRINTF) into buf of size   */
+/* bytes, terminated. Returns the length, or -1 if it  */
+/* does not fit                                        */
+/*-----------------------------------------------------*/
+
+int recfmt_record(char *buf, size_t size, const char *datetime, const float *value, const char *fields, const char *marker)
+{
+	unsigned int c;
+	size_t       at = 0;
+
+	if (append(buf,size,&at,datetime,strlen(datetime)) < 0)
+		return(-1);
+
+	for (c=0; c<NCHANNELS; ++c) {
+		if (append(buf,size,&at,layout[c].text,layout[c].len) < 0 || at + FIXED_MAX >= size)
+			return(-1);
+
+		at += (size_t)recfmt_fixed(buf + at,value[layout[c].chan]);
+	}
+
+	if (append(buf,size,&at,tail,tail_len)            < 0 ||
+	    append(buf,size,&at,fields,strlen(fields))    < 0 ||
+	    append(buf,size,&at,marker,strlen(marker))    < 0 ||
+	    append(buf,size,&at,"\n",1)                   < 0  )
+		return(-1);
+
+	buf[at] = '\0';
+	return((int)at);
+}
@@ -0,0 +1,36 @@
+#ifndef __RECFMT_H__
+#define __RECFMT_H__
+
+/*---------------------------------------------
+ * Weatherboard record formatter
+ *
+ * Renders a sample record into a caller
+ * buffer without stdio: the literal parts of
+ * the record come from a fixed field layout
+ * and each value is converted to %8.2f with
+ * integer arithmetic on its (float) mantissa
+ * and exponent, rounding exactly as printf
+ * does (to nearest, ties to even), so output
+ * is byte-identical to RECFMT_PRINTF.
+ *-------------------------------------------*/
+
+#include <stddef.h>
+#include "channels.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define RECFMT_SIZE            1024    // Record buffer (room for a record with 256 byte extra fields)
+#define RECFMT_PRINTF          "%s  uvi: %8.2f  vis: %8.2f lux  ir: %8.2f lux  temp: %8.2f C  humidity: %8.2f %%  dew point %8.2f C  pressure: %8.2f hpa%s%s\n"
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int recfmt_fixed (char *buf, float v);
+extern int recfmt_record(char *buf, size_t size, const char *datetime, const float *value, const char *fields, const char *marker);
+
+#endif //__RECFMT_H__
@@ -0,0 +1,590 @@
+/*---------------------------------------------
+ * Weatherboard log rotation thread
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <zlib.h>
+#include "logbuf.h"
+#include "rotate.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+
+#define JOB_PREOPEN            0
+#define JOB_RENAME             1
+#define JOB_RETIRE             2
+#define JOB_DISCARD            3
+
+#define ROTATED_GROW           64
+
+
+/*-----*/
+/* Job */
+/*-----*/
+
+typedef struct {
+	int  op;
+	FILE *stream;
+	char base[ROTATE_PATH];
+	char path[ROTATE_PATH];
+} rotjob_t;
+
+
+/*-------------------------------*/
+/* Rotated file (retention scan) */
+/*-------------------------------*/
+
+typedef struct {
+	char               name[NAME_MAX + 1];
+	struct timespec    mtime;
+	unsigned long long size;
+} rotated_t;
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static rotjob_t           job[ROTATE_JOBS];
+static unsigned int       head         = 0;
+static unsigned int       tail         = 0;
+static int                busy         = FALSE;
+static int                running      = FALSE;
+static int                do_compress  = FALSE;
+static unsigned int       keep_n       = 0;          // 0 no limit
+static unsigned long long keep_size    = 0;          // 0 no limit
+static FILE               *spare       = (FILE *)NULL;
+static char               spare_base[ROTATE_PATH];   // Base the spare was opened for
+static char               active[ROTATE_PATH];       // Log file being written (never expired)
+static char               active_base[ROTATE_PATH];
+static unsigned long      n_compressed = 0;
+static unsigned long      n_expired    = 0;
+static unsigned long      n_archived   = 0;
+static rotate_archive_t   archiver     = (rotate_archive_t)NULL;
+static pthread_t          rotator;
+static pthread_mutex_t    lock         = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     posted       = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t     done         = PTHREAD_COND_INITIALIZER;
+
+
+
+
+/*--------------------------------------------*/
+/* Queue a job (waits if the queue is full,   */
+/* which only a burst of rollovers can cause) */
+/*--------------------------------------------*/
+
+static void submit(int op, FILE *stream, const char *base, const char *path)
+{
+	rotjob_t *j = (rotjob_t *)NULL;
+
+	(void)pthread_mutex_lock(&lock);
+	while (tail - head == ROTATE_JOBS)
+		(void)pthread_cond_wait(&done,&lock);
+
+	j         = &job[tail % ROTATE_JOBS];
+	j->op     = op;
+	j->stream = stream;
+
+	(void)snprintf(j->base,ROTATE_PATH,"%s",base == (const char *)NULL ? "" : base);
+	(void)snprintf(j->path,ROTATE_PATH,"%s",path == (const char *)NULL ? "" : path);
+
+	++tail;
+	(void)pthread_cond_signal(&posted);
+	(void)pthread_mutex_unlock(&lock);
+}
+
+
+
+
+/*-------------------------------------------*/
+/* gzip path to path.gz and remove path. As  */
+/* with gzip, path.gz keeps path's times (so */
+/* retention sees when it was last written). */
+/* Returns -1 on error                       */
+/*-------------------------------------------*/
+
+static int compress_file(const char *path)
+{
+	int             n,
+	                status                  = 0;
+	char            gzname[ROTATE_PATH + 4] = "",
+	                buf[ROTATE_BLOCK];
+	FILE            *in            = (FILE *)NULL;
+	gzFile          out;
+	struct stat     st;
+	struct timespec times[2];
+
+	(void)snprintf(gzname,sizeof(gzname),"%s.gz",path);
+
+	if ((in = fopen(path,"r")) == (FILE *)NULL)
+		return(-1);
+
+	if (fstat(fileno(in),&st) != 0) {
+		(void)fclose(in);
+		return(-1);
+	}
+
+	if ((out = gzopen(gzname,"wb6")) == (gzFile)NULL) {
+		(void)fclose(in);
+		return(-1);
+	}
+
+	while ((n = (int)fread(buf,1,ROTATE_BLOCK,in)) > 0) {
+		if (gzwrite(out,buf,(unsigned int)n) != n) {
+			status = (-1);
+			break;
+		}
+	}
+
+	if (ferror(in) != 0)
+		status = (-1);
+
+	(void)fclose(in);
+
+	if (gzclose(out) != Z_OK)
+		status = (-1);
+
+	if (status < 0)
+		(void)unlink(gzname);
+	else {
+		times[0] = st.st_atim;
+		times[1] = st.st_mtim;
+		(void)utimensat(AT_FDCWD,gzname,times,0);
+
+		(void)unlink(path);
+		++n_compressed;
+	}
+
+	return(status);
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Oldest first, by modification time (names   */
+/* have day names in them, so do not sort)     */
+/*---------------------------------------------*/
+
+static int older(const void *a, const void *b)
+{
+	const rotated_t *ra = (const rotated_t *)a,
+	                *rb = (const rotated_t *)b;
+
+	if (ra->mtime.tv_sec != rb->mtime.tv_sec)
+		return(ra->mtime.tv_sec < rb->mtime.tv_sec ? (-1) : 1);
+
+	if (ra->mtime.tv_nsec != rb->mtime.tv_nsec)
+		return(ra->mtime.tv_nsec < rb->mtime.tv_nsec ? (-1) : 1);
+
+	return(strcmp(ra->name,rb->name));
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Is a rotated file (named name) still queued to */
+/* be retired (archived and compressed)?          */
+/*------------------------------------------------*/
+
+static int queued(const char *name)
+{
+	unsigned int i;
+	int          found = FALSE;
+	char         pathbuf[ROTATE_PATH];
+
+	(void)pthread_mutex_lock(&lock);
+
+	for (i=head; i != tail && found == FALSE; ++i) {
+		if (job[i % ROTATE_JOBS].op == JOB_RETIRE) {
+			(void)strcpy(pathbuf,job[i % ROTATE_JOBS].path);
+			found = strcmp(basename(pathbuf),name) == 0 ? TRUE : FALSE;
+		}
+	}
+
+	(void)pthread_mutex_unlock(&lock);
+	return(found);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Remove the oldest rotated files of base (named  */
+/* <base>.<date>[.gz], not the active file, the    */
+/* spare, sketch files or files still queued to be */
+/* retired) until at most keep_n of them, and      */
+/* keep_size bytes, are left. A removed file's     */
+/* sketches go with it                             */
+/*-------------------------------------------------*/
+
+static void expire(const char *base)
+{
+	int                i,
+	                   n        = 0,
+	                   size     = 0,
+	                   len;
+	unsigned long long total    = 0;
+	char               dirbuf[ROTATE_PATH]     = "",
+	                   filebuf[ROTATE_PATH]    = "",
+	                   activebuf[ROTATE_PATH]  = "",
+	                   path[ROTATE_PATH + 512] = "",
+	                   *dir,
+	                   *file,
+	                   *current;
+	rotated_t          *rotated = (rotated_t *)NULL,
+	                   *grown;
+	DIR                *dirp    = (DIR *)NULL;
+	struct dirent      *entry;
+	struct stat        st;
+
+	if (keep_n == 0 && keep_size == 0)
+		return;
+
+	(void)snprintf(dirbuf,ROTATE_PATH,"%s",base);
+	(void)snprintf(filebuf,ROTATE_PATH,"%s",base);
+
+	(void)pthread_mutex_lock(&lock);
+	(void)strcpy(activebuf,active);
+	(void)pthread_mutex_unlock(&lock);
+
+	dir     = dirname(dirbuf);
+	file    = basename(filebuf);
+	current = basename(activebuf);
+	len     = (int)strlen(file);
+
+	if ((dirp = opendir(dir)) == (DIR *)NULL)
+		return;
+
+	while ((entry = readdir(dirp)) != (struct dirent *)NULL) {
+		if (strncmp(entry->d_name,file,len) != 0 || entry->d_name[len] != '.' ||
+		    strcmp(entry->d_name + len,".next") == 0                          ||
+		    strstr(entry->d_name + len,".kll") != (char *)NULL                ||
+		    strcmp(entry->d_name,current) == 0                                ||
+		    queued(entry->d_name) == TRUE                                      )
+			continue;
+
+		(void)snprintf(path,sizeof(path),"%s/%s",dir,entry->d_name);
+
+		if (stat(path,&st) != 0 || S_ISREG(st.st_mode) == 0)
+			continue;
+
+		if (n == size) {
+			if ((grown = (rotated_t *)realloc((void *)rotated,(size + ROTATED_GROW)*sizeof(rotated_t))) == (rotated_t *)NULL)
+				break;
+
+			rotated = grown;
+			size   += ROTATED_GROW;
+		}
+
+		(void)snprintf(rotated[n].name,NAME_MAX + 1,"%s",entry->d_name);
+		rotated[n].mtime = st.st_mtim;
+		rotated[n].size  = (unsigned long long)st.st_size;
+		total           += rotated[n].size;
+		++n;
+	}
+
+	(void)closedir(dirp);
+
+	if (n > 0)
+		qsort((void *)rotated,(size_t)n,sizeof(rotated_t),older);
+
+	for (i=0; i<n; ++i) {
+		if ((keep_n == 0 || (unsigned int)(n - i) <= keep_n) && (keep_size == 0 || total <= keep_size))
+			break;
+
+		(void)snprintf(path,sizeof(path),"%s/%s",dir,rotated[i].name);
+		if (unlink(path) == 0)
+			++n_expired;
+
+		total -= rotated[i].size;
+
+		if ((len = (int)strlen(path)) > 3 && strcmp(path + len - 3,".gz") == 0)
+			path[len - 3] = '\0';
+
+		(void)strcat(path,".kll");
+		(void)unlink(path);
+	}
+
+	free((void *)rotated);
+}
+
+
+
+
+/*------------------------------------------*/
+/* Rotation thread (low priority): run jobs */
+/* in order                                 */
+/*------------------------------------------*/
+
+static void *rotate_jobs(void *arg)
+{
+	int      ready;
+	rotjob_t j;
+	char     name[ROTATE_PATH + 8] = "";
+	FILE     *stream               = (FILE *)NULL;
+
+	(void)arg;
+	(void)setpriority(PRIO_PROCESS,(id_t)syscall(SYS_gettid),ROTATE_NICE);
+
+	while (1) {
+		(void)pthread_mutex_lock(&lock);
+		while (head == tail) {
+			busy = FALSE;
+			(void)pthread_cond_broadcast(&done);
+			(void)pthread_cond_wait(&posted,&lock);
+		}
+
+		busy = TRUE;
+		j    = job[head % ROTATE_JOBS];
+		++head;
+		(void)pthread_cond_broadcast(&done);
+		(void)pthread_mutex_unlock(&lock);
+
+		switch (j.op) {
+			case JOB_PREOPEN:
+				(void)pthread_mutex_lock(&lock);
+				ready  = spare != (FILE *)NULL && strcmp(spare_base,j.base) == 0 ? TRUE : FALSE;
+				stream = ready == FALSE ? spare : (FILE *)NULL;
+
+				if (stream != (FILE *)NULL) {
+					spare = (FILE *)NULL;
+					(void)snprintf(name,sizeof(name),"%s.next",spare_base);
+				}
+				(void)pthread_mutex_unlock(&lock);
+
+				if (ready == TRUE)
+					break;
+
+				if (stream != (FILE *)NULL) {
+					(void)fclose(stream);
+					(void)unlink(name);
+				}
+
+				(void)snprintf(name,sizeof(name),"%s.next",j.base);
+				if ((stream = fopen(name,"w")) != (FILE *)NULL) {
+					(void)pthread_mutex_lock(&lock);
+					spare = stream;
+					(void)snprintf(spare_base,ROTATE_PATH,"%s",j.base);
+					(void)pthread_mutex_unlock(&lock);
+				}
+				break;
+
+			case JOB_RENAME:
+				(void)snprintf(name,sizeof(name),"%s.next",j.base);
+				(void)rename(name,j.path);
+				break;
+
+			case JOB_RETIRE:
+				if (j.stream != (FILE *)NULL) {
+					if (logbuf_sync() == LOGBUF_SYNC_ROLLOVER)
+						(void)logbuf_datasync(j.stream);
+
+					(void)fclose(j.stream);
+				}
+
+				if (archiver != (rotate_archive_t)NULL && archiver(j.path) >= 0)
+					++n_archived;
+
+				if (do_compress == TRUE && (strlen(j.path) < 3 || strcmp(j.path + strlen(j.path) - 3,".gz") != 0))
+					(void)compress_file(j.path);
+
+				expire(j.base);
+				break;
+
+			case JOB_DISCARD:
+				(void)fclose(j.stream);
+				(void)snprintf(name,sizeof(name),"%s.next",j.base);
+				(void)unlink(name);
+				break;
+		}
+	}
+
+	return((void *)NULL);
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Start the rotation thread: compress (gzip) */
+/* rotated files if compress is TRUE, keeping */
+/* at most keep_files and keep_bytes of them  */
+/* (0 for no limit)                           */
+/*--------------------------------------------*/
+
+int rotate_start(int compress, unsigned int keep_files, unsigned long long keep_bytes)
+{
+	do_compress = compress;
+	keep_n      = keep_files;
+	keep_size   = keep_bytes;
+
+	if (pthread_create(&rotator,(pthread_attr_t *)NULL,rotate_jobs,(void *)NULL) != 0)
+		return(-1);
+
+	running = TRUE;
+	return(0);
+}
+
+int rotate_running(void)
+{
+	return(running);
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Have the next log file for base opened (as */
+/* <base>.next) ahead of the next rollover    */
+/*--------------------------------------------*/
+
+void rotate_prepare(const char *base)
+{
+	if (running == TRUE)
+		submit(JOB_PREOPEN,(FILE *)NULL,base,(const char *)NULL);
+}
+
+
+
+
+/*---------------------------------------------------*/
+/* Take the pre-opened log file for base, to become  */
+/* path (renamed in the background). Returns NULL if */
+/* there is none (so the caller opens path itself).  */
+/* A spare for another base (the log file was        */
+/* renamed) is discarded                             */
+/*---------------------------------------------------*/
+
+FILE *rotate_take(const char *base, const char *path)
+{
+	FILE *stream = (FILE *)NULL,
+	     *stale  = (FILE *)NULL;
+	char stale_base[ROTATE_PATH] = "";
+
+	if (running == FALSE)
+		return((FILE *)NULL);
+
+	(void)pthread_mutex_lock(&lock);
+	(void)snprintf(active,ROTATE_PATH,"%s",path);
+	(void)snprintf(active_base,ROTATE_PATH,"%s",base);
+
+	if (spare != (FILE *)NULL && strcmp(spare_base,base) == 0)
+		stream = spare;
+	else if (spare != (FILE *)NULL) {
+		stale = spare;
+		(void)strcpy(stale_base,spare_base);
+	}
+
+	spare = (FILE *)NULL;
+	(void)pthread_mutex_unlock(&lock);
+
+	if (stream != (FILE *)NULL)
+		submit(JOB_RENAME,(FILE *)NULL,base,path);
+
+	if (stale != (FILE *)NULL)
+		submit(JOB_DISCARD,stale,stale_base,(const char *)NULL);
+
+	return(stream);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Rotated out log file path (of the base last    */
+/* taken): close it (unless stream is NULL, it is */
+/* closed already), then compress and expire in   */
+/* the background                                 */
+/*------------------------------------------------*/
+
+void rotate_retire(FILE *stream, const char *path)
+{
+	char base[ROTATE_PATH] = "";
+
+	(void)pthread_mutex_lock(&lock);
+	(void)strcpy(base,active_base);
+	(void)pthread_mutex_unlock(&lock);
+
+	submit(JOB_RETIRE,stream,base,path);
+}
+
+void rotate_closed(const char *path)
+{
+	rotate_retire((FILE *)NULL,path);
+}
+
+
+
+
+/*------------------------------------------*/
+/* Archive rotated files with archiver (set */
+/* before the thread is started)            */
+/*------------------------------------------*/
+
+void rotate_archiver(rotate_archive_t fn)
+{
+	archiver = fn;
+}
+
+
+
+
+/*-------------------------------------------*/
+/* Finish outstanding jobs and remove the    */
+/* spare (not needed once the daemon exits)  */
+/*-------------------------------------------*/
+
+void rotate_stop(void)
+{
+	char name[ROTATE_PATH + 8] = "";
+
+	if (running == FALSE)
+		return;
+
+	(void)pthread_mutex_lock(&lock);
+	while (head != tail || busy == TRUE)
+		(void)pthread_cond_wait(&done,&lock);
+
+	if (spare != (FILE *)NULL) {
+		(void)fclose(spare);
+		(void)snprintf(name,sizeof(name),"%s.next",spare_base);
+		(void)unlink(name);
+
+		spare = (FILE *)NULL;
+	}
+	(void)pthread_mutex_unlock(&lock);
+}
+
+unsigned long rotate_compressed(void)
+{
+	return(n_compressed);
+}
+
+unsigned long rotate_expired(void)
+{
+	return(n_expired);
+}
+
+unsigned long rotate_archived(void)
+{
+	return(n_archived);
+}
@@ -0,0 +1,58 @@
+#ifndef __ROTATE_H__
+#define __ROTATE_H__
+
+/*---------------------------------------------
+ * Weatherboard log rotation thread
+ *
+ * Everything a rollover costs, other than
+ * switching streams, is done by a low priority
+ * background thread. It keeps the next log
+ * file open ahead of time (as <log>.next) so
+ * the switch needs no open, renames it once
+ * it has been taken, and closes, compresses
+ * (gzip) and expires rotated files: at most a
+ * given number of rotated files, and of bytes,
+ * are kept (oldest removed first). Rotated
+ * files may be archived first.
+ *-------------------------------------------*/
+
+#include <stdio.h>
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define ROTATE_PATH            512
+#define ROTATE_JOBS            16
+#define ROTATE_NICE            10
+#define ROTATE_BLOCK           65536
+
+
+/*----------------------------------------*/
+/* Archiver: called (on the rotation      */
+/* thread) with each rotated file before  */
+/* it is compressed. Returns -1 if it     */
+/* could not be archived                  */
+/*----------------------------------------*/
+
+typedef int (*rotate_archive_t)(const char *path);
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int           rotate_start     (int compress, unsigned int keep_files, unsigned long long keep_bytes);
+extern int           rotate_running   (void);
+extern void          rotate_prepare   (const char *base);
+extern FILE         *rotate_take      (const char *base, const char *path);
+extern void          rotate_retire    (FILE *stream, const char *path);
+extern void          rotate_closed    (const char *path);
+extern void          rotate_archiver  (rotate_archive_t fn);
+extern void          rotate_stop      (void);
+extern unsigned long rotate_compressed(void);
+extern unsigned long rotate_expired   (void);
+extern unsigned long rotate_archived  (void);
+
+#endif //__ROTATE_H__
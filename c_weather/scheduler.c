@@ -0,0 +1,339 @@
+/*---------------------------------------------
+ * Weatherboard absolute deadline scheduler
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/timerfd.h>
+#include "vclock.h"
+#include "scheduler.h"
+
+
+
+
+/*-----------------------------------------*/
+/* Wall clock time (ns since epoch), which */
+/* may be virtual                          */
+/*-----------------------------------------*/
+
+long long scheduler_now(void)
+{
+	return(vclock_now());
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Initialise scheduler. First deadline is the next */
+/* multiple of period (ns) since the epoch          */
+/*--------------------------------------------------*/
+
+void scheduler_init(scheduler_t *s, long long period)
+{
+	(void)memset((void *)s,0,sizeof(scheduler_t));
+
+	s->fd        = (-1);
+	s->period    = period;
+	s->next      = (scheduler_now() / period + 1) * period;
+	s->warned_at = s->next;
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Change period (ns), realigning the next        */
+/* deadline to it. Counts so far are kept         */
+/*------------------------------------------------*/
+
+void scheduler_set_period(scheduler_t *s, long long period)
+{
+	s->period      = period;
+	s->next        = (scheduler_now() / period + 1) * period;
+	s->rescheduled = 1;
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Timer fd expiring at each deadline (for use  */
+/* with an event loop). Returns -1 on error     */
+/*----------------------------------------------*/
+
+int scheduler_timerfd(scheduler_t *s)
+{
+	s->fd = timerfd_create(CLOCK_REALTIME,TFD_NONBLOCK | TFD_CLOEXEC);
+	return(s->fd);
+}
+
+
+
+
+/*-------------------------------------------------------*/
+/* Arm for the next deadline, returning it (ns since the */
+/* epoch). If the last cycle overran, the next cycle is  */
+/* due at once (late) and any deadlines which have       */
+/* passed entirely are dropped                           */
+/*-------------------------------------------------------*/
+
+long long scheduler_arm(scheduler_t *s)
+{
+	long long         now,
+	                  busy,
+	                  missed;
+	struct itimerspec tspec;
+
+	now = scheduler_now();
+
+
+	/*--------------------------------------*/
+	/* Cycle time (since the last deadline) */
+	/*--------------------------------------*/
+
+	if (s->cycles > 0 && s->rescheduled == 0) {
+		busy         = now - (s->next - s->period);
+		s->busy_sum += (double)busy;
+		++s->busy_n;
+
+		if (busy > s->busy_max)
+			s->busy_max = busy;
+	}
+
+	s->rescheduled = 0;
+
+
+	/*---------*/
+	/* Overrun */
+	/*---------*/
+
+	if (now >= s->next + s->period) {
+		missed      = (now - s->next) / s->period;
+		s->dropped += (unsigned long)missed;
+		s->next    += missed * s->period;
+	}
+
+	if (now > s->next)
+		++s->late;
+
+	if (s->fd >= 0) {
+		tspec.it_interval.tv_sec  = 0;
+		tspec.it_interval.tv_nsec = 0;
+		tspec.it_value.tv_sec     = (time_t)(s->next / NSECS_PER_SEC);
+		tspec.it_value.tv_nsec    = (long)(s->next % NSECS_PER_SEC);
+
+		(void)timerfd_settime(s->fd,TFD_TIMER_ABSTIME,&tspec,(struct itimerspec *)NULL);
+	}
+
+	return(s->next);
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Latency histogram bucket: 1 us wide up to 100 */
+/* us, then 10 us to 1 ms, 100 us to 10 ms and   */
+/* 1 ms to 100 ms (last bucket is overflow)      */
+/*-----------------------------------------------*/
+
+static unsigned int bucket(long long late)
+{
+	long long us = late < 0 ? 0 : late / 1000;
+
+	if (us < 100)
+		return((unsigned int)us);
+	else if (us < 1000)
+		return((unsigned int)(100 + (us - 100)  / 10));
+	else if (us < 10000)
+		return((unsigned int)(190 + (us - 1000) / 100));
+	else if (us < 100000)
+		return((unsigned int)(280 + (us - 10000) / 1000));
+
+	return(SCHEDULER_HIST_BUCKETS - 1);
+}
+
+static long long bucket_top(unsigned int b)
+{
+	long long us;
+
+	if (b < 100)
+		us = b + 1;
+	else if (b < 190)
+		us = 100   + (b - 99)  * 10;
+	else if (b < 280)
+		us = 1000  + (b - 189) * 100;
+	else
+		us = 10000 + (b - 279) * 1000;
+
+	return(us * 1000);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Deadline reached: account wakeup latency and    */
+/* step to the next deadline. Returns the deadline */
+/*-------------------------------------------------*/
+
+static long long woke(scheduler_t *s)
+{
+	long long deadline = s->next,
+	          late;
+
+	late = scheduler_now() - deadline;
+
+	if (s->cycles == 0 || late < s->late_min)
+		s->late_min = late;
+
+	if (s->cycles == 0 || late > s->late_max)
+		s->late_max = late;
+
+	s->late_sum  += (double)late;
+	s->late_sum2 += (double)late * (double)late;
+	++s->hist[bucket(late)];
+	++s->cycles;
+
+	s->next = deadline + s->period;
+	return(deadline);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Timer fd readable. Returns the deadline which  */
+/* expired or -1 if the timer has not expired     */
+/*------------------------------------------------*/
+
+long long scheduler_expired(scheduler_t *s)
+{
+	uint64_t expirations;
+
+	if (read(s->fd,&expirations,sizeof(expirations)) != sizeof(expirations))
+		return(-1);
+
+	return(woke(s));
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Virtual time: jump the clock straight to the   */
+/* next deadline. Returns the deadline            */
+/*------------------------------------------------*/
+
+long long scheduler_advance(scheduler_t *s)
+{
+	vclock_advance_to(s->next);
+	return(woke(s));
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Wakeup latency (ns) q quantile (upper edge  */
+/* of its histogram bucket, at most the max)   */
+/*---------------------------------------------*/
+
+long long scheduler_percentile(const scheduler_t *s, double q)
+{
+	unsigned int  b;
+	unsigned long cum = 0;
+	long long     top;
+
+	if (s->cycles == 0)
+		return(0);
+
+	for (b=0; b<SCHEDULER_HIST_BUCKETS; ++b) {
+		cum += s->hist[b];
+
+		if ((double)cum >= q * (double)s->cycles)
+			break;
+	}
+
+	if (b >= SCHEDULER_HIST_BUCKETS - 1 || (top = bucket_top(b)) > s->late_max)
+		return(s->late_max);
+
+	return(top);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Report cycle count, late/dropped cycles, cycle */
+/* time (against the period budget) and jitter    */
+/*------------------------------------------------*/
+
+void scheduler_report(const scheduler_t *s, FILE *stream)
+{
+	double mean = 0.0,
+	       sd   = 0.0,
+	       busy = 0.0;
+
+	if (s->cycles > 0) {
+		mean = s->late_sum / (double)s->cycles;
+		sd   = sqrt(fabs(s->late_sum2 / (double)s->cycles - mean*mean));
+	}
+
+	if (s->busy_n > 0)
+		busy = s->busy_sum / (double)s->busy_n;
+
+	(void)fprintf(stream,"    scheduler: %lu cycles, %lu late, %lu dropped, cycle time mean %.1f us max %.1f us (budget %.1f us)\n",
+	                                                                                                             s->cycles,
+	                                                                                                               s->late,
+	                                                                                                            s->dropped,
+	                                                                                                           busy/1000.0,
+	                                                                                                 (double)s->busy_max/1000.0,
+	                                                                                                  (double)s->period/1000.0);
+	(void)fprintf(stream,"    scheduler: wakeup latency min %.1f us mean %.1f us max %.1f us (sd %.1f us)\n",
+	                                                                                                 (double)s->late_min/1000.0,
+	                                                                                                           mean/1000.0,
+	                                                                                                 (double)s->late_max/1000.0,
+	                                                                                                             sd/1000.0);
+	(void)fprintf(stream,"    scheduler: wakeup latency p50 %.0f us p90 %.0f us p99 %.0f us p99.9 %.0f us\n",
+	                                                                        (double)scheduler_percentile(s,0.5)/1000.0,
+	                                                                        (double)scheduler_percentile(s,0.9)/1000.0,
+	                                                                       (double)scheduler_percentile(s,0.99)/1000.0,
+	                                                                      (double)scheduler_percentile(s,0.999)/1000.0);
+	(void)fflush(stream);
+}
+
+
+
+
+/*---------------------------------------------------*/
+/* Warn (at most every SCHEDULER_WARN_PERIOD) if any */
+/* cycles were late or dropped since the last        */
+/* warning                                           */
+/*---------------------------------------------------*/
+
+void scheduler_lagging(scheduler_t *s, FILE *stream)
+{
+	long long now;
+
+	if (s->late == s->warned_late && s->dropped == s->warned_dropped)
+		return;
+
+	if ((now = scheduler_now()) - s->warned_at < SCHEDULER_WARN_PERIOD)
+		return;
+
+	(void)fprintf(stream,"    weatherboard WARNING: can't keep up, %lu late and %lu dropped cycles in the last %.1f seconds\n",
+	                                                                                   s->late    - s->warned_late,
+	                                                                                   s->dropped - s->warned_dropped,
+	                                                                     (double)(now - s->warned_at)/(double)NSECS_PER_SEC);
+	(void)fflush(stream);
+
+	s->warned_late    = s->late;
+	s->warned_dropped = s->dropped;
+	s->warned_at      = now;
+}
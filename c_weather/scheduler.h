@@ -0,0 +1,82 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+/*---------------------------------------------
+ * Weatherboard absolute deadline scheduler
+ *
+ * Deadlines are multiples of the period since
+ * the (wall clock) epoch, so samples land on
+ * :00, :01 ... and boards on different hosts
+ * line up. The timer is armed for an absolute
+ * deadline (TFD_TIMER_ABSTIME) so time spent
+ * acquiring and writing does not accumulate
+ * as drift.
+ *
+ * A cycle which overruns its budget (the
+ * period) makes the next one late (started
+ * straight away, after its deadline); any
+ * deadlines which passed entirely are dropped.
+ *
+ * Deadlines are waited for in the event loop,
+ * on a timer fd armed for each one in turn.
+ * Under time warp the (virtual) clock is
+ * jumped to each deadline instead
+ * (scheduler_advance).
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <time.h>
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define NSECS_PER_SEC          1000000000LL
+#define NSECS_PER_MSEC         1000000LL
+#define SCHEDULER_WARN_PERIOD  (10*NSECS_PER_SEC)
+#define SCHEDULER_HIST_BUCKETS 371     // Wakeup latency histogram (log-linear, 1 us - 100 ms)
+
+
+/*-----------------*/
+/* Scheduler state */
+/*-----------------*/
+
+typedef struct {
+	int           fd;             // Timer fd (-1 if not used)
+	long long     period;         // ns
+	long long     next;           // Next deadline (ns since epoch)
+	unsigned long cycles;
+	unsigned long late;           // Cycles started after their deadline
+	unsigned long dropped;        // Deadlines skipped altogether
+	long long     late_min;       // Wakeup latency (ns)
+	long long     late_max;
+	double        late_sum;
+	double        late_sum2;
+	long long     busy_max;       // Cycle time (deadline to next wait, ns)
+	double        busy_sum;
+	unsigned long busy_n;
+	int           rescheduled;    // Period changed (no cycle time for this arm)
+	unsigned long hist[SCHEDULER_HIST_BUCKETS];
+	unsigned long warned_late;    // Counts at last lagging warning
+	unsigned long warned_dropped;
+	long long     warned_at;
+} scheduler_t;
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern long long scheduler_now    (void);
+extern void      scheduler_init   (scheduler_t *s, long long period);
+extern void      scheduler_set_period(scheduler_t *s, long long period);
+extern int       scheduler_timerfd(scheduler_t *s);
+extern long long scheduler_arm    (scheduler_t *s);
+extern long long scheduler_expired(scheduler_t *s);
+extern long long scheduler_advance(scheduler_t *s);
+extern long long scheduler_percentile(const scheduler_t *s, double q);
+extern void      scheduler_report (const scheduler_t *s, FILE *stream);
+extern void      scheduler_lagging(scheduler_t *s, FILE *stream);
+
+#endif //__SCHEDULER_H__
@@ -20,12 +20,26 @@
 #define TRUE   255
 extern int     do_verbose;
 
+#define POLL_USECS             500
+#define READY_TIMEOUT          25000
+
+#define CHIPSTAT_SLEEP         0x01
+#define IRQSTAT_ALS            0x01
+
 
 /*------------------*/
 /* Global variables */
 /*------------------*/
 
-int si1132Fd;
+int si1132Fd = (-1);
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static int sampled   = FALSE;
+static int io_errors = 0;          // Failed transfers since last Si1132_failed()
 
 
 
@@ -33,10 +47,40 @@ int si1132Fd;
 /* Functions */
 /*-----------*/
 
+/*---------------------------------------------*/
+/* Poll register reg (every POLL_USECS) until  */
+/* (value & mask) == want, or (if want is      */
+/* negative) until it is non zero. Returns -1  */
+/* on timeout                                  */
+/*---------------------------------------------*/
+
+static int poll_register(unsigned char reg, unsigned char mask, int want)
+{
+	unsigned char value;
+	long          waited = 0;
+
+	while (1) {
+		value = Si1132_I2C_read8(reg) & mask;
+
+		if ((want < 0 && value != 0) || (want >= 0 && value == want))
+			return(0);
+
+		if (waited >= READY_TIMEOUT)
+			return(-1);
+
+		(void)usleep(POLL_USECS);
+		waited += POLL_USECS;
+	}
+}
+
 int si1132_begin(const char *device)
 {
 	int status = 0;
 
+	// re-probe: drop the old session
+	if (si1132Fd >= 0)
+		(void)close(si1132Fd);
+
 	si1132Fd = open(device, O_RDWR);
 	if (si1132Fd < 0) {
 
@@ -45,7 +89,7 @@ int si1132_begin(const char *device)
 			(void)fflush(stderr);
 		}
 
-		exit(-1);
+		return(-1);
 	}
 
 	status = ioctl(si1132Fd, I2C_SLAVE, Si1132_ADDR);
@@ -57,8 +101,9 @@ int si1132_begin(const char *device)
 		}
 
 		(void)close(si1132Fd);
+		si1132Fd = (-1);
 
-		exit(-1);
+		return(-1);
 	}
 
 	if (Si1132_I2C_read8(Si1132_REG_PARTID) != 0x32) {
@@ -68,10 +113,16 @@ int si1132_begin(const char *device)
 			(void)fflush(stderr);
 		}
 
-		exit(-1);
+		(void)close(si1132Fd);
+		si1132Fd = (-1);
+
+		return(-1);
 	}
 
+	io_errors = 0;
 	initialize();
+
+	return(Si1132_failed() == TRUE ? -1 : 0);
 }
 
 void initialize(void)
@@ -90,32 +141,28 @@ void initialize(void)
 	Si1132_I2C_write8(Si1132_REG_IRQEN, Si1132_REG_IRQEN_ALSEVERYSAMPLE);
 
 	Si1132_I2C_writeParam(Si1132_PARAM_ALSIRADCMUX, Si1132_PARAM_ADCMUX_SMALLIR);
-	(void)usleep(10000);
 
 	// fastest clocks, clock div 1
 	Si1132_I2C_writeParam(Si1132_PARAM_ALSIRADCGAIN, 0);
-	(void)usleep(10000);
 
 	// take 511 clocks to measure
 	Si1132_I2C_writeParam(Si1132_PARAM_ALSIRADCCOUNTER, Si1132_PARAM_ADCCOUNTER_511CLK);
 
 	// in high range mode
 	Si1132_I2C_writeParam(Si1132_PARAM_ALSIRADCMISC, Si1132_PARAM_ALSIRADCMISC_RANGE);
-	usleep(10000);
 
 	// fastest clocks
 	Si1132_I2C_writeParam(Si1132_PARAM_ALSVISADCGAIN, 0);
-	usleep(10000);
 
 	// take 511 clocks to measure
 	Si1132_I2C_writeParam(Si1132_PARAM_ALSVISADCCOUNTER, Si1132_PARAM_ADCCOUNTER_511CLK);
 
 	//in high range mode (not normal signal)
 	Si1132_I2C_writeParam(Si1132_PARAM_ALSVISADCMISC, Si1132_PARAM_ALSVISADCMISC_VISRANGE);
-	usleep(10000);
 
 	Si1132_I2C_write8(Si1132_REG_MEASRATE0, 0xFF);
 	Si1132_I2C_write8(Si1132_REG_COMMAND,   Si1132_ALS_AUTO);
+	sampled = FALSE;
 }
 
 void reset(void)
@@ -128,17 +175,37 @@ void reset(void)
 	Si1132_I2C_write8(Si1132_REG_INTCFG,    0);
 	Si1132_I2C_write8(Si1132_REG_IRQSTAT,   0xFF);
 
+	// wait for the reset to complete (chip back asleep) and the key to be taken
 	Si1132_I2C_write8(Si1132_REG_COMMAND, Si1132_RESET);
-	(void)usleep(10000);
+	(void)usleep(POLL_USECS);
+	(void)poll_register(Si1132_REG_CHIPSTAT, CHIPSTAT_SLEEP, CHIPSTAT_SLEEP);
+
 	Si1132_I2C_write8(Si1132_REG_HWKEY, 0x17);
+	(void)poll_register(Si1132_REG_HWKEY, 0xFF, 0x17);
+}
+
 
-	(void)usleep(10000);
+/*--------------------------------------------*/
+/* Data registers are only valid once the     */
+/* first autonomous measurement has completed */
+/* (after that they always hold the latest)   */
+/*--------------------------------------------*/
+
+static void wait_sample(void)
+{
+	if (sampled == TRUE)
+		return;
+
+	(void)poll_register(Si1132_REG_IRQSTAT, IRQSTAT_ALS, IRQSTAT_ALS);
+	Si1132_I2C_write8(Si1132_REG_IRQSTAT, IRQSTAT_ALS);
+
+	sampled = TRUE;
 }
 
 float Si1132_readVisible(void)
 {	float ret;
 
-	(void)usleep(10000);
+	wait_sample();
 	ret = ((float)(Si1132_I2C_read16(0x22) - 256)/0.282) *14.5;
 
 	if (ret < 0.0)
@@ -150,7 +217,7 @@ float Si1132_readVisible(void)
 float Si1132_readIR(void)
 {	float ret;
 
-	(void)usleep(10000);
+	wait_sample();
 	ret = ((float)(Si1132_I2C_read16(0x24) - 250)/2.44)*14.5;
 
 	if (ret < 0.0)
@@ -162,7 +229,7 @@ float Si1132_readIR(void)
 float Si1132_readUV(void)
 {	float ret;
 
-	(void)usleep(10000);
+	wait_sample();
 	ret = (float)Si1132_I2C_read16(0x2c);
 
 	if (ret < 0.0)
@@ -171,22 +238,31 @@ float Si1132_readUV(void)
 	return ret;
 }
 
+// TRUE if any transfer failed since the last call
+int Si1132_failed(void)
+{
+	int failed = io_errors > 0 ? TRUE : FALSE;
+
+	io_errors = 0;
+	return(failed);
+}
+
 unsigned char Si1132_I2C_read8(unsigned char reg)
 {
-	unsigned char ret;
+	unsigned char ret = 0;
 
-	(void)write(si1132Fd, &reg, 1);
-	(void)read(si1132Fd, &ret,  1);
+	if (write(si1132Fd, &reg, 1) != 1 || read(si1132Fd, &ret,  1) != 1)
+		++io_errors;
 
 	return ret;
 }
 
 unsigned short Si1132_I2C_read16(unsigned char reg)
 {
-	unsigned char rbuf[2];
+	unsigned char rbuf[2] = { 0, 0 };
 
-	(void)write(si1132Fd, &reg, 1);
-	(void)read(si1132Fd, rbuf,  2);
+	if (write(si1132Fd, &reg, 1) != 1 || read(si1132Fd, rbuf,  2) != 2)
+		++io_errors;
 
 	return (unsigned short)(rbuf[0] | rbuf[1] << 8);
 }
@@ -198,11 +274,17 @@ void Si1132_I2C_write8(unsigned char reg, unsigned char val)
 	wbuf[0] = reg;
 	wbuf[1] = val;
 
-	(void)write(si1132Fd, wbuf, 2);
+	if (write(si1132Fd, wbuf, 2) != 2)
+		++io_errors;
 }
 
+// clear the response register (NOP) then wait for the command to be acknowledged
 void Si1132_I2C_writeParam(unsigned char param, unsigned char val)
 {
+	Si1132_I2C_write8(Si1132_REG_COMMAND, Si1132_NOP);
+	(void)poll_register(Si1132_REG_RESPONSE, 0xFF, 0);
+
 	Si1132_I2C_write8(Si1132_REG_PARAMWR, val);
 	Si1132_I2C_write8(Si1132_REG_COMMAND, param | Si1132_PARAM_SET);
+	(void)poll_register(Si1132_REG_RESPONSE, 0xFF, -1);
 }
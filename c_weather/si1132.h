@@ -104,6 +104,8 @@ extern float          Si1132_readVisible();
 extern float          Si1132_readIR();
 extern float          Si1132_readUV();
 
+extern int            Si1132_failed(void);
+
 extern unsigned char  Si1132_I2C_read8(unsigned char reg);
 extern unsigned short Si1132_I2C_read16(unsigned char reg);
 
@@ -6,11 +6,26 @@
 #include "si702x.h"
 
 
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+
+
 /*------------------*/
 /* Global variables */
 /*------------------*/
 
-int si702xFd;
+int si702xFd = (-1);
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static int io_errors = 0;          /* Failed transfers since last Si702x_failed() */
 
 
 /*-----------*/
@@ -21,6 +36,10 @@ int si702x_begin(const char *device)
 {
 	int status = 0;
 
+	/* re-probe: drop the old session */
+	if (si702xFd >= 0)
+		(void)close(si702xFd);
+
 	si702xFd = open(device, O_RDWR);
 	if (si702xFd < 0) {
 		(void)fprintf(stderr,"    si702x ERROR: open failed\n");
@@ -35,8 +54,15 @@ int si702x_begin(const char *device)
 		(void)fflush(stderr);
 
 		(void)close(si702xFd);
+		si702xFd = (-1);
 		return(-1);
 	}
+
+	/* the Si702x has no part id register on this path, so check it answers */
+	io_errors = 0;
+	(void)Si702x_readTemperature();
+
+	return(Si702x_failed() == TRUE ? -1 : 0);
 }
 
 
@@ -71,12 +97,22 @@ float Si702x_readHumidity(void)
 }
 
 
+/* TRUE if any transfer failed since the last call */
+int Si702x_failed(void)
+{
+	int failed = io_errors > 0 ? TRUE : FALSE;
+
+	io_errors = 0;
+	return(failed);
+}
+
+
 unsigned short Si702x_I2C_read16(unsigned char reg)
 {
 	unsigned char rbuf[2] = "";
 
-	(void)write(si702xFd, &reg, 1);
-	(void)read(si702xFd, rbuf, 2);
+	if (write(si702xFd, &reg, 1) != 1 || read(si702xFd, rbuf, 2) != 2)
+		++io_errors;
 
 	return (unsigned short)(rbuf[0] << 8 | rbuf[1]);
 }
@@ -86,6 +122,7 @@ void Si702x_I2C_write8(unsigned char val)
 {
 	unsigned char wbuf[1] = "";
 
-	wbuf[1] = val;
-	(void)write(si702xFd, wbuf, 1);
+	wbuf[0] = val;
+	if (write(si702xFd, wbuf, 1) != 1)
+		++io_errors;
 }
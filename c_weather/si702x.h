@@ -74,6 +74,7 @@
 int            si702x_begin           (const char *device);
 float          Si702x_readTemperature (void);
 float          Si702x_readHumidity    (void);
+int            Si702x_failed          (void);
 unsigned short Si702x_I2C_read16      (unsigned char reg);
 void           Si702x_I2C_write8      (unsigned char val);
 
@@ -0,0 +1,93 @@
+/*---------------------------------------------
+ * Weatherboard simulated sensor bus
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "vclock.h"
+#include "simbus.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define SECS_PER_DAY           86400.0
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static uint32_t seed = 0x9e3779b9;
+
+
+
+
+/*--------------------------------------*/
+/* Uniform noise in [-1,1) (xorshift32) */
+/*--------------------------------------*/
+
+static double noise(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+
+	return((double)seed / 2147483648.0 - 1.0);
+}
+
+
+
+
+/*-------------------------------------------*/
+/* Take usecs (emulated bus transfer). Under */
+/* time warp this advances the virtual clock */
+/*-------------------------------------------*/
+
+static void transfer(long usecs)
+{
+	vclock_sleep(usecs);
+}
+
+
+
+
+/*-------------------------------------------*/
+/* Light: daylight from 06:00 to 18:00 (UTC) */
+/*-------------------------------------------*/
+
+void simbus_read_light(double t, float *uv_index, float *vis, float *ir)
+{
+	double sun = sin(2.0 * M_PI * (fmod(t,SECS_PER_DAY) / SECS_PER_DAY - 0.25));
+
+	if (sun < 0.0)
+		sun = 0.0;
+
+	transfer(SIMBUS_LIGHT_USECS);
+
+	*uv_index = (float)(8.0    * sun + 0.05 * noise());
+	*vis      = (float)(2000.0 * sun + 260.0 + 5.0 * noise());
+	*ir       = (float)(3000.0 * sun + 250.0 + 5.0 * noise());
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Temperature and humidity follow the sun (a */
+/* few hours behind), pressure swings over ~5 */
+/* days                                       */
+/*--------------------------------------------*/
+
+void simbus_read_bme280(double t, float *temperature, float *humidity, float *pressure)
+{
+	double day = sin(2.0 * M_PI * (fmod(t,SECS_PER_DAY) / SECS_PER_DAY - 0.4));
+
+	transfer(SIMBUS_BME280_USECS);
+
+	*temperature = (float)(15.0   + 6.0  * day + 0.02 * noise());
+	*humidity    = (float)(65.0   - 20.0 * day + 0.1  * noise());
+	*pressure    = (float)(1013.0 + 12.0 * sin(2.0 * M_PI * t / (5.0 * SECS_PER_DAY)) + 0.02 * noise());
+}
@@ -0,0 +1,32 @@
+#ifndef __SIMBUS_H__
+#define __SIMBUS_H__
+
+/*---------------------------------------------
+ * Weatherboard simulated sensor bus
+ *
+ * Synthetic readings (diurnal light,
+ * temperature and humidity cycles, slow
+ * pressure swings, plus noise) for running
+ * the daemon without a board, e.g. for
+ * benchmarks. Each read takes the time the
+ * real I2C transfer would (on the virtual
+ * clock, if time is warped).
+ *-------------------------------------------*/
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define SIMBUS_LIGHT_USECS     900     // Si1132 UV, visible and IR reads
+#define SIMBUS_BME280_USECS    1000    // BME280 8 byte burst read
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern void simbus_read_light (double t, float *uv_index, float *vis, float *ir);
+extern void simbus_read_bme280(double t, float *temperature, float *humidity, float *pressure);
+
+#endif //__SIMBUS_H__
@@ -0,0 +1,91 @@
+/*---------------------------------------------
+ * Weatherboard sample sinks
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include "sink.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+
+
+/*-----------------*/
+/* Registered sink */
+/*-----------------*/
+
+typedef struct {
+	sink_publish_t publish;
+	void           *data;
+	int            enabled;
+} sink_t;
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static sink_t sinks[SINK_MAX];
+static int    n_sinks = 0;
+
+
+
+
+/*-------------------------------------------*/
+/* Register a sink. Returns its id or -1 if  */
+/* there are already SINK_MAX                */
+/*-------------------------------------------*/
+
+int sink_register(sink_publish_t publish, void *data, int enabled)
+{
+	if (n_sinks >= SINK_MAX)
+		return(-1);
+
+	sinks[n_sinks].publish = publish;
+	sinks[n_sinks].data    = data;
+	sinks[n_sinks].enabled = enabled == FALSE ? FALSE : TRUE;
+
+	return(n_sinks++);
+}
+
+
+
+
+/*--------------------------------*/
+/* Enable (or disable) a sink     */
+/*--------------------------------*/
+
+void sink_enable(int sink, int enabled)
+{
+	if (sink >= 0 && sink < n_sinks)
+		sinks[sink].enabled = enabled == FALSE ? FALSE : TRUE;
+}
+
+int sink_enabled(int sink)
+{
+	if (sink < 0 || sink >= n_sinks)
+		return(FALSE);
+
+	return(sinks[sink].enabled);
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Publish sample to every enabled sink       */
+/*--------------------------------------------*/
+
+void sink_publish(const sample_t *sample)
+{
+	int s;
+
+	for (s=0; s<n_sinks; ++s) {
+		if (sinks[s].enabled == TRUE)
+			sinks[s].publish(sample,sinks[s].data);
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef __SINK_H__
+#define __SINK_H__
+
+/*---------------------------------------------
+ * Weatherboard sample sinks
+ *
+ * The sensors are read once per cycle and the
+ * sample is published to every enabled sink
+ * (log file, standard output, terminal view,
+ * weatherpipe ...) in the order they were
+ * registered. Whether a sink wants samples at
+ * all is decided when it is registered, or
+ * when settings change, never per sample.
+ *-------------------------------------------*/
+
+#include "channels.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define SINK_MAX               8
+#define SINK_SSIZE             256
+
+
+/*---------------------------------*/
+/* One cycle's (processed) sample  */
+/*---------------------------------*/
+
+typedef struct {
+	double       t;                      // Acquisition time (secs since epoch)
+	long long    ns;                     // Record time (virtual ns since epoch)
+	char         datetime[SINK_SSIZE];   // Record time stamp
+	float        value[NCHANNELS];
+	unsigned int fresh;                  // Channels acquired this cycle (bit per channel)
+	int          decision;               // Deadband decision
+	char         fields[SINK_SSIZE];     // Optional record fields (forecast, rate)
+} sample_t;
+
+
+/*--------------------------------------*/
+/* Sink: called with each sample (and   */
+/* the data it was registered with)     */
+/*--------------------------------------*/
+
+typedef void (*sink_publish_t)(const sample_t *sample, void *data);
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int  sink_register(sink_publish_t publish, void *data, int enabled);
+extern void sink_enable  (int sink, int enabled);
+extern int  sink_enabled (int sink);
+extern void sink_publish (const sample_t *sample);
+
+#endif //__SINK_H__
@@ -0,0 +1,339 @@
+/*---------------------------------------------
+ * Weatherboard streaming channel statistics
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "stats.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE  0
+#define TRUE   255
+#define SSIZE  256
+extern int     do_verbose;
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static chanstat_t   chanstat[NCHANNELS];
+static double       window[STATS_MAX_WINDOWS];
+static double       period_start[STATS_MAX_WINDOWS];
+static unsigned int n_windows = 0;
+static double       alpha     = STATS_DEFAULT_ALPHA;
+
+
+
+
+/*-------------------------------------------------*/
+/* Parse comma separated list of windows (seconds) */
+/*-------------------------------------------------*/
+
+int stats_parse_windows(const char *spec)
+{
+	char   tmpstr[SSIZE] = "",
+	       *tok          = (char *)NULL,
+	       *saveptr      = (char *)NULL;
+	double w;
+
+	(void)strncpy(tmpstr,spec,SSIZE - 1);
+
+	n_windows = 0;
+	for (tok = strtok_r(tmpstr,",",&saveptr); tok != (char *)NULL; tok = strtok_r((char *)NULL,",",&saveptr)) {
+		if (n_windows == STATS_MAX_WINDOWS || sscanf(tok,"%lf",&w) != 1 || w <= 0.0)
+			return(-1);
+
+		window[n_windows++] = w;
+	}
+
+	return(n_windows > 0 ? 0 : -1);
+}
+
+
+
+
+/*-------------------------------------*/
+/* Initialise deque (initial capacity) */
+/*-------------------------------------*/
+
+static int deque_init(stat_deque_t *q, unsigned int cap)
+{
+	if ((q->buf = (stat_point_t *)calloc(cap,sizeof(stat_point_t))) == (stat_point_t *)NULL)
+		return(-1);
+
+	q->cap  = cap;
+	q->head = 0;
+	q->len  = 0;
+
+	return(0);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Double deque capacity (keeps elements in order) */
+/*-------------------------------------------------*/
+
+static int deque_grow(stat_deque_t *q)
+{
+	unsigned int i;
+	stat_point_t *nbuf = (stat_point_t *)NULL;
+
+	if ((nbuf = (stat_point_t *)calloc(2*q->cap,sizeof(stat_point_t))) == (stat_point_t *)NULL)
+		return(-1);
+
+	for (i=0; i<q->len; ++i)
+		nbuf[i] = q->buf[(q->head + i) % q->cap];
+
+	free(q->buf);
+	q->buf  = nbuf;
+	q->cap *= 2;
+	q->head = 0;
+
+	return(0);
+}
+
+
+
+
+/*-----------------------------------------------------*/
+/* Push point onto monotonic deque. If is_min is TRUE  */
+/* deque is kept non-decreasing (front is the minimum) */
+/* else non-increasing (front is the maximum)          */
+/*-----------------------------------------------------*/
+
+static void deque_push(stat_deque_t *q, double t, double v, int is_min)
+{
+	unsigned int tail;
+
+
+	/*------------------------------------*/
+	/* Drop points which can never be the */
+	/* extremum while this one is live    */
+	/*------------------------------------*/
+
+	while (q->len > 0) {
+		tail = (q->head + q->len - 1) % q->cap;
+
+		if ((is_min == TRUE && q->buf[tail].v >= v) || (is_min == FALSE && q->buf[tail].v <= v))
+			--q->len;
+		else
+			break;
+	}
+
+	if (q->len == q->cap && deque_grow(q) < 0)
+		return;
+
+	tail            = (q->head + q->len) % q->cap;
+	q->buf[tail].t  = t;
+	q->buf[tail].v  = v;
+	++q->len;
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Expire points which have left the window [t0,t) */
+/*-------------------------------------------------*/
+
+static void deque_expire(stat_deque_t *q, double t0)
+{
+	while (q->len > 0 && q->buf[q->head].t < t0) {
+		q->head = (q->head + 1) % q->cap;
+		--q->len;
+	}
+}
+
+
+
+
+/*---------------------------------------*/
+/* Initialise statistics for all windows */
+/*---------------------------------------*/
+
+int stats_init(double ewma_alpha)
+{
+	unsigned int c,
+	             w;
+
+	alpha = ewma_alpha;
+
+	for (c=0; c<NCHANNELS; ++c) {
+		chanstat[c].ewma   = 0.0;
+		chanstat[c].primed = FALSE;
+
+		for (w=0; w<n_windows; ++w) {
+			chanstat[c].win[w].n    = 0;
+			chanstat[c].win[w].mean = 0.0;
+			chanstat[c].win[w].m2   = 0.0;
+
+			if (deque_init(&chanstat[c].win[w].minq,64) < 0 || deque_init(&chanstat[c].win[w].maxq,64) < 0)
+				return(-1);
+		}
+	}
+
+	for (w=0; w<n_windows; ++w)
+		period_start[w] = (-1.0);
+
+	return(0);
+}
+
+
+
+
+/*---------------------------------*/
+/* Number of windows / window size */
+/*---------------------------------*/
+
+unsigned int stats_n_windows(void)
+{
+	return(n_windows);
+}
+
+double stats_window(unsigned int w)
+{
+	return(window[w]);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Add sample v (taken at time t) to channel chan */
+/*------------------------------------------------*/
+
+void stats_update(unsigned int chan, double t, double v)
+{
+	unsigned int  w;
+	double        delta;
+	stat_window_t *sw = (stat_window_t *)NULL;
+	chanstat_t    *cs = &chanstat[chan];
+
+
+	/*------*/
+	/* EWMA */
+	/*------*/
+
+	if (cs->primed == FALSE) {
+		cs->ewma   = v;
+		cs->primed = TRUE;
+	} else
+		cs->ewma += alpha * (v - cs->ewma);
+
+	for (w=0; w<n_windows; ++w) {
+		sw = &cs->win[w];
+
+
+		/*-----------------------------*/
+		/* Welford mean and variance   */
+		/* (reset every window period) */
+		/*-----------------------------*/
+
+		++sw->n;
+		delta     = v - sw->mean;
+		sw->mean += delta / (double)sw->n;
+		sw->m2   += delta * (v - sw->mean);
+
+
+		/*------------------------*/
+		/* Sliding window min/max */
+		/*------------------------*/
+
+		deque_push(&sw->minq,t,v,TRUE);
+		deque_push(&sw->maxq,t,v,FALSE);
+		deque_expire(&sw->minq,t - window[w]);
+		deque_expire(&sw->maxq,t - window[w]);
+	}
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Summarise channel chan over window w at time t */
+/* (mean and sd cover the current period, min and */
+/* max [t - window,t)). Statistics without any    */
+/* samples are NAN                                */
+/*------------------------------------------------*/
+
+void stats_summary(unsigned int chan, unsigned int w, double t, stat_summary_t *s)
+{
+	stat_window_t *sw = &chanstat[chan].win[w];
+
+	deque_expire(&sw->minq,t - window[w]);
+	deque_expire(&sw->maxq,t - window[w]);
+
+	s->n    = sw->n;
+	s->mean = sw->n > 0 ? sw->mean : NAN;
+	s->sd   = sw->n > 1 ? sqrt(sw->m2 / (double)(sw->n - 1)) : (sw->n > 0 ? 0.0 : NAN);
+	s->min  = sw->minq.len > 0 ? sw->minq.buf[sw->minq.head].v : NAN;
+	s->max  = sw->maxq.len > 0 ? sw->maxq.buf[sw->maxq.head].v : NAN;
+	s->ewma = chanstat[chan].primed == TRUE ? chanstat[chan].ewma : NAN;
+}
+
+
+
+
+/*-----------------------------------------------------*/
+/* Write summary line for each window whose period has */
+/* elapsed at time t. Must be called before the sample */
+/* taken at time t is added                            */
+/*-----------------------------------------------------*/
+
+void stats_emit(FILE *stream, const char *datetime, double t)
+{
+	unsigned int   c,
+	               w;
+	stat_summary_t s;
+
+	for (w=0; w<n_windows; ++w) {
+
+
+		/*-----------------------------*/
+		/* First sample - align period */
+		/* start to multiple of window */
+		/*-----------------------------*/
+
+		if (period_start[w] < 0.0) {
+			period_start[w] = floor(t / window[w]) * window[w];
+			continue;
+		}
+
+		if (t < period_start[w] + window[w])
+			continue;
+
+		if (stream != (FILE *)NULL) {
+			(void)fprintf(stream,"# %s  stats %gs",datetime,window[w]);
+
+			for (c=0; c<NCHANNELS; ++c) {
+				stats_summary(c,w,t,&s);
+				(void)fprintf(stream,"  %s: mean %8.2f sd %8.2f min %8.2f max %8.2f ewma %8.2f",channel_name[c],s.mean,s.sd,s.min,s.max,s.ewma);
+			}
+
+			(void)fprintf(stream,"\n");
+		}
+
+
+		/*-------------------------------------*/
+		/* Start next period (min/max deques   */
+		/* slide so do not need to be cleared) */
+		/*-------------------------------------*/
+
+		for (c=0; c<NCHANNELS; ++c) {
+			chanstat[c].win[w].n    = 0;
+			chanstat[c].win[w].mean = 0.0;
+			chanstat[c].win[w].m2   = 0.0;
+		}
+
+		period_start[w] = floor(t / window[w]) * window[w];
+	}
+}
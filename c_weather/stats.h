@@ -0,0 +1,104 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+/*---------------------------------------------
+ * Weatherboard streaming channel statistics
+ *
+ * EWMA, Welford mean/variance and sliding
+ * window min/max (monotonic deques). Every
+ * update is O(1) (amortised) regardless of
+ * window length. Mean and sd cover tumbling
+ * periods (reset as each summary is written),
+ * min and max the window sliding back from
+ * the summary time, so a late summary tick
+ * makes them cover different spans. A
+ * statistic with no samples is NAN (nan in
+ * the log).
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include "channels.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define STATS_MAX_WINDOWS      4
+#define STATS_DEFAULT_ALPHA    0.1
+
+
+/*------------------------------------*/
+/* Time stamped point held in a deque */
+/*------------------------------------*/
+
+typedef struct {
+	double t;
+	double v;
+} stat_point_t;
+
+
+/*------------------------------------------*/
+/* Monotonic deque (ring buffer, grows when */
+/* full so push is amortised O(1))          */
+/*------------------------------------------*/
+
+typedef struct {
+	stat_point_t *buf;
+	unsigned int  cap;
+	unsigned int  head;
+	unsigned int  len;
+} stat_deque_t;
+
+
+/*------------------------------------*/
+/* Per channel, per window statistics */
+/*------------------------------------*/
+
+typedef struct {
+	unsigned long n;
+	double        mean;
+	double        m2;
+	stat_deque_t  minq;
+	stat_deque_t  maxq;
+} stat_window_t;
+
+
+/*------------------------*/
+/* Per channel statistics */
+/*------------------------*/
+
+typedef struct {
+	double        ewma;
+	int           primed;
+	stat_window_t win[STATS_MAX_WINDOWS];
+} chanstat_t;
+
+
+/*----------------------------*/
+/* Summary of a single window */
+/*----------------------------*/
+
+typedef struct {
+	unsigned long n;
+	double        mean;
+	double        sd;
+	double        min;
+	double        max;
+	double        ewma;
+} stat_summary_t;
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int          stats_parse_windows (const char *spec);
+extern int          stats_init          (double ewma_alpha);
+extern unsigned int stats_n_windows     (void);
+extern double       stats_window        (unsigned int w);
+extern void         stats_update        (unsigned int chan, double t, double v);
+extern void         stats_summary       (unsigned int chan, unsigned int w, double t, stat_summary_t *s);
+extern void         stats_emit          (FILE *stream, const char *datetime, double t);
+
+#endif //__STATS_H__
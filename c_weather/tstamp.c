@@ -0,0 +1,205 @@
+/*---------------------------------------------
+ * Weatherboard record time stamps
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "tstamp.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE          0
+#define TRUE           255
+#define NSECS_PER_SEC  1000000000LL
+#define NSECS_PER_MSEC 1000000LL
+
+
+/*-------------------------------------*/
+/* Cached local hour (and day) prefix  */
+/*-------------------------------------*/
+
+typedef struct {
+	time_t hour_start;                  // Start of cached local hour (-1 if none)
+	int    hour;                        // Local hour (0-23)
+	int    yday;                        // Day of the year the prefixes were built for
+	int    year;
+	char   legacy[TSTAMP_SIZE];         // "Sun.Oct.18-"
+	int    legacy_len;
+	char   iso[TSTAMP_SIZE];            // "2026-10-18T"
+	int    iso_len;
+	char   zone[8];                     // "+01:00"
+} hour_cache_t;
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static const char *const format_name[] = { "legacy", "iso", "epochms" };
+static const char *const day_name[]    = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+static const char *const month_name[]  = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                           "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+static hour_cache_t cache = { (time_t)(-1), 0, -1, 0, "", 0, "", 0, "" };
+
+
+
+
+/*-----------------------------------------*/
+/* Format from name (-1 if not known) and  */
+/* name of format                          */
+/*-----------------------------------------*/
+
+int tstamp_lookup(const char *name)
+{
+	int f;
+
+	for (f=0; f<=TSTAMP_EPOCHMS; ++f) {
+		if (strcmp(name,format_name[f]) == 0)
+			return(f);
+	}
+
+	return(-1);
+}
+
+const char *tstamp_name(int format)
+{
+	return(format_name[format]);
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Make sure the cache covers secs (rebuilding  */
+/* the date prefixes only if the day changed)   */
+/*----------------------------------------------*/
+
+static void refresh(time_t secs)
+{
+	int       off,
+	          sign = '+';
+	struct tm tm;
+
+	if (cache.hour_start >= 0 && secs >= cache.hour_start && secs < cache.hour_start + 3600)
+		return;
+
+	(void)localtime_r(&secs,&tm);
+
+	cache.hour_start = secs - (time_t)(tm.tm_min*60 + tm.tm_sec);
+	cache.hour       = tm.tm_hour;
+
+
+	/*--------------------------------------*/
+	/* Minutes east of UTC, clamped to      */
+	/* +/-23:59 so the zone fits            */
+	/*--------------------------------------*/
+
+	off = (int)(tm.tm_gmtoff / 60);
+	if (off < 0) {
+		off  = -off;
+		sign = '-';
+	}
+	if (off > 23*60 + 59)
+		off = 23*60 + 59;
+
+	(void)snprintf(cache.zone,sizeof(cache.zone),"%c%02d:%02d",sign,off / 60,off % 60);
+
+	if (tm.tm_yday == cache.yday && tm.tm_year == cache.year)
+		return;
+
+	cache.yday       = tm.tm_yday;
+	cache.year       = tm.tm_year;
+	cache.legacy_len = snprintf(cache.legacy,TSTAMP_SIZE,"%s.%s.%d-",day_name[tm.tm_wday],month_name[tm.tm_mon],tm.tm_mday);
+	cache.iso_len    = snprintf(cache.iso,   TSTAMP_SIZE,"%04d-%02d-%02dT",tm.tm_year + 1900,tm.tm_mon + 1,tm.tm_mday);
+}
+
+
+
+
+/*--------------------------------------*/
+/* Write n as width decimal digits      */
+/*--------------------------------------*/
+
+static char *digits(char *p, long n, int width)
+{
+	int i;
+
+	for (i=width-1; i>=0; --i) {
+		p[i] = (char)('0' + n % 10);
+		n   /= 10;
+	}
+
+	return(p + width);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Render time ns (since the epoch) in format to  */
+/* buf (at least TSTAMP_SIZE bytes), with         */
+/* milliseconds if msecs is TRUE. Returns the     */
+/* length                                         */
+/*------------------------------------------------*/
+
+int tstamp_format(char *buf, long long ns, int format, int msecs)
+{
+	time_t secs;
+	long   in_hour;
+	char   *p = buf;
+
+	if (format == TSTAMP_EPOCHMS)
+		return(snprintf(buf,TSTAMP_SIZE,"%lld",ns / NSECS_PER_MSEC));
+
+	secs = (time_t)(ns / NSECS_PER_SEC);
+	refresh(secs);
+
+	in_hour = (long)(secs - cache.hour_start);
+
+	if (format == TSTAMP_ISO) {
+		(void)memcpy((void *)p,(void *)cache.iso,(size_t)cache.iso_len);
+		p += cache.iso_len;
+	} else {
+		(void)memcpy((void *)p,(void *)cache.legacy,(size_t)cache.legacy_len);
+		p += cache.legacy_len;
+	}
+
+	p    = digits(p,cache.hour,2);
+	*p++ = ':';
+	p    = digits(p,in_hour / 60,2);
+	*p++ = ':';
+	p    = digits(p,in_hour % 60,2);
+
+	if (msecs != FALSE) {
+		*p++ = '.';
+		p    = digits(p,(long)((ns % NSECS_PER_SEC) / NSECS_PER_MSEC),3);
+	}
+
+	if (format == TSTAMP_ISO) {
+		(void)strcpy(p,cache.zone);
+		p += strlen(cache.zone);
+	}
+
+	*p = '\0';
+	return((int)(p - buf));
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Seconds since (local) midnight at time ns    */
+/*----------------------------------------------*/
+
+long tstamp_daysecs(long long ns)
+{
+	time_t secs = (time_t)(ns / NSECS_PER_SEC);
+
+	refresh(secs);
+	return((long)cache.hour * 3600L + (long)(secs - cache.hour_start));
+}
@@ -0,0 +1,41 @@
+#ifndef __TSTAMP_H__
+#define __TSTAMP_H__
+
+/*---------------------------------------------
+ * Weatherboard record time stamps
+ *
+ * Time stamps are rendered from a per hour
+ * cache (local time, refreshed with one
+ * localtime_r call when the hour changes) so
+ * each record only costs writing out the
+ * minute, second and millisecond digits. The
+ * date part is rebuilt only when the day
+ * changes. Formats are
+ *
+ *    legacy   Sun.Oct.18-17:42:25[.801]
+ *    iso      2026-10-18T17:42:25[.801]+01:00
+ *    epochms  1792345345801
+ *-------------------------------------------*/
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define TSTAMP_LEGACY          0
+#define TSTAMP_ISO             1
+#define TSTAMP_EPOCHMS         2
+
+#define TSTAMP_SIZE            40      // Longest time stamp (with terminating NUL)
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern int         tstamp_lookup (const char *name);
+extern const char  *tstamp_name  (int format);
+extern int         tstamp_format (char *buf, long long ns, int format, int msecs);
+extern long        tstamp_daysecs(long long ns);
+
+#endif //__TSTAMP_H__
@@ -0,0 +1,142 @@
+/*---------------------------------------------
+ * Weatherboard clock
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <time.h>
+#include "vclock.h"
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define FALSE          0
+#define TRUE           255
+#define NSECS_PER_SEC  1000000000LL
+
+
+/*-----------------*/
+/* Local variables */
+/*-----------------*/
+
+static int       is_virtual = FALSE;
+static long long virtual_ns = 0;        // Virtual time (ns since epoch)
+static long long warped_at  = 0;        // Real (monotonic) time warp began
+
+
+
+
+/*-------------------------------*/
+/* Read a system clock (ns)      */
+/*-------------------------------*/
+
+static long long clock_ns(clockid_t id)
+{
+	struct timespec tspec;
+
+	(void)clock_gettime(id,&tspec);
+	return((long long)tspec.tv_sec * NSECS_PER_SEC + (long long)tspec.tv_nsec);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Switch to virtual time, starting at start (ns  */
+/* since the epoch)                               */
+/*------------------------------------------------*/
+
+void vclock_warp(long long start)
+{
+	is_virtual = TRUE;
+	virtual_ns = start;
+	warped_at  = clock_ns(CLOCK_MONOTONIC);
+}
+
+int vclock_virtual(void)
+{
+	return(is_virtual);
+}
+
+
+
+
+/*-----------------------------------------*/
+/* Current time: ns, whole and fractional  */
+/* seconds since the epoch                 */
+/*-----------------------------------------*/
+
+long long vclock_now(void)
+{
+	if (is_virtual == TRUE)
+		return(virtual_ns);
+
+	return(clock_ns(CLOCK_REALTIME));
+}
+
+time_t vclock_time(void)
+{
+	return((time_t)(vclock_now() / NSECS_PER_SEC));
+}
+
+double vclock_secs(void)
+{
+	long long now = vclock_now();
+
+	return((double)(now / NSECS_PER_SEC) + (double)(now % NSECS_PER_SEC) / 1.0e9);
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Advance virtual time to t (ns since epoch).   */
+/* Time never runs backwards; no effect on real  */
+/* time                                          */
+/*-----------------------------------------------*/
+
+void vclock_advance_to(long long t)
+{
+	if (is_virtual == TRUE && t > virtual_ns)
+		virtual_ns = t;
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Take usecs: sleeps in real time, advances   */
+/* virtual time                                */
+/*---------------------------------------------*/
+
+void vclock_sleep(long usecs)
+{
+	struct timespec tspec;
+
+	if (is_virtual == TRUE) {
+		virtual_ns += (long long)usecs * 1000LL;
+		return;
+	}
+
+	tspec.tv_sec  = usecs / 1000000L;
+	tspec.tv_nsec = (usecs % 1000000L) * 1000L;
+
+	(void)clock_nanosleep(CLOCK_MONOTONIC,0,&tspec,(struct timespec *)NULL);
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Real seconds since time warp began (0 if    */
+/* not warped)                                 */
+/*---------------------------------------------*/
+
+double vclock_elapsed(void)
+{
+	if (is_virtual == FALSE)
+		return(0.0);
+
+	return((double)(clock_ns(CLOCK_MONOTONIC) - warped_at) / 1.0e9);
+}
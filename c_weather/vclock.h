@@ -0,0 +1,35 @@
+#ifndef __VCLOCK_H__
+#define __VCLOCK_H__
+
+/*---------------------------------------------
+ * Weatherboard clock
+ *
+ * All of the daemon's wall clock time comes
+ * from here. Normally that is the real time
+ * (CLOCK_REALTIME). In virtual (time warp)
+ * mode it is a counter, starting at a given
+ * epoch, which only moves when it is advanced:
+ * the scheduler jumps it to each deadline
+ * instead of sleeping and emulated bus
+ * transfers add their duration to it, so with
+ * the simulated bus a month of 1 second
+ * samples runs in seconds.
+ *-------------------------------------------*/
+
+#include <time.h>
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern void      vclock_warp      (long long start);
+extern int       vclock_virtual   (void);
+extern long long vclock_now       (void);
+extern time_t    vclock_time      (void);
+extern double    vclock_secs      (void);
+extern void      vclock_advance_to(long long t);
+extern void      vclock_sleep     (long usecs);
+extern double    vclock_elapsed   (void);
+
+#endif //__VCLOCK_H__
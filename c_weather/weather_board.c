@@ -8,14 +8,45 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
 #include <time.h>
 #include <sys/timeb.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/timerfd.h>
 #include "bme280-i2c.h"
 #include "si1132.h"
 #include "si702x.h"
 #include "bmp180.h"
+#include "stats.h"
+#include "filter.h"
+#include "deadband.h"
+#include "fusion.h"
+#include "forecast.h"
+#include "kll.h"
+#include "scheduler.h"
+#include "wheel.h"
+#include "evloop.h"
+#include "adaptive.h"
+#include "simbus.h"
+#include "iothread.h"
+#include "realtime.h"
+#include "config.h"
+#include "health.h"
+#include "vclock.h"
+#include "sink.h"
+#include "tstamp.h"
+#include "recfmt.h"
+#include "logbuf.h"
+#include "rotate.h"
+#include "gzlog.h"
+#include "colfmt.h"
+#include "archive.h"
 
 
 /*-------------------*/
@@ -28,11 +59,79 @@
 #define WEATHERBOARD_VERSION "3.00"
 
 
-/*-------------------------------*/
-/* Default sensor polling period */
-/*-------------------------------*/
+/*--------------------------------------------*/
+/* Default sensor polling period (secs). Any  */
+/* period (ms) shorter than HIGHRATE_PERIOD   */
+/* selects the high rate path                 */
+/*--------------------------------------------*/
 
 #define DEFAULT_UPDATE_PERIOD  60
+#define HIGHRATE_PERIOD        1000
+
+
+/*---------------------------------------------*/
+/* Acquisition tasks (timer wheel task ids, so */
+/* the tasks due at a tick form a bit mask)    */
+/*---------------------------------------------*/
+
+#define TASK_LIGHT             0
+#define TASK_PRESSURE          1
+#define TASK_HUMIDITY          2
+#define N_TASKS                3
+#define TASK_BIT(t)            (1U << (t))
+
+
+/*---------------------------------------------*/
+/* Main loop events and event loop (fd) tags   */
+/*---------------------------------------------*/
+
+#define EVENT_TICK             1
+#define EVENT_ROLLOVER         2
+#define EVENT_EXIT             3
+#define EVENT_RELOAD           4
+
+#define TAG_SAMPLER            1
+#define TAG_PIPE               2
+#define TAG_PIPE_RETRY         3
+
+
+/*--------------------------------------------*/
+/* Weatherpipe (reader open retry period, ms, */
+/* and how long to wait for a reader, secs)   */
+/*--------------------------------------------*/
+
+#define WEATHERPIPE            "/tmp/weatherpipe"
+#define PIPE_RETRY_PERIOD      10
+#define PIPE_TIMEOUT           60
+
+
+/*---------------------------------------------*/
+/* Sensor initialisation (run concurrently at  */
+/* startup, one thread per sensor)             */
+/*---------------------------------------------*/
+
+#define MAX_SENSORS            3
+
+
+/*---------------------------------------------*/
+/* Sensor (health) ids, in initialisation      */
+/* order                                       */
+/*---------------------------------------------*/
+
+#define SENSOR_SI1132          0
+#define SENSOR_BME280          1      // V2 boards
+#define SENSOR_SI702X          1      // V1 boards
+#define SENSOR_BMP180          2
+
+typedef struct {
+	const char    *name;
+	int           (*begin)(const char *device);
+	const char    *device;
+	int           status;
+	long long     took;                  // ns
+	pthread_t     thread;
+	int           joinable;
+} sensor_init_t;
 
 
 /*----------------*/
@@ -53,6 +152,37 @@
 #define SSIZE                  256
 
 
+/*------------------------------------------------*/
+/* Binary log: default batch (each batch closes a */
+/* block) and largest block staged at once        */
+/*------------------------------------------------*/
+
+#define BINLOG_DEFAULT_BATCH   "60"
+#define BINLOG_BLOCK_MAX       (LOGBUF_MARGIN / 2)
+
+
+/*---------------------------------------------*/
+/* Settings which may be changed in place (by  */
+/* reloading the configuration file) and what  */
+/* changed on reload                           */
+/*---------------------------------------------*/
+
+typedef struct {
+	unsigned int  update_period;             // ms
+	unsigned int  task_period[N_TASKS];      // ms (0 is the update period)
+	unsigned char logfile_name[SSIZE];
+	unsigned char rollover_time[SSIZE];
+	unsigned char rollover_period[SSIZE];
+	_BOOLEAN      forecast;
+	int           timestamp;                 // Record time stamp format
+} settings_t;
+
+#define CHANGED_PERIODS        1
+#define CHANGED_LOGFILE        2
+#define CHANGED_ROLLOVER       4
+#define CHANGED_FORMAT         8
+
+
 /*------------------*/
 /* Global variables */
 /*------------------*/
@@ -81,6 +211,63 @@ _PRIVATE  _BOOLEAN          do_rollover_enabled       = FALSE;
 _PRIVATE time_t            rperiod                    = (-1);
 _PRIVATE time_t            nowsecs                    = (-1);
 _PRIVATE time_t            rollsecs                   = (-1);
+_PRIVATE unsigned long long rotsize                   = 0;               // Rotate at this many bytes (0 never)
+_PRIVATE unsigned long long log_bytes                 = 0;               // Written to the current log file
+_PRIVATE unsigned char     last_rollStr[SSIZE]        = "";
+_PRIVATE unsigned int      roll_seq                   = 0;               // Rollovers within the same second
+_PRIVATE  _BOOLEAN          do_compress               = FALSE;
+_PRIVATE unsigned int      keep_files                 = 0;
+_PRIVATE unsigned long long keep_bytes                = 0;
+_PRIVATE  _BOOLEAN          do_stats                  = FALSE;
+_PRIVATE double            ewma_alpha                 = STATS_DEFAULT_ALPHA;
+_PRIVATE  _BOOLEAN          do_fusion                 = TRUE;
+_PRIVATE fusion_t          temperature_fusion;
+_PRIVATE  _BOOLEAN          do_forecast               = FALSE;
+_PRIVATE  _BOOLEAN          do_sketch                 = FALSE;
+_PRIVATE kll_t             sketch[NCHANNELS];
+_PRIVATE scheduler_t       sampler;
+_PRIVATE wheel_t           sensor_wheel;
+_PRIVATE unsigned int      task_period[N_TASKS]       = { 0, 0, 0 };     // ms
+_PRIVATE unsigned int      task_effective[N_TASKS]    = { 0, 0, 0 };     // ms (adaptive)
+_PRIVATE long long         tick_period                = 0;               // ms
+_PRIVATE const unsigned int channel_task[NCHANNELS]   = { TASK_LIGHT,    TASK_LIGHT,    TASK_LIGHT,
+                                                          TASK_HUMIDITY, TASK_HUMIDITY, TASK_HUMIDITY,
+                                                          TASK_PRESSURE };
+_PRIVATE  _BOOLEAN          do_msecs                  = FALSE;
+_PRIVATE int               pipe_fd                    = (-1);
+_PRIVATE int               pipe_retry_fd              = (-1);
+_PRIVATE unsigned char     pipe_buf[SSIZE]            = "";
+_PRIVATE int               pipe_len                   = 0;
+_PRIVATE int               pipe_off                   = 0;
+_PRIVATE time_t            pipe_requested             = 0;
+_PRIVATE const int         loop_signals[]             = { SIGUSR1, SIGUSR2, SIGABRT, SIGQUIT, SIGINT, SIGHUP, SIGTERM };
+_PRIVATE unsigned int      WBVersion                  = 2;
+_PRIVATE  _BOOLEAN          do_simulate               = FALSE;
+_PRIVATE  _BOOLEAN          do_realtime               = FALSE;
+_PRIVATE int               rt_prio                    = REALTIME_DEFAULT_PRIO;
+_PRIVATE int               rt_cpu                     = REALTIME_NO_CPU;
+_PRIVATE int               log_async                  = (-1);            // Writer thread overflow policy (-1 no thread)
+_PRIVATE FILE              *log_stage                 = (FILE *)NULL;
+_PRIVATE char              log_stage_buf[LOGBUF_SIZE];
+_PRIVATE FILE              *gz_stream                 = (FILE *)NULL;    // Log stream being compressed
+_PRIVATE char              gz_buf[LOGBUF_SIZE + GZLOG_SLACK];
+_PRIVATE  _BOOLEAN          do_binlog                 = FALSE;           // Log file is binary (columnar)
+_PRIVATE FILE              *bin_stream                = (FILE *)NULL;    // Binary log stream
+_PRIVATE char              archive_name[SSIZE]        = "";              // Rotated binary logs are compacted into
+_PRIVATE unsigned int      update_period              = DEFAULT_UPDATE_PERIOD*1000;   // ms
+_PRIVATE unsigned char     config_name[SSIZE]         = "";
+_PRIVATE settings_t        cmdline_settings;
+_PRIVATE settings_t        current_settings;
+_PRIVATE const char *const config_keys[]              = { "uperiod", "pperiod", "thperiod", "lperiod", "logfile", "rollover", "rperiod", "forecast", "timestamp", (const char *)NULL };
+_PRIVATE long long         warp_start                 = 0;               // ns since epoch (virtual time)
+_PRIVATE long long         warp_end                   = 0;
+_PRIVATE  _BOOLEAN          tty_view                  = FALSE;
+_PRIVATE int               tstamp_style               = TSTAMP_LEGACY;
+_PRIVATE  _BOOLEAN          stdout_null               = FALSE;           // stdout is /dev/null
+_PRIVATE FILE              *stdout_stream             = (FILE *)NULL;
+_PRIVATE int               stdout_sink                = (-1);
+_PRIVATE sample_t          pipe_sample;                                  // Latest published sample
+_PRIVATE  _BOOLEAN          pipe_sampled              = FALSE;
 
 
 /*--------------------------*/
@@ -105,18 +292,154 @@ _PRIVATE void clearScreen(void)
 
 
 
-/*----------------*/
-/* Handle signals */
-/*----------------*/
+/*---------------------------------------------------*/
+/*  Get current time and date in human readable form */
+/*  (legacy format, as used in log file names)       */
+/*---------------------------------------------------*/
+
+_PRIVATE void strhostdate(unsigned char *datetime)
+
+{   (void)tstamp_format((char *)datetime,vclock_now(),TSTAMP_LEGACY,do_msecs);
+}
+
+
+
+
+/*------------------------------------------*/
+/* Get current (wall clock or virtual) time */
+/* in seconds with sub-second resolution    */
+/*------------------------------------------*/
+
+_PRIVATE double hostsecs(void)
+
+{   return(vclock_secs());
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Weatherpipe writer. SIGUSR2 formats the latest */
+/* record; the FIFO is opened and written without */
+/* blocking, retrying the open (until a reader    */
+/* appears or PIPE_TIMEOUT) from a timer fd       */
+/*------------------------------------------------*/
+
+_PRIVATE void pipe_close(void)
+
+{   (void)evloop_del(pipe_fd);
+    (void)close(pipe_fd);
+
+    pipe_fd = (-1);
+}
+
+_PRIVATE void pipe_open(void)
+
+{   struct itimerspec tspec;
+
+    if ((pipe_fd = open(WEATHERPIPE,O_WRONLY | O_NONBLOCK | O_CLOEXEC)) >= 0) {
+       pipe_off = 0;
+
+       if (evloop_add(pipe_fd,EPOLLOUT,TAG_PIPE) < 0)
+          pipe_close();
+
+       return;
+    }
+
+
+    /*--------------------------------------*/
+    /* No reader yet - try again in a while */
+    /*--------------------------------------*/
+
+    if (errno == ENXIO && time((time_t *)NULL) - pipe_requested < PIPE_TIMEOUT) {
+       (void)memset((void *)&tspec,0,sizeof(tspec));
+       tspec.it_value.tv_nsec = PIPE_RETRY_PERIOD * NSECS_PER_MSEC;
+
+       (void)timerfd_settime(pipe_retry_fd,0,&tspec,(struct itimerspec *)NULL);
+       return;
+    }
+
+    if (do_verbose == TRUE) {
+       (void)fprintf(stderr,"\n    weather-board WARNING: failed to open weatherpipe for writing\n\n");
+       (void)fflush(stderr);
+    }
+
+    pipe_len = 0;
+}
+
+_PRIVATE void pipe_request(void)
+
+{
+
+    /*------------------------------------*/
+    /* Previous request still outstanding */
+    /* (or nothing acquired yet)          */
+    /*------------------------------------*/
+
+    if (pipe_fd >= 0 || pipe_len > 0 || pipe_sampled == FALSE)
+       return;
+
+    if ((pipe_len = recfmt_record((char *)pipe_buf,SSIZE,pipe_sample.datetime,pipe_sample.value,"","")) < 0) {
+       pipe_len = 0;
+       return;
+    }
+
+    pipe_requested = time((time_t *)NULL);
+    pipe_open();
+}
+
+_PRIVATE void pipe_write(void)
+
+{   ssize_t n;
+
+    if ((n = write(pipe_fd,pipe_buf + pipe_off,pipe_len - pipe_off)) > 0)
+       pipe_off += n;
+
+    else if (n < 0 && errno == EAGAIN)
+       return;
+
+
+    /*--------------------------------*/
+    /* Broken weatherpipe (no reader) */
+    /*--------------------------------*/
+
+    else if (n < 0 && errno == EPIPE && do_verbose == TRUE) {
+       (void)fprintf(stderr,"\n    weather-board WARNING: weatherpipe has no reader\n\n");
+       (void)fflush(stderr);
+    }
+
+    if (n <= 0 || pipe_off == pipe_len) {
+       pipe_close();
+       pipe_len = 0;
+    }
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Handle signal (delivered via the event loop, */
+/* so not in signal context)                    */
+/*----------------------------------------------*/
 
-_PRIVATE int signal_handler(unsigned int signum)
+_PRIVATE int handle_signal(unsigned int signum)
 
 {	if (signum == SIGUSR1) {
-	   if (do_rollover_enabled == TRUE)
+	   if (do_rollover_enabled == TRUE || rotsize > 0) {
 		do_rollover = TRUE;
+		return(EVENT_ROLLOVER);
+	   }
         }
 
 
+	/*---------------------------------------*/
+	/* Reload configuration file (if any)    */
+	/*---------------------------------------*/
+
+	else if (signum == SIGHUP && strcmp(config_name,"") != 0)
+	   return(EVENT_RELOAD);
+
+
 	/*------*/
 	/* Exit */
 	/*------*/
@@ -126,235 +449,2804 @@ _PRIVATE int signal_handler(unsigned int signum)
 	         signum == SIGINT   ||
 		 signum == SIGHUP   ||
 		 signum == SIGTERM   )
-        {  (void)unlink("/tmp/weatherpipe");
+           return(EVENT_EXIT);
 
-	   if (do_verbose == TRUE)
-           {  (void)fprintf(stderr,"\n    weather-board: **** aborted\n\n");
-	      (void)fflush(stderr);
-           }
-  
-	   exit (255);
-	}
 
+	/*---------------------------*/
+	/* Write data to weatherpipe */
+	/*---------------------------*/
+
+	else if (signum == SIGUSR2)
+	   pipe_request();
 
-	/*--------------------------------*/
-	/* Broken weatherpipe (no reader) */
-	/*--------------------------------*/
+	return(0);
+}
 
 
-	else if (signum == SIGPIPE) {
-	   if (do_verbose == TRUE)
-           {  (void)fprintf(stderr,"\n    weather-board WARNING: weatherpipe has no reader\n\n");
-	      (void)fflush(stderr);
-           }
-	}
 
+/*---------------------------------------------------*/
+/* Run event loop until the next sampler tick (which */
+/* sets deadline), a rollover or reload request or   */
+/* exit                                              */
+/*---------------------------------------------------*/
 
-	/*---------------------------*/
-	/* Write data to weatherpipe */
-	/*---------------------------*/
+_PRIVATE int wait_event(long long *deadline)
 
-	else if (signum == SIGUSR2)
-	{  FILE          *pipestream         = (FILE *)NULL;
-           unsigned char datetimeStr[SSIZE]  = "";
+{   int            ret,
+                   timeout;
+    uint64_t       expirations;
+    evloop_event_t event;
 
+    while (1) {
+       timeout = (-1);
 
-	   if ((pipestream = fopen("/tmp/weatherpipe","w")) == (FILE *)NULL) {
-	      if (do_verbose == TRUE)
-              {  (void)fprintf(stderr,"\n    weather-board WARNING: failed to open weatherpipe for writingr\n\n");
-	         (void)fflush(stderr);
-              }
-	   }
-	
-
-	   else {
-              (void)fprintf(pipestream,"%s  uvi: %8.2f  vis: %8.2f lux  ir: %8.2f lux  temp: %8.2f C  humidity: %8.2f %%  dew point %8.2f C  pressure: %8.2f hpa\n",
-                                                                                                                                                        datetimeStr,
-                                                                                                                                                           uv_index,
-                                                                                                                                                                vis,
-                                                                                                                                                                 ir,
-                                                                                                                                                        temperature,
-                                                                                                                                                           humidity,
-                                                                                                                                                          dew_point,
-                                                                                                                                                           pressure);
-              (void)fflush(pipestream);
-	      (void)fclose(pipestream);
-	   }
-        }
 
-	return(0);
+       /*-----------------------------------------------*/
+       /* Time warp: handle pending events only. When   */
+       /* there are none the (virtual) clock jumps to   */
+       /* the next tick; at the end of the run we exit  */
+       /*-----------------------------------------------*/
+
+       if (vclock_virtual() == TRUE) {
+          if (sampler.next >= warp_end)
+             return(EVENT_EXIT);
+
+          timeout = 0;
+       }
+
+       switch (evloop_wait(&event,timeout)) {
+          case EVLOOP_TIMEOUT:  if (vclock_virtual() == TRUE) {
+                                   *deadline = scheduler_advance(&sampler);
+                                   return(EVENT_TICK);
+                                }
+                                break;
+
+          case EVLOOP_SIGNAL:   if ((ret = handle_signal(event.signum)) != 0)
+                                   return(ret);
+                                break;
+
+          case TAG_SAMPLER:     if ((*deadline = scheduler_expired(&sampler)) >= 0)
+                                   return(EVENT_TICK);
+                                break;
+
+          case TAG_PIPE:        pipe_write();
+                                break;
+
+          case TAG_PIPE_RETRY:  if (read(pipe_retry_fd,&expirations,sizeof(expirations)) == sizeof(expirations))
+                                   pipe_open();
+                                break;
+
+          default:              break;
+       }
+    }
 }
 
 
 
 
-/*---------------------------------------------------*/
-/*  Get current time and date in human readable form */
-/*---------------------------------------------------*/
+/*-----------------------------------------------*/
+/* Parse period, in seconds (which may be        */
+/* fractional, e.g. 0.05) or milliseconds (e.g.  */
+/* 50ms). Resolution is one millisecond          */
+/*-----------------------------------------------*/
 
-_PRIVATE void strhostdate(unsigned char *date, char *time, unsigned char *datetime)
+_PRIVATE int parse_period(const char *periodStr, unsigned int *msecs)
 
-{   time_t tval;
-    double usecs;
+{   int           n;
+    double        period;
+    unsigned char unitStr[SSIZE] = "";
 
-    unsigned char f1[SSIZE]        = "",
-                  f2[SSIZE]        = "",
-                  f3[SSIZE]        = "",
-                  f4[SSIZE]        = "",
-                  strusecs[SSIZE]  = "",
-	          tmpdate[SSIZE]   = "";
+    if ((n = sscanf(periodStr,"%lf%s",&period,unitStr)) < 1 || period <= 0.0)
+       return(-1);
 
-    struct timespec tspec;
+    if (n == 2 && strcmp(unitStr,"ms") == 0)
+       period /= 1000.0;
+    else if (n == 2 && strcmp(unitStr,"s") != 0)
+       return(-1);
 
-    (void)clock_gettime(CLOCK_REALTIME,&tspec);
-    tval  = tspec.tv_sec;
-    usecs = (double)(tspec.tv_nsec) / 1000000.0;
+    if (period > 86400.0 || (*msecs = (unsigned int)(period * 1000.0 + 0.5)) == 0)
+       return(-1);
 
-    (void)strcpy(tmpdate,ctime(&tval));
-    tmpdate[strlen(tmpdate) - 1] = '\0';
-    (void)sscanf(tmpdate,"%s%s%s%s",f1,f2,f3,f4);
+    return(0);
+}
 
 
-    /*--------------------*/
-    /* Fill in time field */
-    /*--------------------*/
 
-    if (time != (char *)NULL)
-       (void)sprintf(time,"%s",f4);
 
+/*----------------------------------------------*/
+/* Parse size in bytes, optionally with a k, M  */
+/* or G (binary) suffix, e.g. 512k              */
+/*----------------------------------------------*/
 
-    /*-----------------------------*/
-    /* Fill in abridged date field */
-    /*-----------------------------*/
+_PRIVATE int parse_size(const char *sizeStr, unsigned long long *bytes)
 
-    if (date != (unsigned char *)NULL)
-       (void)sprintf(date,"%s.%s",f3,f2);
+{   int           n;
+    double        size;
+    unsigned char unitStr[SSIZE] = "";
 
+    if ((n = sscanf(sizeStr,"%lf%s",&size,unitStr)) < 1 || size < 1.0)
+       return(-1);
 
-    /*------------------------------------*/
-    /* Fill in fully qualified date field */
-    /*------------------------------------*/
+    if (n == 2 && strcmp(unitStr,"k") == 0)
+       size *= 1024.0;
+    else if (n == 2 && strcmp(unitStr,"M") == 0)
+       size *= 1024.0*1024.0;
+    else if (n == 2 && strcmp(unitStr,"G") == 0)
+       size *= 1024.0*1024.0*1024.0;
+    else if (n == 2)
+       return(-1);
+
+    *bytes = (unsigned long long)size;
+    return(0);
+}
+
+
+
+
+/*----------------------------------------------------*/
+/* Combine BMP180 and Si702x temperatures (V1 boards) */
+/*----------------------------------------------------*/
+
+_PRIVATE float fused_temperature(float bmp180_temperature, float si702x_temperature)
+
+{   float fused;
+
+    if (do_fusion == FALSE) {
+       if (isfinite(si702x_temperature) != 0 && isfinite(bmp180_temperature) != 0)
+          return((bmp180_temperature + si702x_temperature) / 2.0);
+
+       return(isfinite(si702x_temperature) != 0 ? si702x_temperature : bmp180_temperature);
+    }
+
+    fused = (float)fusion_update(&temperature_fusion,hostsecs(),bmp180_temperature,si702x_temperature);
+
+    if (isfinite(si702x_temperature) == 0 && isfinite(bmp180_temperature) == 0)
+       return(NAN);
+
+    return(fused);
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Record the outcome of a read of sensor (a    */
+/* sensor failing repeatedly is marked absent   */
+/* and re-probed in the background)             */
+/*----------------------------------------------*/
+
+_PRIVATE _BOOLEAN sensor_read(int sensor, _BOOLEAN ok)
+
+{   _BOOLEAN present = health_present(sensor);
+
+    health_read(sensor,ok,hostsecs());
+
+    if (present == TRUE && health_present(sensor) == FALSE && do_verbose == TRUE) {
+       (void)fprintf(stderr,"    weatherboard WARNING: %s absent after %d failed reads (re-probing in background)\n",health_name(sensor),HEALTH_FAILURES);
+       (void)fflush(stderr);
+    }
+
+    return(ok);
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Run the acquisition tasks in mask due. Channels  */
+/* of tasks which are not due keep their last value */
+/* while those of absent or failing sensors are set */
+/* to nan. Returns the mask of tasks which got      */
+/* fresh values                                     */
+/*--------------------------------------------------*/
+
+_PRIVATE unsigned int acquire_sensors(unsigned int due)
+
+{   s32          uncomp_temperature,
+                 uncomp_pressure,
+                 uncomp_humidity,
+                 itemperature;
+    unsigned int valid = 0;
+
+    if (do_simulate == TRUE) {
+       if ((due & TASK_BIT(TASK_LIGHT)) != 0)
+          simbus_read_light(hostsecs(),&uv_index,&vis,&ir);
+
+       if ((due & (TASK_BIT(TASK_PRESSURE) | TASK_BIT(TASK_HUMIDITY))) != 0) {
+          float t,
+                h,
+                p;
+
+          simbus_read_bme280(hostsecs(),&t,&h,&p);
+
+          if ((due & TASK_BIT(TASK_PRESSURE)) != 0)
+             pressure = p;
+
+          if ((due & TASK_BIT(TASK_HUMIDITY)) != 0) {
+             temperature = t;
+             humidity    = h;
+          }
+       }
+
+       return(due);
+    }
+
+    if ((due & TASK_BIT(TASK_LIGHT)) != 0) {
+       if (health_present(SENSOR_SI1132) == TRUE) {
+          uv_index = Si1132_readUV()/100.0;
+          vis      = Si1132_readVisible()/100.0;
+          ir       = Si1132_readIR()/100.0;
+
+          if (sensor_read(SENSOR_SI1132,Si1132_failed() == TRUE ? FALSE : TRUE) == TRUE)
+             valid |= TASK_BIT(TASK_LIGHT);
+       }
+
+       if ((valid & TASK_BIT(TASK_LIGHT)) == 0)
+          uv_index = vis = ir = NAN;
+    }
+
+    if (WBVersion == 2 && (due & (TASK_BIT(TASK_PRESSURE) | TASK_BIT(TASK_HUMIDITY))) != 0) {
+
+
+       /*-----------------------------------------------*/
+       /* One burst read of the raw data registers then */
+       /* compensate what is due (pressure and humidity */
+       /* need the fine temperature so temperature is   */
+       /* always compensated). The temperature channel  */
+       /* is only updated along with humidity           */
+       /*-----------------------------------------------*/
+
+       if (health_present(SENSOR_BME280) == TRUE &&
+           sensor_read(SENSOR_BME280,bme280_read_uncomp_pressure_temperature_humidity(&uncomp_pressure,&uncomp_temperature,&uncomp_humidity) == 0 ? TRUE : FALSE) == TRUE) {
+          itemperature = bme280_compensate_temperature_int32(uncomp_temperature);
+
+          if ((due & TASK_BIT(TASK_PRESSURE)) != 0)
+             pressure    = (double)bme280_compensate_pressure_int32(uncomp_pressure) / 100.0 + 10.0;
+
+          if ((due & TASK_BIT(TASK_HUMIDITY)) != 0) {
+             temperature = (double)itemperature / 100.0;
+             humidity    = (double)bme280_compensate_humidity_int32(uncomp_humidity) / 1024.0;
+          }
+
+          valid |= due & (TASK_BIT(TASK_PRESSURE) | TASK_BIT(TASK_HUMIDITY));
+       } else {
+          if ((due & TASK_BIT(TASK_PRESSURE)) != 0)
+             pressure = NAN;
+
+          if ((due & TASK_BIT(TASK_HUMIDITY)) != 0)
+             temperature = humidity = NAN;
+       }
+    } else if (WBVersion == 1) {
+
+
+       /*-------------------------------------------------*/
+       /* Temperature is fused from both sensors, or      */
+       /* taken from whichever is present                 */
+       /*-------------------------------------------------*/
+
+       if ((due & TASK_BIT(TASK_HUMIDITY)) != 0) {
+          float si702x_temperature = NAN,
+                bmp180_temperature = NAN;
+
+          humidity = NAN;
+
+          if (health_present(SENSOR_SI702X) == TRUE) {
+             si702x_temperature = Si702x_readTemperature();
+             humidity           = Si702x_readHumidity();
+
+             if (sensor_read(SENSOR_SI702X,Si702x_failed() == TRUE ? FALSE : TRUE) == TRUE)
+                valid |= TASK_BIT(TASK_HUMIDITY);
+             else
+                si702x_temperature = humidity = NAN;
+          }
+
+          if (health_present(SENSOR_BMP180) == TRUE) {
+             bmp180_temperature = BMP180_readTemperature();
+
+             if (sensor_read(SENSOR_BMP180,BMP180_failed() == TRUE ? FALSE : TRUE) == FALSE)
+                bmp180_temperature = NAN;
+          }
+
+          temperature = fused_temperature(bmp180_temperature,si702x_temperature);
+       }
 
-    if (datetime != (unsigned char *)NULL) {
-       (void)sprintf(strusecs,"%.2f",usecs);
-       (void)sprintf(datetime,"%s.%s.%s-%s",f1,f2,f3,f4);
+       if ((due & TASK_BIT(TASK_PRESSURE)) != 0) {
+          pressure = NAN;
+
+          if (health_present(SENSOR_BMP180) == TRUE) {
+             pressure    = BMP180_readPressure() / 100.0;
+             altitude    = BMP180_readAltitude(SEALEVELPRESSURE_HPA);
+
+             if (sensor_read(SENSOR_BMP180,BMP180_failed() == TRUE ? FALSE : TRUE) == TRUE)
+                valid |= TASK_BIT(TASK_PRESSURE);
+             else
+                pressure = NAN;
+          }
+       }
+    }
+
+    return(valid);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* High rate path (sub-second periods): stamp     */
+/* records to the millisecond and run the BME280  */
+/* with minimal standby so a fresh conversion is  */
+/* ready every cycle                              */
+/*------------------------------------------------*/
+
+_PRIVATE void highrate_setup(long long tick_period)
+
+{   if (tick_period >= HIGHRATE_PERIOD) {
+       do_msecs = FALSE;
+       return;
+    }
+
+    do_msecs = TRUE;
+
+    if (WBVersion == 2 && do_simulate == FALSE)
+       (void)bme280_set_standby_durn(BME280_STANDBY_TIME_1_MS);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Adapt sensor periods to how fast their channels */
+/* are changing (a sensor runs at the fastest      */
+/* period any of its channels asks for)            */
+/*-------------------------------------------------*/
+
+_PRIVATE void adapt_rates(unsigned int due)
+
+{   unsigned int c,
+                 task,
+                 period;
+    double       t;
+    float        values[NCHANNELS];
+
+    if (adaptive_enabled() == FALSE)
+       return;
+
+    t = hostsecs();
+
+    values[CHAN_UVI]         = uv_index;
+    values[CHAN_VIS]         = vis;
+    values[CHAN_IR]          = ir;
+    values[CHAN_TEMPERATURE] = temperature;
+    values[CHAN_HUMIDITY]    = humidity;
+    values[CHAN_DEW_POINT]   = dew_point;
+    values[CHAN_PRESSURE]    = pressure;
+
+    for (task=0; task<N_TASKS; ++task) {
+       if ((due & TASK_BIT(task)) != 0 && task_effective[task] < task_period[task])
+          adaptive_charge(t);
+    }
+
+    for (c=0; c<NCHANNELS; ++c) {
+       if ((due & TASK_BIT(channel_task[c])) != 0)
+          (void)adaptive_update(c,t,values[c]);
+    }
+
+    for (task=0; task<N_TASKS; ++task) {
+       period = task_period[task];
+
+       for (c=0; c<NCHANNELS; ++c) {
+          if (channel_task[c] == task && adaptive_fast(c) != FALSE && adaptive_fast_period(c) < period)
+             period = adaptive_fast_period(c);
+       }
+
+       if (period != task_effective[task]) {
+          task_effective[task] = period;
+          (void)wheel_set(&sensor_wheel,task,(long long)period / tick_period);
+       }
+    }
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Effective sampling rate field (empty if rates   */
+/* are not adaptive)                               */
+/*-------------------------------------------------*/
+
+_PRIVATE unsigned char *rate_field(unsigned char *fieldStr)
+
+{   (void)strcpy(fieldStr,"");
+
+    if (adaptive_enabled() == TRUE)
+       (void)sprintf(fieldStr,"  rate: %7.3f/%7.3f/%7.3f Hz",1000.0/(double)task_effective[TASK_PRESSURE],
+                                                             1000.0/(double)task_effective[TASK_HUMIDITY],
+                                                             1000.0/(double)task_effective[TASK_LIGHT]);
+    return(fieldStr);
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Pass latest (raw) sample through spike filter */
+/*-----------------------------------------------*/
+
+_PRIVATE void filter_channels(unsigned int due)
+
+{   if (filter_enabled() == FALSE)
+       return;
+
+    if ((due & TASK_BIT(TASK_LIGHT)) != 0) {
+       uv_index    = filter_apply(CHAN_UVI,        uv_index);
+       vis         = filter_apply(CHAN_VIS,        vis);
+       ir          = filter_apply(CHAN_IR,         ir);
     }
+
+    if ((due & TASK_BIT(TASK_HUMIDITY)) != 0) {
+       temperature = filter_apply(CHAN_TEMPERATURE,temperature);
+       humidity    = filter_apply(CHAN_HUMIDITY,   humidity);
+    }
+
+    if ((due & TASK_BIT(TASK_PRESSURE)) != 0)
+       pressure    = filter_apply(CHAN_PRESSURE,   pressure);
 }
 
 
 
 
-/*-------------------------------------------------------*/
-/* TRUE if /dev/null opened on specified file descriptor */
-/*-------------------------------------------------------*/
+/*-------------------------------------------------*/
+/* Feed latest sample to the streaming statistics  */
+/* (writing any summaries which are due to stream) */
+/* Only freshly acquired channels are fed          */
+/*-------------------------------------------------*/
+
+_PRIVATE void update_statistics(FILE *stream, unsigned char *datetimeStr, unsigned int due)
+
+{   double t;
+
+    if (do_stats == FALSE)
+       return;
+
+    t = hostsecs();
+    stats_emit(stream,datetimeStr,t);
+
+    if ((due & TASK_BIT(TASK_LIGHT)) != 0) {
+       stats_update(CHAN_UVI,        t,uv_index);
+       stats_update(CHAN_VIS,        t,vis);
+       stats_update(CHAN_IR,         t,ir);
+    }
+
+    if ((due & TASK_BIT(TASK_HUMIDITY)) != 0) {
+       stats_update(CHAN_TEMPERATURE,t,temperature);
+       stats_update(CHAN_HUMIDITY,   t,humidity);
+       stats_update(CHAN_DEW_POINT,  t,dew_point);
+    }
+
+    if ((due & TASK_BIT(TASK_PRESSURE)) != 0)
+       stats_update(CHAN_PRESSURE,   t,pressure);
+}
+
+
+
+
+/*---------------------------------------------*/
+/* Feed latest sample to the quantile sketches */
+/* (freshly acquired channels only)            */
+/*---------------------------------------------*/
+
+_PRIVATE void update_sketches(unsigned int due)
+
+{   if (do_sketch == FALSE)
+       return;
+
+    if ((due & TASK_BIT(TASK_LIGHT)) != 0) {
+       (void)kll_update(&sketch[CHAN_UVI],        uv_index);
+       (void)kll_update(&sketch[CHAN_VIS],        vis);
+       (void)kll_update(&sketch[CHAN_IR],         ir);
+    }
+
+    if ((due & TASK_BIT(TASK_HUMIDITY)) != 0) {
+       (void)kll_update(&sketch[CHAN_TEMPERATURE],temperature);
+       (void)kll_update(&sketch[CHAN_HUMIDITY],   humidity);
+       (void)kll_update(&sketch[CHAN_DEW_POINT],  dew_point);
+    }
+
+    if ((due & TASK_BIT(TASK_PRESSURE)) != 0)
+       (void)kll_update(&sketch[CHAN_PRESSURE],   pressure);
+}
+
+
+
+
+/*----------------------------------------------------*/
+/* Snapshot quantile sketches for logfile (written to */
+/* <logfile>.kll) and start new sketches              */
+/*----------------------------------------------------*/
+
+_PRIVATE void snapshot_sketches(unsigned char *logfile)
+
+{   unsigned int  c;
+    size_t        len;
+    unsigned char sketchfile_name[SSIZE] = "";
+
+    if (do_sketch == FALSE)
+       return;
+
+    (void)snprintf(sketchfile_name,SSIZE,"%s",logfile);
+    if ((len = strlen(sketchfile_name)) > 3 && strcmp(sketchfile_name + len - 3,".gz") == 0)
+       sketchfile_name[len - 3] = '\0';
+
+    (void)strcat(sketchfile_name,".kll");
+
+    if (kll_write_set(sketchfile_name,sketch,NCHANNELS) < 0 && do_verbose == TRUE) {
+       (void)fprintf(stderr,"    weatherboard WARNING: could not write quantile sketches \"%s\"\n",sketchfile_name);
+       (void)fflush(stderr);
+    }
+
+    for (c=0; c<NCHANNELS; ++c)
+       kll_reset(&sketch[c]);
+}
+
+
+
+
+/*--------------------------------------------------------*/
+/* Merge quantile sketch files and print p5/p50/p95 (plus */
+/* min/max) for each channel                              */
+/*--------------------------------------------------------*/
+
+_PRIVATE int print_quantiles(int n_files, char *files[])
+
+{   int   c,
+          f,
+          ret = 0;
+    kll_t merged[NCHANNELS];
+
+    for (c=0; c<NCHANNELS; ++c)
+       kll_init(&merged[c],KLL_DEFAULT_K);
+
+    for (f=0; f<n_files; ++f) {
+       if (kll_read_set(files[f],merged,NCHANNELS) < 0) {
+          (void)fprintf(stderr,"    weatherboard ERROR: could not read quantile sketches \"%s\"\n",files[f]);
+          (void)fflush(stderr);
+
+          ret = (-1);
+       }
+    }
+
+    for (c=0; c<NCHANNELS; ++c) {
+       (void)fprintf(stdout,"%-10s n: %10llu  min: %8.2f  p5: %8.2f  p50: %8.2f  p95: %8.2f  max: %8.2f\n",channel_key[c],
+                                                                                                             merged[c].n,
+                                                                                                      kll_quantile(&merged[c],0.0),
+                                                                                                      kll_quantile(&merged[c],0.05),
+                                                                                                      kll_quantile(&merged[c],0.5),
+                                                                                                      kll_quantile(&merged[c],0.95),
+                                                                                                      kll_quantile(&merged[c],1.0));
+       kll_free(&merged[c]);
+    }
+
+    (void)fflush(stdout);
+    return(ret);
+}
+
+
+
+
+/*----------------------------------------------------*/
+/* Record formatter benchmark: check n records of     */
+/* test values (typical readings, exact rounding ties */
+/* and arbitrary float bit patterns) are byte-for-    */
+/* byte the same as printf's, then time both paths    */
+/* writing to /dev/null                               */
+/*----------------------------------------------------*/
+
+_PRIVATE int bench_format(unsigned long n)
+
+{   unsigned long i,
+                  mismatched = 0;
+    uint32_t      seed       = 0x2545f491,
+                  bits;
+    long long     started,
+                  printf_ns,
+                  recfmt_ns;
+    int           len;
+    float         *value     = (float *)NULL;
+    char          datetime[TSTAMP_SIZE],
+                  reference[RECFMT_SIZE],
+                  record[RECFMT_SIZE];
+    FILE          *null      = (FILE *)NULL;
+
+    if ((value = (float *)malloc(n * NCHANNELS * sizeof(float))) == (float *)NULL || (null = fopen("/dev/null","w")) == (FILE *)NULL) {
+       (void)fprintf(stderr,"    weatherboard ERROR: could not set up record formatter benchmark\n");
+       (void)fflush(stderr);
+
+       return(-1);
+    }
+
+    for (i=0; i<n*NCHANNELS; ++i) {
+       seed ^= seed << 13;
+       seed ^= seed >> 17;
+       seed ^= seed << 5;
+
+       if (i % 16 == 15) {
+          bits = seed;
+          (void)memcpy((void *)&value[i],(void *)&bits,sizeof(float));
+       } else if (i % 16 == 7)
+          value[i] = (float)((int)(seed % 80001) - 40000) / 8.0;
+       else
+          value[i] = (float)((double)seed / 4294967296.0 * 2100.0 - 50.0);
+    }
+
+    (void)tstamp_format(datetime,vclock_now(),TSTAMP_LEGACY,FALSE);
+
+    for (i=0; i<n; ++i) {
+       float *v = &value[i*NCHANNELS];
+
+       (void)snprintf(reference,RECFMT_SIZE,RECFMT_PRINTF,datetime,v[CHAN_UVI],v[CHAN_VIS],v[CHAN_IR],v[CHAN_TEMPERATURE],v[CHAN_HUMIDITY],v[CHAN_DEW_POINT],v[CHAN_PRESSURE],"","");
+
+       if (recfmt_record(record,RECFMT_SIZE,datetime,v,"","") < 0 || strcmp(record,reference) != 0) {
+          if (mismatched++ == 0)
+             (void)fprintf(stderr,"    mismatch:\n    printf: %s    recfmt: %s",reference,record);
+       }
+    }
+
+    started = scheduler_now();
+    for (i=0; i<n; ++i) {
+       float *v = &value[i*NCHANNELS];
+
+       (void)fprintf(null,RECFMT_PRINTF,datetime,v[CHAN_UVI],v[CHAN_VIS],v[CHAN_IR],v[CHAN_TEMPERATURE],v[CHAN_HUMIDITY],v[CHAN_DEW_POINT],v[CHAN_PRESSURE],"","");
+    }
+    printf_ns = scheduler_now() - started;
+
+    started = scheduler_now();
+    for (i=0; i<n; ++i) {
+       if ((len = recfmt_record(record,RECFMT_SIZE,datetime,&value[i*NCHANNELS],"","")) > 0)
+          (void)fwrite((void *)record,1,(size_t)len,null);
+    }
+    recfmt_ns = scheduler_now() - started;
+
+    (void)fprintf(stdout,"    records      : %lu (%lu mismatched)\n",n,mismatched);
+    (void)fprintf(stdout,"    fprintf      : %8.1f ns/record\n",(double)printf_ns/(double)n);
+    (void)fprintf(stdout,"    recfmt       : %8.1f ns/record (%.1fx)\n",(double)recfmt_ns/(double)n,(double)printf_ns/(double)(recfmt_ns > 0 ? recfmt_ns : 1));
+    (void)fflush(stdout);
+
+    (void)fclose(null);
+    (void)free((void *)value);
+
+    return(mismatched == 0 ? 0 : (-1));
+}
+
+
+
+
+/*-----------------------------------------------------*/
+/* Convert binary log or archive path to text records  */
+/* on standard output (as the text log has them, less  */
+/* forecast and rate fields, which are not kept), or   */
+/* print just the time and value of chan (if it is not */
+/* -1), decoding only those columns. Only records from */
+/* from to to (ms) are printed: an archive is read     */
+/* from the block holding from                         */
+/*-----------------------------------------------------*/
+
+_PRIVATE int print_binlog(const char *path, int chan, long long from, long long to)
+
+{   int                    c,
+                           len,
+                           flags,
+                           status   = 0;
+    unsigned int           i,
+                           records,
+                           *scale;
+    float                  value[NCHANNELS];
+    char                   datetime[TSTAMP_SIZE],
+                           record[RECFMT_SIZE],
+                           *key,
+                           *unit;
+    _BOOLEAN               archived = FALSE;
+    colfmt_reader_t        r;
+    archive_reader_t       a;
+    static long long       column[COLFMT_NCOLS][ARCHIVE_MAX_RECORDS];     // Largest block (archive)
+    static unsigned char   state[COLFMT_NCOLS][ARCHIVE_MAX_RECORDS];
+
+    if (colfmt_open(&r,path) == 0) {
+       scale = r.scale;
+       key   = chan >= 0 ? r.key[chan]  : "";
+       unit  = chan >= 0 ? r.unit[chan] : "";
+    } else if (archive_open(&a,path) == 0) {
+       archived = TRUE;
+       scale    = a.scale;
+       key      = chan >= 0 ? a.key[chan]  : "";
+       unit     = chan >= 0 ? a.unit[chan] : "";
+
+       if (archive_seek(&a,from) < 0)
+          status = (-1);
+    } else {
+       (void)fprintf(stderr,"    weatherboard ERROR: \"%s\" is not a binary log or archive\n",path);
+       (void)fflush(stderr);
+
+       return(-1);
+    }
+
+    while (status == 0 && (status = archived == TRUE ? archive_next(&a) : colfmt_next(&r)) > 0) {
+       records = archived == TRUE ? a.records : r.records;
+       flags   = archived == TRUE ? a.flags   : r.flags;
+       status  = 0;
+
+       if (archived == TRUE && a.t_first > to)
+          break;
+
+       for (c=0; c<COLFMT_NCOLS; ++c) {
+          if (c != COLFMT_COL_TIME && chan >= 0 && c != COLFMT_COL_CHANNEL(chan))
+             continue;
+
+          if ((archived == TRUE ? archive_column(&a,c,column[c],state[c]) : colfmt_column(&r,c,column[c],state[c])) < 0)
+             break;
+       }
+
+       if (c < COLFMT_NCOLS) {
+          status = (-1);
+          break;
+       }
+
+       for (i=0; i<records; ++i) {
+          if (column[COLFMT_COL_TIME][i] < from || column[COLFMT_COL_TIME][i] > to)
+             continue;
+
+          (void)tstamp_format(datetime,column[COLFMT_COL_TIME][i] * NSECS_PER_MSEC,flags >> COLFMT_STYLE_SHIFT,(flags & COLFMT_MSECS) != 0 ? TRUE : FALSE);
+
+          for (c=0; c<NCHANNELS; ++c) {
+             if (state[COLFMT_COL_CHANNEL(c)][i] == COLFMT_MISSING)
+                value[c] = NAN;
+             else if (state[COLFMT_COL_CHANNEL(c)][i] == COLFMT_NEGZERO)
+                value[c] = -0.0f;
+             else
+                value[c] = (float)((double)column[COLFMT_COL_CHANNEL(c)][i] / (double)scale[c]);
+          }
+
+          if (chan >= 0) {
+             len = recfmt_fixed(record,value[chan]);
+             (void)fprintf(stdout,"%s  %s: %.*s %s\n",datetime,key,len,record,unit);
+          } else if ((len = recfmt_record(record,RECFMT_SIZE,datetime,value,"",deadband_marker((int)column[COLFMT_COL_DECISION][i]))) > 0)
+             (void)fwrite((void *)record,1,(size_t)len,stdout);
+       }
+    }
+
+    if (status < 0) {
+       (void)fprintf(stderr,"    weatherboard ERROR: \"%s\" is corrupt\n",path);
+       (void)fflush(stderr);
+    }
+
+    if (archived == TRUE)
+       archive_close(&a);
+    else
+       colfmt_close(&r);
+
+    (void)fflush(stdout);
+    return(status < 0 ? (-1) : 0);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Compact binary logs into archive (appending to  */
+/* it), reporting the records added and the space  */
+/* they take                                       */
+/*-------------------------------------------------*/
+
+_PRIVATE int compact_logs(const char *archive, int nlogs, char *log[])
+
+{   int           i,
+                  status = 0;
+    long          added;
+    unsigned long records = 0;
+    long long     before  = 0,
+                  grown   = 0;
+    struct stat   st;
+
+    for (i=0; i<nlogs; ++i) {
+       before = stat(archive,&st) == 0 ? (long long)st.st_size : 0;
+
+       if ((added = archive_compact(archive,log[i])) < 0) {
+          (void)fprintf(stderr,"    weatherboard ERROR: could not compact \"%s\" into \"%s\"\n",log[i],archive);
+          (void)fflush(stderr);
+
+          status = (-1);
+          continue;
+       }
+
+       if (stat(archive,&st) == 0)
+          grown += (long long)st.st_size - before;
+
+       records += (unsigned long)added;
+       (void)fprintf(stdout,"    %s: %ld records in %u blocks\n",log[i],added,archive_blocks());
+    }
+
+    if (records > 0)
+       (void)fprintf(stdout,"    archive: %lu records in %lld bytes (%.2f bytes/record, %.2f bytes/value)\n",records,grown,
+                                                                    (double)grown/(double)records,(double)grown/(double)(records*NCHANNELS));
+    (void)fflush(stdout);
+
+    return(status);
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Archive a rotated binary log (on the rotation    */
+/* thread)                                          */
+/*--------------------------------------------------*/
+
+_PRIVATE int archive_log(const char *path)
+
+{   return(archive_compact(archive_name,path) < 0 ? (-1) : 0);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Parse a time yyyy-mm-dd[Thh:mm[:ss]] (local, as */
+/* time warp dates) into ms since the epoch        */
+/*-------------------------------------------------*/
+
+_PRIVATE int parse_datetime(const char *s, long long *ms)
+
+{   int       n,
+              year,
+              month,
+              day,
+              hour = 0,
+              min  = 0,
+              sec  = 0;
+    struct tm tm;
+
+    if ((n = sscanf(s,"%d-%d-%dT%d:%d:%d",&year,&month,&day,&hour,&min,&sec)) < 3 || n == 4)
+       return(-1);
+
+    (void)memset((void *)&tm,0,sizeof(struct tm));
+    tm.tm_year  = year - 1900;
+    tm.tm_mon   = month - 1;
+    tm.tm_mday  = day;
+    tm.tm_hour  = hour;
+    tm.tm_min   = min;
+    tm.tm_sec   = sec;
+    tm.tm_isdst = (-1);
+
+    *ms = (long long)mktime(&tm) * 1000LL;
+    return(0);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Update pressure tendency (if pressure is in due */
+/* mask) and build the tendency and forecast       */
+/* fields (empty if not enabled)                   */
+/*-------------------------------------------------*/
+
+_PRIVATE unsigned char *forecast_fields(unsigned char *fieldStr, unsigned int due)
+
+{   int    z,
+           tclass;
+    double tendency;
+
+    (void)strcpy(fieldStr,"");
+
+    if (do_forecast == FALSE)
+       return(fieldStr);
+
+    if ((due & TASK_BIT(TASK_PRESSURE)) != 0)
+       forecast_update(hostsecs(),pressure,temperature);
+
+    tclass = forecast_tendency(&tendency);
+    z      = forecast_zambretti(tclass);
+
+    if (tclass == TENDENCY_UNKNOWN)
+       (void)sprintf(fieldStr,"  tendency:      n/a hpa/3h (%s)  forecast: %c",forecast_tendency_name(tclass),forecast_letter(z));
+    else
+       (void)sprintf(fieldStr,"  tendency: %+8.2f hpa/3h (%s)  forecast: %c",tendency,forecast_tendency_name(tclass),forecast_letter(z));
+
+    return(fieldStr);
+}
+
+
+
+
+/*---------------------------------------------------*/
+/* Should latest sample be emitted (deadband change  */
+/* detection)? DEADBAND_OFF if deadbands not in use  */
+/*---------------------------------------------------*/
+
+_PRIVATE int emit_decision(void)
+
+{   float values[NCHANNELS];
+
+    if (deadband_enabled() == FALSE)
+       return(DEADBAND_OFF);
+
+    values[CHAN_UVI]         = uv_index;
+    values[CHAN_VIS]         = vis;
+    values[CHAN_IR]          = ir;
+    values[CHAN_TEMPERATURE] = temperature;
+    values[CHAN_HUMIDITY]    = humidity;
+    values[CHAN_DEW_POINT]   = dew_point;
+    values[CHAN_PRESSURE]    = pressure;
+
+    return(deadband_check(values,hostsecs()));
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Stream records for stream are printed to: an     */
+/* in-memory staging stream, committed to stream a  */
+/* batch at a time (handed to the writer thread in  */
+/* realtime mode)                                   */
+/*--------------------------------------------------*/
+
+_PRIVATE FILE *output_stream(FILE *stream)
+
+{   if (log_stage != (FILE *)NULL && stream != (FILE *)NULL)
+       return(log_stage);
+
+    return(stream);
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Make stream durable (on the writer thread if  */
+/* it is running, after everything queued)       */
+/*-----------------------------------------------*/
+
+_PRIVATE void sync_log(FILE *stream)
+
+{   if (iothread_running() == TRUE)
+       (void)iothread_sync(stream);
+    else
+       (void)logbuf_datasync(stream);
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Write text to stream (on the writer thread if */
+/* it is running; text it drops is not counted   */
+/* towards the log size)                         */
+/*-----------------------------------------------*/
+
+_PRIVATE void commit_log(FILE *stream, const char *text, size_t len)
+
+{   if (iothread_running() == TRUE) {
+       if (iothread_write(stream,text,len) < 0)
+          return;
+    } else
+       (void)logbuf_write(stream,text,len);
+
+    if (stream != stdout)
+       log_bytes += (unsigned long long)len;
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Stage the binary log's pending block (its time */
+/* stamps shown in the current style)             */
+/*------------------------------------------------*/
+
+_PRIVATE void stage_block(void)
+
+{   int flags = tstamp_style << COLFMT_STYLE_SHIFT;
+
+    if (do_msecs == TRUE)
+       flags |= COLFMT_MSECS;
+
+    if (log_stage != (FILE *)NULL)
+       (void)colfmt_block(log_stage,flags);
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Commit staged output to stream (compressed, if   */
+/* it is the gzip log) if the batch is due (or      */
+/* force is TRUE), syncing it if the policy is to   */
+/* sync every batch. The binary log's pending block */
+/* counts towards the batch and is closed with it   */
+/*--------------------------------------------------*/
+
+_PRIVATE void flush_staged(FILE *stream, _BOOLEAN force)
+
+{   long len,
+         gzlen;
+
+    if (log_stage == (FILE *)NULL || stream == (FILE *)NULL)
+       return;
+
+    (void)fflush(log_stage);
+    len = ftell(log_stage);
+
+    if (stream == bin_stream)
+       len += (long)colfmt_size();
+
+    if (logbuf_due((size_t)len,hostsecs()) == FALSE && force == FALSE)
+       return;
+
+    if (stream == bin_stream) {
+       stage_block();
+       (void)fflush(log_stage);
+       len = ftell(log_stage);
+    }
+
+    if (len > 0) {
+       if (stream != gz_stream)
+          commit_log(stream,log_stage_buf,(size_t)len);
+       else if ((gzlen = gzlog_deflate(log_stage_buf,(size_t)len,FALSE,gz_buf,sizeof(gz_buf))) > 0)
+          commit_log(stream,gz_buf,(size_t)gzlen);
+
+       if (logbuf_sync() == LOGBUF_SYNC_BATCH)
+          sync_log(stream);
+    }
+
+    rewind(log_stage);
+}
+
+
+
+
+/*--------------------------------------------*/
+/* A new log file: start its gzip stream if   */
+/* the log is compressed, and stage its file  */
+/* header if it is binary                     */
+/*--------------------------------------------*/
+
+_PRIVATE void start_logfile(FILE *stream)
+
+{   char station[SSIZE] = "";
+
+    if (stream != (FILE *)NULL && gzlog_enabled() == TRUE && gzlog_begin() == 0)
+       gz_stream = stream;
+
+    if (stream != (FILE *)NULL && do_binlog == TRUE) {
+       if (gethostname(station,SSIZE - 1) < 0)
+          (void)strcpy(station,"unknown");
+
+       bin_stream = stream;
+       (void)colfmt_header(log_stage,station,(int)WBVersion);
+    }
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Stream records currently go to: the log file, or */
+/* standard output if it is a sink (else NULL)      */
+/*--------------------------------------------------*/
+
+_PRIVATE FILE *record_stream(FILE *stream)
+
+{   if (stream != (FILE *)NULL)
+       return(stream);
+    else if (sink_enabled(stdout_sink) == TRUE)
+       return(stdout);
+
+    return((FILE *)NULL);
+}
+
+
+
+
+/*---------------------------------------------------*/
+/* Close log stream, committing what is staged (and  */
+/* syncing it under the rollover policy) first. On   */
+/* the writer thread if it is running, after         */
+/* everything queued for it. If rotated is not NULL  */
+/* the file (named rotated) has been rotated out: it */
+/* is closed (if there is no writer thread), synced, */
+/* compressed and expired in the background. A gzip  */
+/* log has its trailer written first (and a binary   */
+/* log its last block)                               */
+/*---------------------------------------------------*/
+
+_PRIVATE void close_logfile(FILE *stream, const char *rotated)
+
+{   long gzlen;
+
+    flush_staged(stream,TRUE);
+
+    if (stream == bin_stream)
+       bin_stream = (FILE *)NULL;
+
+    if (stream == gz_stream) {
+       if ((gzlen = gzlog_deflate("",0,TRUE,gz_buf,sizeof(gz_buf))) > 0)
+          commit_log(stream,gz_buf,(size_t)gzlen);
+
+       gz_stream = (FILE *)NULL;
+    }
+
+    if (rotated != (const char *)NULL && rotate_running() == TRUE && iothread_running() == FALSE) {
+       rotate_retire(stream,rotated);
+       return;
+    }
+
+    if (logbuf_sync() == LOGBUF_SYNC_ROLLOVER)
+       sync_log(stream);
+
+    if (iothread_running() == TRUE)
+       (void)iothread_close(stream,rotated != (const char *)NULL && rotate_running() == TRUE ? rotate_closed : (iothread_closed_t)NULL,rotated);
+    else
+       (void)fclose(stream);
+}
+
+
+
+
+/*----------------------------------------------------*/
+/* Roll over to a new logfile (snapshotting sketches  */
+/* for the old one). The new file is normally the one */
+/* opened ahead by the rotation thread, and the old   */
+/* one is closed (and compressed) in the background.  */
+/* If the new file cannot be opened the old one is    */
+/* kept. Returns the log stream                       */
+/*----------------------------------------------------*/
+
+_PRIVATE FILE *rollover_logfile(FILE *stream, unsigned char *eff_logfile_name)
+
+{   unsigned char datetimeStr[SSIZE]  = "",
+                  new_name[SSIZE]     = "",
+                  old_name[SSIZE]     = "";
+    FILE          *new_stream         = (FILE *)NULL;
+
+    do_rollover = FALSE;
+    strhostdate(datetimeStr);
+
+
+    /*---------------------------------------------*/
+    /* Several rollovers within a second (size     */
+    /* limit) get a sequence number                */
+    /*---------------------------------------------*/
+
+    if (strcmp(datetimeStr,last_rollStr) == 0)
+       (void)snprintf(new_name,SSIZE,"%s.%s-%u%s%s",logfile_name,datetimeStr,++roll_seq,do_binlog == TRUE ? ".wbc" : "",gzlog_enabled() == TRUE ? ".gz" : "");
+    else {
+       (void)snprintf(new_name,SSIZE,"%s.%s%s%s",logfile_name,datetimeStr,do_binlog == TRUE ? ".wbc" : "",gzlog_enabled() == TRUE ? ".gz" : "");
+       (void)strcpy(last_rollStr,datetimeStr);
+       roll_seq = 0;
+    }
+
+    if ((new_stream = rotate_take(logfile_name,new_name)) == (FILE *)NULL &&
+        (new_stream = fopen(new_name,"w"))                 == (FILE *)NULL) {
+       if (do_verbose == TRUE) {
+          (void)fprintf(stderr,"    weatherboard WARNING: problem rolling over (new logfile \"%s\"), still logging to \"%s\"\n",new_name,eff_logfile_name);
+          (void)fflush(stderr);
+       }
+
+       return(stream);
+    }
+
+    (void)strcpy(old_name,eff_logfile_name);
+    (void)strcpy(eff_logfile_name,new_name);
+
+    close_logfile(stream,old_name);
+    snapshot_sketches(old_name);
+    start_logfile(new_stream);
+
+    log_bytes = 0;
+    rotate_prepare(logfile_name);
+
+    if (do_verbose == TRUE) {
+       (void)fprintf(stderr,"    weatherboard rolling over (new logfile \"%s\")\n",eff_logfile_name);
+       (void)fflush(stderr);
+    }
+
+    return(new_stream);
+}
+
+
+
+
+/*-----------------------------------------------------*/
+/* Exit gracefully: remove weatherpipe, close logfile  */
+/* (writing its sketches) and report on the scheduler  */
+/*-----------------------------------------------------*/
+
+_PRIVATE void shutdown_daemon(FILE *stream, unsigned char *eff_logfile_name)
+
+{   int      i;
+    _BOOLEAN warped = FALSE;
+
+    if (vclock_virtual() == TRUE && sampler.next >= warp_end)
+       warped = TRUE;
+
+    (void)unlink(WEATHERPIPE);
+
+    if (stream == (FILE *)NULL)
+       flush_staged(record_stream(stream),TRUE);
+    else {
+       close_logfile(stream,(const char *)NULL);
+       snapshot_sketches(eff_logfile_name);
+    }
+
+    iothread_drain();
+    rotate_stop();
+
+    if (do_verbose == TRUE) {
+       (void)fprintf(stderr,"\n");
+       scheduler_report(&sampler,stderr);
+
+       if (iothread_running() == TRUE)
+          iothread_report(stderr);
+
+       logbuf_report(stderr);
+       gzlog_report(stderr);
+
+       if (rotate_compressed() > 0 || rotate_expired() > 0 || rotate_archived() > 0)
+          (void)fprintf(stderr,"    log rotation: %lu files compressed, %lu expired, %lu archived\n",rotate_compressed(),rotate_expired(),rotate_archived());
+
+       for (i=0; i<health_sensors(); ++i) {
+          if (health_failures(i) > 0)
+             (void)fprintf(stderr,"    sensor %s: absent %lu times, %lu re-probes (%s now)\n",health_name(i),health_failures(i),health_probes(i),
+                                                                                      health_present(i) == TRUE ? "present" : "absent");
+       }
+
+       if (vclock_virtual() == TRUE)
+          (void)fprintf(stderr,"    time warp: %.2f days of virtual time in %.2f seconds\n",(double)(vclock_now() - warp_start)/(86400.0*(double)NSECS_PER_SEC),vclock_elapsed());
+
+       if (warped == TRUE)
+          (void)fprintf(stderr,"\n    weather-board: finished\n\n");
+       else
+          (void)fprintf(stderr,"\n    weather-board: **** aborted\n\n");
+       (void)fflush(stderr);
+    }
+
+    if (warped == TRUE)
+       exit(0);
+
+    exit (255);
+}
+
+
+
+
+/*-------------------------------------------*/
+/* Sensor initialisation thread (timed)      */
+/*-------------------------------------------*/
+
+_PRIVATE int begin_bme280(const char *device)
+
+{   bme280_end();
+    return(bme280_begin(device));
+}
+
+_PRIVATE void *init_sensor(void *arg)
+
+{   sensor_init_t *sensor = (sensor_init_t *)arg;
+    long long     start   = scheduler_now();
+
+    sensor->status = sensor->begin(sensor->device);
+    sensor->took   = scheduler_now() - start;
+
+    return((void *)NULL);
+}
+
+
+
+
+/*----------------------------------------------------*/
+/* Probe the board version (BME280 chip id) once and  */
+/* initialise its sensors concurrently. Each driver   */
+/* polls its sensor until it is ready, so on return   */
+/* the first sample can be taken. With verbose a      */
+/* timing breakdown is printed (started is the time   */
+/* the daemon started)                                */
+/*----------------------------------------------------*/
+
+_PRIVATE void init_sensors(const char *device, long long started)
+
+{   unsigned int  i,
+                  n_sensors = 0;
+    long long     start,
+                  probed,
+                  ready;
+    sensor_init_t sensor[MAX_SENSORS];
+
+    (void)memset((void *)sensor,0,sizeof(sensor));
+
+    start = scheduler_now();
+    if (bme280_probe(device) < 0) {
+       WBVersion = 1;
+       fusion_init(&temperature_fusion);
+    }
+
+    probed = scheduler_now();
+
+    sensor[n_sensors].name    = "si1132";
+    sensor[n_sensors++].begin = si1132_begin;
+
+    if (WBVersion == 2) {
+       sensor[n_sensors].name    = "bme280";
+       sensor[n_sensors++].begin = begin_bme280;
+    } else {
+       sensor[n_sensors].name    = "si702x";
+       sensor[n_sensors++].begin = si702x_begin;
+       sensor[n_sensors].name    = "bmp180";
+       sensor[n_sensors++].begin = bmp180_begin;
+    }
+
+    for (i=0; i<n_sensors; ++i) {
+       sensor[i].device = device;
+
+       if (pthread_create(&sensor[i].thread,(pthread_attr_t *)NULL,init_sensor,(void *)&sensor[i]) == 0)
+          sensor[i].joinable = TRUE;
+       else
+          (void)init_sensor((void *)&sensor[i]);
+    }
+
+    for (i=0; i<n_sensors; ++i) {
+       if (sensor[i].joinable == TRUE)
+          (void)pthread_join(sensor[i].thread,(void **)NULL);
+    }
+
+    ready = scheduler_now();
+
+
+
+    /*----------------------------------------------*/
+    /* Sensors which failed are absent (and will be */
+    /* re-probed) - the others sample as normal     */
+    /*----------------------------------------------*/
+
+    for (i=0; i<n_sensors; ++i) {
+       (void)health_add(sensor[i].name,sensor[i].begin,sensor[i].status < 0 ? FALSE : TRUE,hostsecs());
+
+       if (sensor[i].status < 0 && do_verbose == TRUE) {
+          (void)fprintf(stderr,"    weatherboard WARNING: could not initialise %s (absent, re-probing in background)\n",sensor[i].name);
+          (void)fflush(stderr);
+       }
+    }
+
+    if (health_start(device) < 0) {
+       if (do_verbose == TRUE) {
+          (void)fprintf(stderr,"    weatherboard ERROR: could not start sensor re-probe thread\n");
+          (void)fflush(stderr);
+       }
+
+       exit(255);
+    }
+
+    if (do_verbose == TRUE) {
+       (void)fprintf(stderr,"    startup           :  probe (V%d board) %.1f ms,",WBVersion,(double)(probed - start)/1.0e6);
+       for (i=0; i<n_sensors; ++i)
+          (void)fprintf(stderr," %s %.1f ms%s",sensor[i].name,(double)sensor[i].took/1.0e6,i < n_sensors - 1 ? "," : "");
+       (void)fprintf(stderr," (concurrent, %.1f ms), ready %.1f ms after start\n\n",(double)(ready - probed)/1.0e6,(double)(ready - started)/1.0e6);
+       (void)fflush(stderr);
+    }
+}
+
+
+
+
+/*--------------------------------------*/
+/* Sensors without a period of their    */
+/* own are sampled at the update period */
+/*--------------------------------------*/
+
+_PRIVATE void default_periods(void)
+
+{   unsigned int i;
+
+    for (i=0; i<N_TASKS; ++i) {
+       if (task_period[i] == 0)
+          task_period[i] = update_period;
+
+       task_effective[i] = task_period[i];
+    }
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Samples are taken at absolute deadlines       */
+/* aligned to multiples of the scheduler tick    */
+/* since the epoch (no cumulative drift). The    */
+/* tick is the largest period dividing all the   */
+/* sensor periods (base and adaptive fast); the  */
+/* timer wheel says which sensors are due at     */
+/* each tick. On reload the scheduler keeps its  */
+/* timer and counts                              */
+/*-----------------------------------------------*/
+
+_PRIVATE void setup_schedule(_BOOLEAN startup)
+
+{   unsigned int i;
+
+    tick_period = task_period[0];
+    for (i=1; i<N_TASKS; ++i)
+       tick_period = wheel_gcd(tick_period,(long long)task_period[i]);
+
+    for (i=0; i<NCHANNELS; ++i) {
+       if (adaptive_fast_period(i) > 0) {
+          tick_period = wheel_gcd(tick_period,(long long)adaptive_fast_period(i));
+          adaptive_set_window(i,(double)task_period[channel_task[i]] / 1000.0);
+       }
+    }
+
+    highrate_setup(tick_period);
+
+    if (startup == TRUE)
+       scheduler_init(&sampler,tick_period * NSECS_PER_MSEC);
+    else
+       scheduler_set_period(&sampler,tick_period * NSECS_PER_MSEC);
+
+    wheel_init(&sensor_wheel,sampler.next / sampler.period);
+
+    for (i=0; i<N_TASKS; ++i)
+       (void)wheel_add(&sensor_wheel,i,(long long)task_period[i] / tick_period);
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Open log file (date stamped if it is rolled  */
+/* over), setting its effective name. Returns   */
+/* NULL on error                                */
+/*----------------------------------------------*/
+
+_PRIVATE FILE *open_logfile(unsigned char *eff_logfile_name)
+
+{   unsigned char datetimeStr[SSIZE] = "";
+    FILE          *stream            = (FILE *)NULL;
+
+    log_bytes = 0;
+
+    if (strcmp(rollover_timeStr,"") != 0 || rperiod != (-1) || rotsize > 0) {
+       strhostdate(datetimeStr);
+       (void)sprintf(eff_logfile_name,"%s.%s",logfile_name,datetimeStr);
+    } else
+       (void)strcpy(eff_logfile_name,logfile_name);
+
+    if (do_binlog == TRUE)
+       (void)strcat(eff_logfile_name,".wbc");
+
+    if (gzlog_enabled() == TRUE)
+       (void)strcat(eff_logfile_name,".gz");
+
+    if ((stream = fopen(eff_logfile_name,"w")) == (FILE *)NULL && do_verbose == TRUE) {
+       (void)fprintf(stderr,"    weatherboard ERROR: could not open logfile \"%s\"\n",eff_logfile_name);
+       (void)fflush(stderr);
+    }
+
+    return(stream);
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Current (command line) values of the settings   */
+/* which the configuration file may change         */
+/*-------------------------------------------------*/
+
+_PRIVATE void save_settings(settings_t *settings)
+
+{   (void)memset((void *)settings,0,sizeof(settings_t));
+
+    settings->update_period = update_period;
+    (void)memcpy((void *)settings->task_period,(void *)task_period,sizeof(task_period));
+    (void)strcpy(settings->logfile_name,   logfile_name);
+    (void)strcpy(settings->rollover_time,  rollover_timeStr);
+    (void)strcpy(settings->rollover_period,rollover_periodStr);
+    settings->forecast      = do_forecast;
+    settings->timestamp     = tstamp_style;
+}
+
+
+
+
+/*-------------------------------------------------*/
+/* Read configuration file path: the command line  */
+/* settings overridden by those in the file. Every */
+/* value is checked, so a bad file changes nothing */
+/* (returns -1)                                    */
+/*-------------------------------------------------*/
+
+_PRIVATE int load_settings(const char *path, settings_t *next)
+
+{   int          status,
+                 hour,
+                 minute,
+                 second;
+    unsigned int task;
+    const char   *value        = (const char *)NULL;
+    const char   *task_key[]   = { "lperiod", "pperiod", "thperiod" };   // TASK_LIGHT, TASK_PRESSURE, TASK_HUMIDITY
+    config_t     cfg;
+
+    *next = cmdline_settings;
+
+    if ((status = config_load(path,&cfg)) != 0) {
+       if (do_verbose == TRUE) {
+          if (status < 0)
+             (void)fprintf(stderr,"    weatherboard ERROR: could not read configuration file \"%s\"\n",path);
+          else
+             (void)fprintf(stderr,"    weatherboard ERROR: configuration file \"%s\" line %d: expecting <key> = <value>\n",path,status);
+          (void)fflush(stderr);
+       }
+
+       return(-1);
+    }
+
+    if ((value = config_unknown(&cfg,config_keys)) != (const char *)NULL) {
+       if (do_verbose == TRUE) {
+          (void)fprintf(stderr,"    weatherboard ERROR: configuration file \"%s\": unknown (or not reloadable) setting \"%s\"\n",path,value);
+          (void)fflush(stderr);
+       }
+
+       return(-1);
+    }
+
+    if ((value = config_get(&cfg,"uperiod")) != (const char *)NULL && parse_period(value,&next->update_period) < 0)
+       goto bad_value;
+
+    for (task=0; task<N_TASKS; ++task) {
+       if ((value = config_get(&cfg,task_key[task])) != (const char *)NULL && parse_period(value,&next->task_period[task]) < 0)
+          goto bad_value;
+    }
+
+    if ((value = config_get(&cfg,"logfile")) != (const char *)NULL) {
+       if (strcmp(value,"tty") == 0 || strcmp(value,"stdout") == 0)
+          (void)strcpy(next->logfile_name,"");
+       else
+          (void)strcpy(next->logfile_name,value);
+    }
+
+    if ((value = config_get(&cfg,"rollover")) != (const char *)NULL) {
+       if (strcmp(value,"none") != 0 && sscanf(value,"%d:%d:%d",&hour,&minute,&second) != 3)
+          goto bad_value;
+
+       (void)strcpy(next->rollover_time,strcmp(value,"none") == 0 ? "" : value);
+       (void)strcpy(next->rollover_period,"");
+    }
+
+    if ((value = config_get(&cfg,"rperiod")) != (const char *)NULL) {
+       if (strcmp(value,"none") != 0 && (sscanf(value,"%d:%d:%d",&hour,&minute,&second) != 3 || hour*3600 + minute*60 + second <= 0))
+          goto bad_value;
+
+       if (strcmp(next->rollover_time,"") != 0 && strcmp(value,"none") != 0) {
+          value = "rollover and rperiod are exclusive";
+          goto bad_value;
+       }
+
+       (void)strcpy(next->rollover_period,strcmp(value,"none") == 0 ? "" : value);
+    }
+
+    if ((value = config_get(&cfg,"forecast")) != (const char *)NULL) {
+       if (strcmp(value,"yes") == 0)
+          next->forecast = TRUE;
+       else if (strcmp(value,"no") == 0)
+          next->forecast = FALSE;
+       else
+          goto bad_value;
+    }
+
+    if ((value = config_get(&cfg,"timestamp")) != (const char *)NULL && (next->timestamp = tstamp_lookup(value)) < 0)
+       goto bad_value;
+
+    if (strcmp(next->logfile_name,"") == 0) {
+       (void)strcpy(next->rollover_time,  "");
+       (void)strcpy(next->rollover_period,"");
+    }
+
+    return(0);
+
+bad_value:
+
+    if (do_verbose == TRUE) {
+       (void)fprintf(stderr,"    weatherboard ERROR: configuration file \"%s\": bad value \"%s\"\n",path,value);
+       (void)fflush(stderr);
+    }
+
+    return(-1);
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Make next the current settings. Returns what */
+/* changed (CHANGED_PERIODS ...)                */
+/*----------------------------------------------*/
+
+_PRIVATE int apply_settings(const settings_t *next)
+
+{   int changed = 0;
+    int hour,
+        minute,
+        second;
+
+    if (next->update_period != current_settings.update_period ||
+        memcmp((void *)next->task_period,(void *)current_settings.task_period,sizeof(next->task_period)) != 0)
+       changed |= CHANGED_PERIODS;
+
+    if (strcmp(next->logfile_name,current_settings.logfile_name) != 0)
+       changed |= CHANGED_LOGFILE;
+
+    if (strcmp(next->rollover_time,  current_settings.rollover_time)   != 0 ||
+        strcmp(next->rollover_period,current_settings.rollover_period) != 0  )
+       changed |= CHANGED_ROLLOVER;
+
+    if (next->forecast != current_settings.forecast || next->timestamp != current_settings.timestamp)
+       changed |= CHANGED_FORMAT;
+
+    update_period = next->update_period;
+    (void)memcpy((void *)task_period,(void *)next->task_period,sizeof(task_period));
+    (void)strcpy(logfile_name,      next->logfile_name);
+    (void)strcpy(rollover_timeStr,  next->rollover_time);
+    (void)strcpy(rollover_periodStr,next->rollover_period);
+
+    if (strcmp(rollover_periodStr,"") != 0 && sscanf(rollover_periodStr,"%d:%d:%d",&hour,&minute,&second) == 3)
+       rperiod = (time_t)(hour*3600 + minute*60 + second);
+    else
+       rperiod = (-1);
+
+    if (strcmp(rollover_timeStr,"") != 0 && sscanf(rollover_timeStr,"%d:%d:%d",&hour,&minute,&second) == 3)
+       rollsecs = (time_t)(hour*3600 + minute*60 + second);
+    else
+       rollsecs = (-1);
+
+    do_rollover_enabled = (rollsecs != (-1) || rperiod != (-1)) ? TRUE : FALSE;
+    do_forecast         = next->forecast;
+    tstamp_style        = next->timestamp;
+
+    current_settings = *next;
+    return(changed);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Reload the configuration file (SIGHUP) and     */
+/* apply it in place. Sensors are never touched;  */
+/* the schedule is only rebuilt if periods        */
+/* changed and the log file only reopened if its  */
+/* name changed. Returns the log stream           */
+/*------------------------------------------------*/
+
+_PRIVATE FILE *reload_config(FILE *stream, unsigned char *eff_logfile_name)
+
+{   int           changed;
+    settings_t    next,
+                  previous       = current_settings;
+    unsigned char new_name[SSIZE] = "";
+    FILE          *new_stream     = (FILE *)NULL;
+
+    if (load_settings(config_name,&next) < 0) {
+       if (do_verbose == TRUE) {
+          (void)fprintf(stderr,"    weatherboard WARNING: configuration not reloaded (settings unchanged)\n");
+          (void)fflush(stderr);
+       }
+
+       return(stream);
+    }
+
+    changed = apply_settings(&next);
+
+
+    /*-------------------------------------------*/
+    /* New log file (opened before the old one   */
+    /* is closed, so a bad name changes nothing) */
+    /*-------------------------------------------*/
+
+    if ((changed & CHANGED_LOGFILE) != 0) {
+       if (strcmp(logfile_name,"") != 0 && (new_stream = open_logfile(new_name)) == (FILE *)NULL) {
+          (void)apply_settings(&previous);
+          return(stream);
+       }
+
+       if (stream != (FILE *)NULL) {
+          close_logfile(stream,(const char *)NULL);
+          snapshot_sketches(eff_logfile_name);
+       }
+
+       stream    = new_stream;
+       log_bytes = 0;
+       start_logfile(stream);
+       (void)strcpy(eff_logfile_name,new_name);
+    }
+
+    if ((changed & (CHANGED_LOGFILE | CHANGED_ROLLOVER)) != 0)
+       nowsecs = vclock_time();
+
+    if ((changed & CHANGED_PERIODS) != 0) {
+       default_periods();
+       setup_schedule(FALSE);
+       (void)scheduler_arm(&sampler);
+    }
+
+    if (do_verbose == TRUE) {
+       (void)fprintf(stderr,"    weatherboard reloaded \"%s\" (changed:%s%s%s%s%s)\n",config_name,
+                                                                             changed == 0                      ? " none"     : "",
+                                                                             (changed & CHANGED_PERIODS)  != 0 ? " periods"  : "",
+                                                                             (changed & CHANGED_LOGFILE)  != 0 ? " logfile"  : "",
+                                                                             (changed & CHANGED_ROLLOVER) != 0 ? " rollover" : "",
+                                                                             (changed & CHANGED_FORMAT)   != 0 ? " format"   : "");
+       (void)fflush(stderr);
+    }
+
+    return(stream);
+}
+
+
+
+
+/*-------------------------------------------------------*/
+/* TRUE if /dev/null opened on specified file descriptor */
+/*-------------------------------------------------------*/
+
+_PRIVATE _BOOLEAN datasink(int fdes)
+
+{   unsigned char link[SSIZE]    = "",
+	          procStr[SSIZE] = "";
+		  ;
+    ssize_t       rval;
+
+    (void)snprintf(procStr,SSIZE,"/proc/self/fd/%d",fdes);
+    if ((rval = readlink(procStr,link,sizeof(link) - 1)) < 0)
+       return(FALSE);
+
+    link[rval] = '\0';
+
+    if (strcmp(link, "/dev/null") == 0)
+       return(TRUE);
+
+    return(FALSE);
+}
+
+
+/*--------------------------------------------------*/
+/* Acquisition stage: run the tasks in due, process */
+/* the fresh values (filter, statistics, sketches,  */
+/* forecast, adaptive rate, deadband) and fill in   */
+/* sample. Statistics summaries go to stats_stream  */
+/*--------------------------------------------------*/
+
+_PRIVATE void acquire_sample(sample_t *sample, unsigned int due, FILE *stats_stream)
+
+{   unsigned int  c,
+                  valid;
+    unsigned char forecastStr[SSIZE] = "",
+                  rateStr[SSIZE]     = "";
+
+    sample->ns = vclock_now();
+    sample->t  = hostsecs();
+    (void)tstamp_format(sample->datetime,sample->ns,tstamp_style,do_msecs);
+
+    valid = acquire_sensors(due);
+    filter_channels(valid);
+
+
+    /*----------------------------------------------------------------*/
+    /* See Lawerence et al. 2005 for details of dew point calculation */
+    /*----------------------------------------------------------------*/
+
+    dew_point = temperature - ((100.0 - humidity) / 5.0);
+
+    update_statistics(stats_stream,(unsigned char *)sample->datetime,valid);
+    update_sketches(valid);
+    (void)forecast_fields(forecastStr,valid);
+    (void)rate_field(rateStr);
+    adapt_rates(valid);
+
+    sample->decision                = emit_decision();
+    sample->value[CHAN_UVI]         = uv_index;
+    sample->value[CHAN_VIS]         = vis;
+    sample->value[CHAN_IR]          = ir;
+    sample->value[CHAN_TEMPERATURE] = temperature;
+    sample->value[CHAN_HUMIDITY]    = humidity;
+    sample->value[CHAN_DEW_POINT]   = dew_point;
+    sample->value[CHAN_PRESSURE]    = pressure;
+
+    sample->fresh = 0;
+    for (c=0; c<NCHANNELS; ++c) {
+       if ((valid & TASK_BIT(channel_task[c])) != 0)
+          sample->fresh |= 1U << c;
+    }
+
+    (void)snprintf(sample->fields,SINK_SSIZE,"%s%s",forecastStr,rateStr);
+}
+
+
+
+
+/*------------------------------------------------*/
+/* Record sink (log file or standard output): a   */
+/* line per sample unless the deadband holds it   */
+/* back, committed with its batch. data is the    */
+/* (FILE **) stream, which may be NULL (no log    */
+/* file). A binary log adds the sample to its     */
+/* pending block, staging the block once it is    */
+/* full                                           */
+/*------------------------------------------------*/
+
+_PRIVATE void record_sink(const sample_t *sample, void *data)
+
+{   int  len;
+    char record[RECFMT_SIZE];
+    FILE *stream = *(FILE **)data;
+
+    if (stream == (FILE *)NULL)
+       return;
+
+    if (sample->decision != DEADBAND_SUPPRESS && stream == bin_stream) {
+       if (colfmt_add(sample->ns / NSECS_PER_MSEC,sample->decision,sample->value) < 0) {
+          stage_block();
+          (void)colfmt_add(sample->ns / NSECS_PER_MSEC,sample->decision,sample->value);
+       }
+
+       if (colfmt_size() >= BINLOG_BLOCK_MAX)
+          stage_block();
+    } else if (sample->decision != DEADBAND_SUPPRESS &&
+               (len = recfmt_record(record,RECFMT_SIZE,sample->datetime,sample->value,sample->fields,deadband_marker(sample->decision))) > 0) {
+       (void)fwrite((void *)record,1,(size_t)len,output_stream(stream));
+    }
+
+    logbuf_sample(sample->t);
+    flush_staged(stream,FALSE);
+}
+
+
+
+
+/*--------------------------------------------------*/
+/* Terminal view: the latest sample, by sensor      */
+/* (V1 boards show the fused temperature with the   */
+/* Si702x)                                          */
+/*--------------------------------------------------*/
+
+_PRIVATE void tty_sink(const sample_t *sample, void *data)
+
+{   (void)data;
+
+    clearScreen();
+
+    (void)fprintf(stdout,"\n    Weather Board (version %s)\n",WEATHERBOARD_VERSION);
+    (void)fprintf(stdout,"    M.A. O'Neill, Tumbling Dice, 2016-2023\n");
+    (void)fprintf(stdout,"\n    %s\n\n",sample->datetime);
+
+    (void)fprintf(stdout,"    ======== si1132 ========\n");
+    if (do_simulate == FALSE && health_present(SENSOR_SI1132) == FALSE)
+       (void)fprintf(stdout,"    (absent)\n");
+    else {
+       (void)fprintf(stdout,"    UV_index     : %4.2f\n",    sample->value[CHAN_UVI]);
+       (void)fprintf(stdout,"    Visible      : %6.2f Lux\n",sample->value[CHAN_VIS]);
+       (void)fprintf(stdout,"    IR           : %6.2f Lux\n",sample->value[CHAN_IR]);
+    }
+
+    if (WBVersion == 2 || do_simulate == TRUE) {
+       (void)fprintf(stdout,"    ======== bme280 ========\n");
+       if (do_simulate == FALSE && health_present(SENSOR_BME280) == FALSE)
+          (void)fprintf(stdout,"    (absent)\n");
+       else {
+          (void)fprintf(stdout,"    temperature : %4.2f 'C\n", sample->value[CHAN_TEMPERATURE]);
+          (void)fprintf(stdout,"    humidity    : %4.2f %%\n", sample->value[CHAN_HUMIDITY]);
+          (void)fprintf(stdout,"    dew point   : %4.2f C\n",  sample->value[CHAN_DEW_POINT]);
+          (void)fprintf(stdout,"    pressure    : %6.2f hPa\n",sample->value[CHAN_PRESSURE]);
+       }
+    } else {
+       (void)fprintf(stdout,"    ======== bmp180 ========\n");
+       if (health_present(SENSOR_BMP180) == FALSE)
+          (void)fprintf(stdout,"    (absent)\n");
+       else
+          (void)fprintf(stdout,"    pressure    : %6.2f hPa\n", sample->value[CHAN_PRESSURE]);
+
+       (void)fprintf(stdout,"    ======== si7020 ========\n");
+       if (health_present(SENSOR_SI702X) == FALSE)
+          (void)fprintf(stdout,"    (absent)\n");
+       else {
+          (void)fprintf(stdout,"    temperature : %4.2f 'C\n",  sample->value[CHAN_TEMPERATURE]);
+          (void)fprintf(stdout,"    humidity    : %4.2f %%\n",  sample->value[CHAN_HUMIDITY]);
+       }
+    }
+
+    (void)fflush(stdout);
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Weatherpipe sink: keep the latest sample for  */
+/* the next SIGUSR2 request                      */
+/*-----------------------------------------------*/
+
+_PRIVATE void pipe_sink(const sample_t *sample, void *data)
+
+{   (void)data;
+
+    pipe_sample  = *sample;
+    pipe_sampled = TRUE;
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Records go to standard output only if there  */
+/* is no log file or terminal view (and it is   */
+/* not /dev/null)                               */
+/*----------------------------------------------*/
+
+_PRIVATE void route_sinks(FILE *stream)
+
+{   if (stream == (FILE *)NULL && tty_view == FALSE && stdout_null == FALSE)
+       sink_enable(stdout_sink,TRUE);
+    else
+       sink_enable(stdout_sink,FALSE);
+}
+
+
+
+
+/*------------------*/
+/* main entry point */
+/*------------------*/
+
+int main(int argc, char *argv[])
+{
+	unsigned int   i;
+	unsigned int   now;
+	unsigned int   hour;
+	unsigned int   minute;
+	unsigned int   second;
+	_BOOLEAN       tty_mode                 = FALSE;
+	unsigned int   due;
+	sample_t       sample;
+	unsigned int   recovered;
+	long long      deadline;
+	_BOOLEAN       rolled                   = FALSE;
+	unsigned int   status                   = 0;
+	unsigned int   argd                     = 1;
+	unsigned char  *device                  = "/dev/i2c-1";
+	unsigned char  eff_logfile_name[SSIZE]  = "";
+	unsigned char  dateStr[SSIZE]           = "";
+	unsigned char  timeStr[SSIZE]           = "";
+	FILE           *stream                  = (FILE *)NULL;
+	long long      started                  = scheduler_now();
+
+
+        /*------------------------------------------*/
+        /* Query mode - merge quantile sketch files */
+        /*------------------------------------------*/
+
+	if (argc > 1 && strcmp(argv[1],"-quantiles") == 0) {
+	   if (argc == 2) {
+	      (void)fprintf(stderr,"    weatherboard ERROR: expecting quantile sketch file(s)\n");
+	      (void)fflush(stderr);
+
+	      exit(255);
+	   }
+
+	   exit(print_quantiles(argc - 2,&argv[2]) < 0 ? 255 : 0);
+	}
+
+
+        /*-----------------------------------------*/
+        /* Benchmark record formatter (and check   */
+        /* it against printf)                      */
+        /*-----------------------------------------*/
+
+	if (argc > 1 && strcmp(argv[1],"-benchfmt") == 0) {
+	   unsigned long n = 1000000;
+
+	   if (argc > 2 && (sscanf(argv[2],"%lu",&n) != 1 || n == 0)) {
+	      (void)fprintf(stderr,"    weatherboard ERROR: expecting number of records\n");
+	      (void)fflush(stderr);
+
+	      exit(255);
+	   }
+
+	   exit(bench_format(n) < 0 ? 255 : 0);
+	}
+
+
+        /*------------------------------------------*/
+        /* Convert binary log to text records (or   */
+        /* decode a single channel)                 */
+        /*------------------------------------------*/
+
+	if (argc > 1 && strcmp(argv[1],"-totext") == 0) {
+	   int       chan  = (-1),
+	             arg   = 3;
+	   long long from  = LLONG_MIN,
+	             to    = LLONG_MAX;
+	   char      *comma;
+
+	   if (argc > arg && (chan = channel_lookup(argv[arg])) >= 0)
+	      ++arg;
+
+	   if (argc > arg && (comma = strchr(argv[arg],',')) != (char *)NULL) {
+	      *comma++ = '\0';
+
+	      if (parse_datetime(comma,&to) < 0)
+	         arg = argc + 1;
+	   }
+
+	   if (argc > arg && (parse_datetime(argv[arg],&from) < 0 || ++arg < argc))
+	      arg = argc + 1;
+
+	   if (argc == 2 || arg > argc) {
+	      (void)fprintf(stderr,"    weatherboard ERROR: expecting binary log or archive [channel] [<from yyyy-mm-dd[Thh:mm:ss]>[,<to>]]\n");
+	      (void)fflush(stderr);
+
+	      exit(255);
+	   }
+
+	   exit(print_binlog(argv[2],chan,from,to) < 0 ? 255 : 0);
+	}
+
+
+        /*---------------------------------------*/
+        /* Compact binary logs into an archive   */
+        /*---------------------------------------*/
+
+	if (argc > 1 && strcmp(argv[1],"-compact") == 0) {
+	   if (argc < 4) {
+	      (void)fprintf(stderr,"    weatherboard ERROR: expecting archive and binary log file(s)\n");
+	      (void)fflush(stderr);
+
+	      exit(255);
+	   }
+
+	   exit(compact_logs(argv[2],argc - 3,&argv[3]) < 0 ? 255 : 0);
+	}
+
+
+        /*--------------------*/
+        /* Parse command tail */
+        /*--------------------*/
+
+	if (argc > 1) {
+		for (i=0; i<argc; ++i) {
+
+
+		   /*--------------------------*/
+		   /* Display help information */
+		   /*--------------------------*/
+
+		   if (strcmp(argv[1],"-help") == 0 || strcmp(argv[1],"-usage") == 0) {
+		      (void)fprintf(stderr,"\n    Weather Board (version %s)\n", WEATHERBOARD_VERSION);
+		      (void)fprintf(stderr,"    M.A. O'Neill, Tumbling Dice, 2016-2023\n\n");
+   		      (void)fprintf(stderr,"    Usage : [sudo] weather_board [-usage | -help]\n");
+       		      (void)fprintf(stderr,"            |\n");
+       		      (void)fprintf(stderr,"            [-quantiles <sketch file> [<sketch file>...]]\n");
+       		      (void)fprintf(stderr,"            |\n");
+       		      (void)fprintf(stderr,"            [-benchfmt [<records:1000000>] (record formatter against fprintf)]\n");
+       		      (void)fprintf(stderr,"            |\n");
+       		      (void)fprintf(stderr,"            [-totext <binary log | archive> [<chan>] [<from yyyy-mm-dd[Thh:mm:ss]>[,<to>]] (convert to text records, or one channel)]\n");
+       		      (void)fprintf(stderr,"            |\n");
+       		      (void)fprintf(stderr,"            [-compact <archive> <binary log> [<binary log>...] (append logs to a compressed archive)]\n");
+       		      (void)fprintf(stderr,"            |\n");
+	              (void)fprintf(stderr,"            [-uperiod <update period secs:%d | <msecs>ms>]\n", DEFAULT_UPDATE_PERIOD);
+	              (void)fprintf(stderr,"            [-pperiod <pressure period>] [-thperiod <temperature/humidity period>] [-lperiod <light period>]\n");
+	              (void)fprintf(stderr,"            [-adaptive <chan>[,<chan>...]=<fast period secs>:<change per minute>] ... [-abudget <fast acquisitions per hour:0 (no limit)>] [-ahold <secs:%d>]\n", (int)ADAPTIVE_DEFAULT_HOLD);
+	              (void)fprintf(stderr,"            [-config <configuration file (reloaded on SIGHUP)>]\n");
+	              (void)fprintf(stderr,"            [-realtime [-rtprio <SCHED_FIFO priority 1-99:%d>] [-cpu <pin sampler to cpu>]] [-simulate (simulated sensor bus)]\n", REALTIME_DEFAULT_PRIO);
+	              (void)fprintf(stderr,"            [-timewarp <days>[@<yyyy-mm-dd>] (run days of virtual time on the simulated bus as fast as possible)]\n");
+	              (void)fprintf(stderr,"            [-timestamp <legacy | iso | epochms:legacy>]\n");
+	              (void)fprintf(stderr,"            [-nofusion (V1 boards: average BMP180 and Si702x temperatures)]\n");
+	              (void)fprintf(stderr,"            [-forecast (pressure tendency and Zambretti forecast fields)] [-altitude <station altitude in metres:0>]\n");
+	              (void)fprintf(stderr,"            [-filter [<chan>[,<chan>...]=]<median:<N> | hampel:<N>[:<k>] | none>] ...\n");
+	              (void)fprintf(stderr,"            [-deadband [<chan>[,<chan>...]=]<delta>] ... [-heartbeat <max silence secs:%d>]\n", (int)DEADBAND_DEFAULT_HEARTBEAT);
+	              (void)fprintf(stderr,"            [-sketch (per channel quantile sketches, written to <logfile>.kll on rollover)]\n");
+	              (void)fprintf(stderr,"            [-stats <window secs>[,<window secs>...] [-ewma <alpha:%4.2f>]]\n", STATS_DEFAULT_ALPHA);
+             	      (void)fprintf(stderr,"            [-ttymode:FALSE (terminal view)] [-logfile <log file name> [-rollover <hh:mm:ss:00:00:00> | -rperiod <hh:mm:ss>]]\n");
+	              (void)fprintf(stderr,"            [-batch <period secs>[,<bytes>] (group commit log records)] [-sync <none | batch | rollover:none> (fdatasync policy)]\n");
+	              (void)fprintf(stderr,"            [-asynclog [drop | block:drop] (log writer thread, drop or wait when it falls behind)]\n");
+	              (void)fprintf(stderr,"            [-gzlog [<level 1-9:%d>] (gzip the live log, readable with zcat)]\n", GZLOG_DEFAULT_LEVEL);
+	              (void)fprintf(stderr,"            [-binlog (binary columnar log <logfile>.wbc, batch defaults to %ss)] [-archive <archive> (compact rotated binary logs into it)]\n", BINLOG_DEFAULT_BATCH);
+	              (void)fprintf(stderr,"            [-rotsize <bytes>[k | M | G] (roll over at size)] [-compress (gzip rotated logs)] [-keep <files>[,<bytes>[k | M | G]] (retention)]\n");
+              	      (void)fprintf(stderr,"            [i2c node:/dev/i2c-1]\n");
+	              (void)fprintf(stderr,"            [ >& <error/status log>]\n\n");
+	              (void)fprintf(stderr,"            Signals\n");
+	              (void)fprintf(stderr,"            =======\n\n");
+	              (void)fprintf(stderr,"            SIGUSR1  (%02d): force file rollover\n\n", SIGUSR1);
+		      (void)fprintf(stderr,"            SIGINT   (%02d):\n", SIGINT);
+		      (void)fprintf(stderr,"            SIGQUIT  (%02d):\n", SIGQUIT);
+		      (void)fprintf(stderr,"            SIGHUP   (%02d): (reload configuration file if -config given)\n", SIGHUP);
+		      (void)fprintf(stderr,"            SIGERM   (%02d): exit gracefully\n\n", SIGTERM);
+	              (void)fprintf(stderr,"            SIGUSR2  (%02d): write latest data to weatherpipe\n\n", SIGUSR2);
+                      (void)fflush(stderr);
+
+	              exit(1);
+                   } 
+
+
+	           /*----------------*/
+	           /* Verbosity flag */
+	           /*----------------*/
+
+	           else if (strcmp(argv[i],"-verbose") == 0) {
+	              do_verbose = TRUE;
+	              ++argd;
+	           }
+
+
+		   /*-------------------------------*/
+		   /* Pretty print data to terminal */
+		   /*-------------------------------*/
+
+		   else if (strcmp(argv[i],"-ttymode") == 0 || (i < argc - 1 && strcmp(argv[i+1],"ttymode") == 0))
+		   {  tty_mode = TRUE;
+                      ++argd;
+                   }
+
+
+	           /*-------------------*/
+	           /* Set update period */
+	           /*-------------------*/
+
+	           else if (strcmp(argv[i],"-uperiod") == 0) {
+ 	              if (i == argc - 1 || argv[i + 1][0] == '-') {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting update period in seconds\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+                      if (parse_period(argv[i+1],&update_period) < 0) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+   		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting time period <secs> or <msecs>ms (>= 1 ms)\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+	              }
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*------------------------------------------*/
+	           /* Set per sensor (acquisition task) period */
+	           /*------------------------------------------*/
+
+	           else if (strcmp(argv[i],"-lperiod")  == 0 ||
+	                    strcmp(argv[i],"-pperiod")  == 0 ||
+	                    strcmp(argv[i],"-thperiod") == 0  ) {
+	              unsigned int task;
+
+	              if (strcmp(argv[i],"-lperiod") == 0)
+	                 task = TASK_LIGHT;
+	              else if (strcmp(argv[i],"-pperiod") == 0)
+	                 task = TASK_PRESSURE;
+	              else
+	                 task = TASK_HUMIDITY;
+
+ 	              if (i == argc - 1 || parse_period(argv[i+1],&task_period[task]) < 0) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting %s period <secs> or <msecs>ms (>= 1 ms)\n",argv[i]);
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*-----------------------------------------*/
+	           /* Adaptive sampling rate (may be given    */
+	           /* more than once)                         */
+	           /*-----------------------------------------*/
+
+	           else if (strcmp(argv[i],"-adaptive") == 0) {
+ 	              if (i == argc - 1 || argv[i + 1][0] == '-' || adaptive_parse(argv[i+1]) < 0) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting adaptive rate <chan>[,<chan>...]=<fast period secs>:<change per minute>\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*-----------------------------------*/
+	           /* Adaptive rate budget (fast        */
+	           /* acquisitions per hour) and hold   */
+	           /*-----------------------------------*/
+
+	           else if (strcmp(argv[i],"-abudget") == 0 || strcmp(argv[i],"-ahold") == 0) {
+	              double value;
+	              int    ret = (-1);
+
+ 	              if (i < argc - 1 && sscanf(argv[i+1],"%lf",&value) == 1)
+	                 ret = strcmp(argv[i],"-abudget") == 0 ? adaptive_set_budget(value) : adaptive_set_hold(value);
+
+	              if (ret < 0) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting %s\n",strcmp(argv[i],"-abudget") == 0 ? "fast acquisitions per hour (>= 0)" : "hold time in seconds (>= 0)");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*-----------------------------------------*/
+	           /* Configuration file (reloaded on SIGHUP) */
+	           /*-----------------------------------------*/
+
+	           else if (strcmp(argv[i],"-config") == 0) {
+ 	              if (i == argc - 1 || access(argv[i+1],R_OK) < 0) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting (readable) configuration file\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              (void)strncpy(config_name,argv[i+1],SSIZE - 1);
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*----------------------------------------*/
+	           /* Realtime (low jitter) sampling: memory */
+	           /* locked, SCHED_FIFO, log writes on a    */
+	           /* separate thread                        */
+	           /*----------------------------------------*/
+
+	           else if (strcmp(argv[i],"-realtime") == 0) {
+	              do_realtime = TRUE;
+
+	              if (log_async == (-1))
+	                 log_async = IOTHREAD_DROP;
+
+	              ++argd;
+	           }
+
+
+	           /*-------------------------------------------*/
+	           /* Log writes on a separate thread, dropping */
+	           /* (default) or waiting when it falls behind */
+	           /*-------------------------------------------*/
+
+	           else if (strcmp(argv[i],"-asynclog") == 0) {
+	              log_async = IOTHREAD_DROP;
+
+	              if (i < argc - 1 && strcmp(argv[i+1],"block") == 0) {
+	                 log_async = IOTHREAD_BLOCK;
+	                 ++argd;
+	                 ++i;
+	              }
+	              else if (i < argc - 1 && strcmp(argv[i+1],"drop") == 0) {
+	                 ++argd;
+	                 ++i;
+	              }
+
+	              ++argd;
+	           }
+
+	           else if (strcmp(argv[i],"-rtprio") == 0 || strcmp(argv[i],"-cpu") == 0) {
+	              int value;
+
+ 	              if (i == argc - 1 || sscanf(argv[i+1],"%d",&value) != 1                      ||
+	                  (strcmp(argv[i],"-rtprio") == 0 && (value < 1 || value > 99))             ||
+	                  (strcmp(argv[i],"-cpu")    == 0 && value < 0)                                 ) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting %s\n",strcmp(argv[i],"-rtprio") == 0 ? "SCHED_FIFO priority (1-99)" : "cpu number");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              if (strcmp(argv[i],"-rtprio") == 0)
+	                 rt_prio = value;
+	              else
+	                 rt_cpu  = value;
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*----------------------------------------*/
+	           /* Simulated sensor bus (no board needed) */
+	           /*----------------------------------------*/
+
+	           else if (strcmp(argv[i],"-simulate") == 0) {
+	              do_simulate = TRUE;
+	              ++argd;
+	           }
+
+
+	           /*------------------------------------------*/
+	           /* Time warp: run <days> of virtual time    */
+	           /* (from local midnight on <yyyy-mm-dd>, or */
+	           /* from now) on the simulated bus as fast   */
+	           /* as possible, then exit                   */
+	           /*------------------------------------------*/
+
+	           else if (strcmp(argv[i],"-timewarp") == 0) {
+	              int       n     = 0,
+	                        year,
+	                        month,
+	                        day;
+	              double    days  = 0.0;
+	              long long start;
+	              struct tm tm;
+
+ 	              if (i == argc - 1                                                                     ||
+	                  (n = sscanf(argv[i+1],"%lf@%d-%d-%d",&days,&year,&month,&day)) < 1 || days <= 0.0 ||
+	                  (n > 1 && n < 4)                                                                      ) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting <days>[@<yyyy-mm-dd>]\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              if (n == 4) {
+	                 (void)memset((void *)&tm,0,sizeof(struct tm));
+	                 tm.tm_year  = year - 1900;
+	                 tm.tm_mon   = month - 1;
+	                 tm.tm_mday  = day;
+	                 tm.tm_isdst = (-1);
+
+	                 start = (long long)mktime(&tm) * NSECS_PER_SEC;
+	              } else
+	                 start = vclock_now();
+
+	              vclock_warp(start);
+	              warp_start  = start;
+	              warp_end    = start + (long long)(days * 86400.0 * (double)NSECS_PER_SEC);
+	              do_simulate = TRUE;
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*--------------------------------------*/
+	           /* Use simple average of V1 temperature */
+	           /* sources rather than Kalman fusion    */
+	           /*--------------------------------------*/
+
+	           else if (strcmp(argv[i],"-nofusion") == 0) {
+	              do_fusion = FALSE;
+	              ++argd;
+	           }
+
+
+	           /*----------------------------------------*/
+	           /* Add pressure tendency and forecast to  */
+	           /* log records                            */
+	           /*----------------------------------------*/
+
+	           else if (strcmp(argv[i],"-forecast") == 0) {
+	              do_forecast = TRUE;
+	              ++argd;
+	           }
+
+
+	           /*---------------------------------------*/
+	           /* Station altitude (sea level reduction */
+	           /* of pressure for forecast)             */
+	           /*---------------------------------------*/
+
+	           else if (strcmp(argv[i],"-altitude") == 0) {
+	              double metres;
+
+ 	              if (i == argc - 1 || sscanf(argv[i+1],"%lf",&metres) != 1) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting station altitude in metres\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+		      forecast_set_altitude(metres);
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*----------------------------------*/
+	           /* Record time stamp format         */
+	           /*----------------------------------*/
+
+	           else if (strcmp(argv[i],"-timestamp") == 0) {
+ 	              if (i == argc - 1 || (tstamp_style = tstamp_lookup(argv[i+1])) < 0) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting time stamp format (legacy, iso or epochms)\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*-------------------------------------*/
+	           /* Group commit: log batch period and  */
+	           /* (optional) size                     */
+	           /*-------------------------------------*/
+
+	           else if (strcmp(argv[i],"-batch") == 0) {
+ 	              if (i == argc - 1 || argv[i + 1][0] == '-' || logbuf_parse_batch(argv[i+1]) < 0) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting log batch <period secs>[,<bytes>]\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*-----------------------------------*/
+	           /* Log durability (fdatasync) policy */
+	           /*-----------------------------------*/
+
+	           else if (strcmp(argv[i],"-sync") == 0) {
+ 	              if (i == argc - 1 || logbuf_set_sync(argv[i+1]) < 0) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting sync policy (none, batch or rollover)\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*----------------------------------------*/
+	           /* Compress the live log (gzip, flushed a */
+	           /* batch at a time)                       */
+	           /*----------------------------------------*/
+
+	           else if (strcmp(argv[i],"-gzlog") == 0) {
+	              int level = GZLOG_DEFAULT_LEVEL;
+
+	              if (i < argc - 1 && argv[i+1][0] != '-' && sscanf(argv[i+1],"%d",&level) == 1) {
+	                 ++argd;
+	                 ++i;
+	              }
+
+	              if (gzlog_enable(level) < 0) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting gzip compression level (1-9)\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              ++argd;
+	           }
+
+
+	           /*-------------------------------------*/
+	           /* Roll log over once it reaches size  */
+	           /*-------------------------------------*/
+
+	           else if (strcmp(argv[i],"-rotsize") == 0) {
+ 	              if (i == argc - 1 || parse_size(argv[i+1],&rotsize) < 0) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting rollover size <bytes>[k | M | G]\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*----------------------------------------*/
+	           /* Binary (columnar) log file, a block of */
+	           /* records per batch                      */
+	           /*----------------------------------------*/
+
+	           else if (strcmp(argv[i],"-binlog") == 0) {
+	              do_binlog = TRUE;
+	              ++argd;
+	           }
+
+
+	           /*---------------------------------------*/
+	           /* Compact rotated binary logs into an   */
+	           /* archive                               */
+	           /*---------------------------------------*/
+
+	           else if (strcmp(argv[i],"-archive") == 0) {
+ 	              if (i == argc - 1 || argv[i + 1][0] == '-') {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting archive file name\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              (void)strncpy(archive_name,argv[i+1],SSIZE - 1);
+	              argd += 2;
+	              ++i;
+	           }
+
+
+	           /*-----------------------------------*/
+	           /* Compress rotated log files (gzip) */
+	           /*-----------------------------------*/
+
+	           else if (strcmp(argv[i],"-compress") == 0) {
+	              do_compress = TRUE;
+	              ++argd;
+	           }
+
+
+	           /*---------------------------------------*/
+	           /* Retention: rotated log files (and     */
+	           /* optionally bytes of them) to keep     */
+	           /*---------------------------------------*/
+
+	           else if (strcmp(argv[i],"-keep") == 0) {
+	              char *sizeStr = (char *)NULL;
+
+ 	              if (i < argc - 1 && (sizeStr = strchr(argv[i+1],',')) != (char *)NULL)
+	                 ++sizeStr;
+
+ 	              if (i == argc - 1 || sscanf(argv[i+1],"%u",&keep_files) != 1 ||
+	                  (sizeStr != (char *)NULL && parse_size(sizeStr,&keep_bytes) < 0)) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting <files to keep (0 no limit)>[,<bytes>[k | M | G]]\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*-----------------------------------*/
+	           /* Set spike rejection filter (may   */
+	           /* be given more than once)          */
+	           /*-----------------------------------*/
+
+	           else if (strcmp(argv[i],"-filter") == 0) {
+ 	              if (i == argc - 1 || argv[i + 1][0] == '-' || filter_parse(argv[i+1]) < 0) {
+
+
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
+
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting filter [<chan>[,<chan>...]=]<median:<N> | hampel:<N>[:<k>] | none> (N = 3, 5, 7 or 9)\n");
+		            (void)fflush(stderr);
+		         }
+
+		         exit(255);
+                      }
 
-_PRIVATE _BOOLEAN datasink(int fdes)
+	              argd += 2;
+	              ++i;
+                   }
 
-{   unsigned char link[SSIZE]    = "",
-	          procStr[SSIZE] = "";
-		  ;
-    ssize_t       rval;
 
-    (void)snprintf(procStr,SSIZE,"/proc/self/fd/%d",fdes);
-    rval       = readlink(procStr,link,sizeof(link));
-    link[rval] = '\0';
+	           /*------------------------------------*/
+	           /* Set channel deadband (may be given */
+	           /* more than once)                    */
+	           /*------------------------------------*/
 
-    if (strcmp(link, "/dev/null") == 0)
-       return(TRUE);
+	           else if (strcmp(argv[i],"-deadband") == 0) {
+ 	              if (i == argc - 1 || argv[i + 1][0] == '-' || deadband_parse(argv[i+1]) < 0) {
 
-    return(FALSE);
-}
 
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
 
-/*------------------*/
-/* main entry point */
-/*------------------*/
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting deadband [<chan>[,<chan>...]=]<delta> (delta >= 0)\n");
+		            (void)fflush(stderr);
+		         }
 
-int main(int argc, char *argv[])
-{
-	unsigned int   i;
-	unsigned int   now;
-	unsigned int   rhour;
-	unsigned int   rminute;
-	unsigned int   rsecond;
-	unsigned int   hour;
-	unsigned int   minute;
-	unsigned int   second;
-	_BOOLEAN       tty_mode                 = FALSE;
-	unsigned int   update_period            = DEFAULT_UPDATE_PERIOD;
-	unsigned int   status                   = 0;
-	unsigned int   WBVersion                = 2;
-	unsigned int   argd                     = 1;
-	unsigned char  *device                  = "/dev/i2c-1";
-	unsigned char  rollover_timeStr[SSIZE]  = "";
-	unsigned char  eff_logfile_name[SSIZE]  = "";
-	unsigned char  dateStr[SSIZE]           = "";
-	unsigned char  timeStr[SSIZE]           = "";
-	unsigned char  datetimeStr[SSIZE]       = "";
-	FILE           *stream                  = (FILE *)NULL;
+		         exit(255);
+                      }
 
+	              argd += 2;
+	              ++i;
+                   }
 
-        /*--------------------*/
-        /* Parse command tail */
-        /*--------------------*/
 
-	if (argc > 1) {
-		for (i=0; i<argc; ++i) {
+	           /*----------------------------------*/
+	           /* Set deadband heartbeat (maximum  */
+	           /* interval between records)        */
+	           /*----------------------------------*/
 
+	           else if (strcmp(argv[i],"-heartbeat") == 0) {
+	              double hbsecs;
 
-		   /*--------------------------*/
-		   /* Display help information */
-		   /*--------------------------*/
+ 	              if (i == argc - 1 || sscanf(argv[i+1],"%lf",&hbsecs) != 1 || deadband_set_heartbeat(hbsecs) < 0) {
 
-		   if (strcmp(argv[1],"-help") == 0 || strcmp(argv[1],"-usage") == 0) {
-		      (void)fprintf(stderr,"\n    Weather Board (version %s)\n", WEATHERBOARD_VERSION);
-		      (void)fprintf(stderr,"    M.A. O'Neill, Tumbling Dice, 2016-2023\n\n");
-   		      (void)fprintf(stderr,"    Usage : [sudo] weather_board [-usage | -help]\n");
-       		      (void)fprintf(stderr,"            |\n");
-	              (void)fprintf(stderr,"            [-uperiod <update period in secs:%d>]\n", DEFAULT_UPDATE_PERIOD);
-             	      (void)fprintf(stderr,"            [-ttymode:FALSE] | [-logfile <log file name> [-rollover <hh:mm:ss:00:00:00> | -rperiod <hh:mm:ss>]]\n");
-              	      (void)fprintf(stderr,"            [i2c node:/dev/i2c-1]\n");
-	              (void)fprintf(stderr,"            [ >& <error/status log>]\n\n");
-	              (void)fprintf(stderr,"            Signals\n");
-	              (void)fprintf(stderr,"            =======\n\n");
-	              (void)fprintf(stderr,"            SIGUSR1  (%02d): force file rollover\n\n", SIGUSR1);
-		      (void)fprintf(stderr,"            SIGINT   (%02d):\n", SIGINT);
-		      (void)fprintf(stderr,"            SIGQUIT  (%02d):\n", SIGQUIT);
-		      (void)fprintf(stderr,"            SIGHUP   (%02d):\n", SIGHUP);
-		      (void)fprintf(stderr,"            SIGERM   (%02d): exit gracefully\n\n", SIGTERM);
-	              (void)fprintf(stderr,"            SIGUSR2  (%02d): write latest data to weatherpipe\n\n", SIGUSR2);
-                      (void)fflush(stderr);
 
-	              exit(1);
-                   } 
+			 /*-------*/
+			 /* Error */
+			 /*-------*/
 
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting heartbeat period in seconds (> 0)\n");
+		            (void)fflush(stderr);
+		         }
 
-	           /*----------------*/
-	           /* Verbosity flag */
-	           /*----------------*/
+		         exit(255);
+                      }
 
-	           else if (strcmp(argv[i],"-verbose") == 0) {
-	              do_verbose = TRUE;
-	              ++argd;
-	           }
+	              argd += 2;
+	              ++i;
+                   }
 
 
-		   /*-------------------------------*/
-		   /* Pretty print data to terminal */
-		   /*-------------------------------*/
+	           /*------------------------------------*/
+	           /* Keep per channel quantile sketches */
+	           /*------------------------------------*/
 
-		   else if (strcmp(argv[i+1],"ttymode") == 0)
-		   {  tty_mode = TRUE;
-                      ++argd;
-                   }
+	           else if (strcmp(argv[i],"-sketch") == 0) {
+	              do_sketch = TRUE;
+	              ++argd;
+	           }
 
 
-	           /*-------------------*/
-	           /* Set update period */
-	           /*-------------------*/
+	           /*----------------------------------*/
+	           /* Set streaming statistics windows */
+	           /*----------------------------------*/
 
-	           else if (strcmp(argv[i],"-uperiod") == 0) {
- 	              if (i == argc - 1 || argv[i + 1][0] == '-') {
+	           else if (strcmp(argv[i],"-stats") == 0) {
+ 	              if (i == argc - 1 || argv[i + 1][0] == '-' || stats_parse_windows(argv[i+1]) < 0) {
 
 
 			 /*-------*/
@@ -362,27 +3254,39 @@ int main(int argc, char *argv[])
 			 /*-------*/
 
 		         if (do_verbose == TRUE) {
-		            (void)fprintf(stderr,"    weatherboard ERROR: expecting update period in seconds\n");
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting statistics window(s) in seconds (<secs>[,<secs>...], at most %d)\n",STATS_MAX_WINDOWS);
 		            (void)fflush(stderr);
 		         }
 
 		         exit(255);
                       }
 
-                      if (sscanf(argv[i+1],"%d",&update_period) != 1 || update_period <= 0) {
+		      do_stats = TRUE;
+
+	              argd += 2;
+	              ++i;
+                   }
+
+
+	           /*-------------------------------------*/
+	           /* Set statistics EWMA smoothing alpha */
+	           /*-------------------------------------*/
+
+	           else if (strcmp(argv[i],"-ewma") == 0) {
+ 	              if (i == argc - 1 || sscanf(argv[i+1],"%lf",&ewma_alpha) != 1 || ewma_alpha <= 0.0 || ewma_alpha > 1.0) {
 
 
 			 /*-------*/
 			 /* Error */
 			 /*-------*/
 
-   		         if (do_verbose == TRUE) {
-		            (void)fprintf(stderr,"    weatherboard ERROR: expecting time period in seconds (integer > 0)\n");
+		         if (do_verbose == TRUE) {
+		            (void)fprintf(stderr,"    weatherboard ERROR: expecting EWMA alpha (0.0 < alpha <= 1.0)\n");
 		            (void)fflush(stderr);
 		         }
 
 		         exit(255);
-	              }
+                      }
 
 	              argd += 2;
 	              ++i;
@@ -439,7 +3343,18 @@ int main(int argc, char *argv[])
                          exit(255);
                       }
 
+		      if (sscanf(argv[i+1],"%d:%d:%d",&hour,&minute,&second) != 3) {
+		         if (do_verbose == TRUE) {
+                            (void)fprintf(stderr,"    weatherboard ERROR: expecting rollover time <hh:mm:ss> (24 hour clock)\n");
+                            (void)fflush(stderr);
+                         }
+
+                         exit(255);
+		      }
+
                       (void)strcpy(rollover_timeStr,argv[i+1]);
+
+		      rollsecs            = (time_t)(hour*3600 + minute*60 + second);
 		      do_rollover_enabled = TRUE;
 
                       argd += 2;
@@ -535,8 +3450,8 @@ int main(int argc, char *argv[])
 	/* Create weatherpipe */
         /*--------------------*/
 
-        if (access("/tmp/weatherpipe", F_OK) == (-1))
-           (void)mkfifo("/tmp/weatherpipe",0666);
+        if (access(WEATHERPIPE, F_OK) == (-1))
+           (void)mkfifo(WEATHERPIPE,0666);
 
 
 
@@ -554,11 +3469,27 @@ int main(int argc, char *argv[])
         }
 
 
-        /*----------------------------------------*/
-        /* Start communication with weather board */
-        /*----------------------------------------*/
+        /*-----------------------------------------*/
+        /* Configuration file settings override    */
+        /* the command line (and may be reloaded)  */
+        /*-----------------------------------------*/
+
+	save_settings(&cmdline_settings);
+	current_settings = cmdline_settings;
 
-	si1132_begin(device);
+	if (tty_mode == TRUE && isatty(1) == 1)
+	   tty_view = TRUE;
+
+	if (strcmp(config_name,"") != 0) {
+	   settings_t settings;
+
+	   if (load_settings(config_name,&settings) < 0)
+	      exit(255);
+
+	   (void)apply_settings(&settings);
+	}
+
+	default_periods();
 
 
         /*--------------------*/
@@ -570,10 +3501,15 @@ int main(int argc, char *argv[])
 	   (void)fprintf(stderr,"\n    Weather Board (version %s)\n",WEATHERBOARD_VERSION);
 	   (void)fprintf(stderr,"    M.A. O'Neill, Tumbling Dice, 2016-2023\n\n");
 
+           if (tty_view == TRUE)
+              (void)fprintf(stderr,"    terminal view     :  on standard output\n");
+
            if (strcmp(logfile_name,"tty") == 0)
               (void)fprintf(stderr,"    terminal output mode\n");
            else {
-	      if (strcmp(logfile_name,"") == 0)
+	      if (strcmp(logfile_name,"") == 0 && tty_view == TRUE)
+                 (void)fprintf(stderr,"    logfile           :  none\n");
+	      else if (strcmp(logfile_name,"") == 0)
                  (void)fprintf(stderr,"    logfile           :  standard output\n",logfile_name);
 	      else
                  (void)fprintf(stderr,"    logfile (basename):  %s\n",logfile_name);
@@ -582,20 +3518,128 @@ int main(int argc, char *argv[])
                  (void)fprintf(stderr,"    rollover time     :  %s\n",rollover_timeStr);
 	      else if (rperiod != (-1))
 		 (void)fprintf(stderr,"    rollover period   :  %s (%d seconds)\n",rollover_periodStr,rperiod);
+
+	      if (rotsize > 0)
+		 (void)fprintf(stderr,"    rollover size     :  %llu bytes\n",rotsize);
+
+	      if (do_compress == TRUE || keep_files > 0 || keep_bytes > 0) {
+		 (void)fprintf(stderr,"    rotated logfiles  :  %s",do_compress == TRUE ? "compressed (gzip)" : "uncompressed");
+		 if (keep_files > 0)
+		    (void)fprintf(stderr,", keep %u",keep_files);
+		 if (keep_bytes > 0)
+		    (void)fprintf(stderr,", keep %llu bytes",keep_bytes);
+		 (void)fprintf(stderr,"\n");
+	      }
+           }
+
+           if (logbuf_batching() == TRUE || logbuf_sync() != LOGBUF_SYNC_NONE)
+              (void)fprintf(stderr,"    log commit        :  %s, fdatasync %s\n",logbuf_batching() == TRUE ? "batched" : "every cycle",logbuf_sync_name(logbuf_sync()));
+
+           if (strcmp(config_name,"") != 0)
+              (void)fprintf(stderr,"    config file       :  %s (reloaded on SIGHUP)\n",config_name);
+
+           (void)fprintf(stderr,"    update period     :  %g seconds\n",(double)update_period/1000.0);
+
+           if (tstamp_style != TSTAMP_LEGACY)
+              (void)fprintf(stderr,"    time stamps       :  %s\n",tstamp_name(tstamp_style));
+           (void)fprintf(stderr,"    sensor periods    :  pressure %g, temperature/humidity %g, light %g seconds\n",(double)task_period[TASK_PRESSURE]/1000.0,
+                                                                                                                   (double)task_period[TASK_HUMIDITY]/1000.0,
+                                                                                                                   (double)task_period[TASK_LIGHT]/1000.0);
+
+           if (adaptive_enabled() == TRUE) {
+              (void)fprintf(stderr,"    adaptive rate     : ");
+              for (i=0; i<NCHANNELS; ++i) {
+                 if (adaptive_fast_period(i) > 0)
+                    (void)fprintf(stderr," %s=%gs above %g/min",channel_key[i],(double)adaptive_fast_period(i)/1000.0,adaptive_threshold(i));
+              }
+
+              if (adaptive_budget() > 0.0)
+                 (void)fprintf(stderr," (hold %g seconds, budget %g fast acquisitions/hour)\n",adaptive_hold(),adaptive_budget());
+              else
+                 (void)fprintf(stderr," (hold %g seconds, no budget)\n",adaptive_hold());
+           }
+
+           if (filter_enabled() == TRUE) {
+              unsigned char filterStr[SSIZE] = "";
+
+              (void)fprintf(stderr,"    spike filter      : ");
+              for (i=0; i<NCHANNELS; ++i) {
+                 if (i != CHAN_DEW_POINT)
+                    (void)fprintf(stderr," %s=%s",channel_key[i],filter_describe(i,filterStr));
+              }
+              (void)fprintf(stderr,"\n");
+           }
+
+           if (do_forecast == TRUE)
+              (void)fprintf(stderr,"    forecast          :  pressure tendency and Zambretti (station altitude %g m)\n",forecast_altitude());
+
+           if (deadband_enabled() == TRUE) {
+              (void)fprintf(stderr,"    deadband          : ");
+              for (i=0; i<NCHANNELS; ++i) {
+                 if (deadband_threshold(i) >= 0.0)
+                    (void)fprintf(stderr," %s=%g",channel_key[i],deadband_threshold(i));
+              }
+              (void)fprintf(stderr," (heartbeat %g seconds)\n",deadband_heartbeat());
            }
 
-           (void)fprintf(stderr,"    update period     :  %04d seconds\n",update_period);
-           (void)fprintf(stderr,"    i2c bus           :  %s (sensors at i2c addresses 0x%d and 0x%d)\n\n",device,Si1132_ADDR,BMP180_ADDRESS);
+           if (do_sketch == TRUE)
+              (void)fprintf(stderr,"    quantile sketches :  KLL (k = %d) written to <logfile>.kll on rollover\n",KLL_DEFAULT_K);
+
+           if (do_stats == TRUE) {
+              (void)fprintf(stderr,"    statistics        :  ");
+              for (i=0; i<stats_n_windows(); ++i)
+                 (void)fprintf(stderr,"%s%gs",i == 0 ? "" : ",",stats_window(i));
+              (void)fprintf(stderr," windows (EWMA alpha %4.2f)\n",ewma_alpha);
+           }
+
+           if (do_realtime == TRUE) {
+              (void)fprintf(stderr,"    realtime          :  SCHED_FIFO priority %d",rt_prio);
+              if (rt_cpu != REALTIME_NO_CPU)
+                 (void)fprintf(stderr,", pinned to cpu %d",rt_cpu);
+              (void)fprintf(stderr,", memory locked\n");
+           }
+
+           if (log_async != (-1))
+              (void)fprintf(stderr,"    log writer        :  thread (%s when its ring is full)\n",log_async == IOTHREAD_BLOCK ? "wait" : "drop");
+
+           if (vclock_virtual() == TRUE) {
+              unsigned char warpStr[SSIZE] = "";
+
+              strhostdate(warpStr);
+              (void)fprintf(stderr,"    time warp         :  %g days of virtual time from %s\n",(double)(warp_end - vclock_now())/(86400.0*(double)NSECS_PER_SEC),warpStr);
+           }
+
+           if (do_simulate == TRUE)
+              (void)fprintf(stderr,"    i2c bus           :  simulated\n\n");
+           else
+              (void)fprintf(stderr,"    i2c bus           :  %s (sensors at i2c addresses 0x%d and 0x%d)\n\n",device,Si1132_ADDR,BMP180_ADDRESS);
            (void)fflush(stderr);
         }
 
 	//if (strcmp(logfile_name,"tty") == 0)
 	//   (void)sleep(5);
 
-	if (bme280_begin(device) < 0) {
-		si702x_begin(device);
-		bmp180_begin(device);
-		WBVersion = 1;
+
+        /*----------------------------------------*/
+        /* Start communication with weather board */
+        /*----------------------------------------*/
+
+	if (do_simulate == FALSE)
+	   init_sensors(device,started);
+
+
+	/*---------------------------------------------*/
+	/* Staging stream for log output (committed a  */
+	/* batch at a time)                            */
+	/*---------------------------------------------*/
+
+	if ((log_stage = fmemopen(log_stage_buf,LOGBUF_SIZE,"w")) == (FILE *)NULL) {
+	   if (do_verbose == TRUE) {
+	      (void)fprintf(stderr,"    weatherboard ERROR: could not create log staging buffer\n");
+	      (void)fflush(stderr);
+	   }
+
+	   exit(255);
 	}
 
 
@@ -603,276 +3647,283 @@ int main(int argc, char *argv[])
 	/* Set up initial logfile */
 	/*------------------------*/
 
-	if (strcmp(logfile_name,"") != 0) {
-		if (strcmp(rollover_timeStr,"") != 0 || rperiod != (-1)) {
-		   strhostdate((char *)NULL,(char *)NULL,datetimeStr);
-		   (void)sprintf(eff_logfile_name,"%s.%s",logfile_name,datetimeStr);
-		} else
-		    (void)strcpy(eff_logfile_name,logfile_name);
+	if (strcmp(logfile_name,"") != 0 && (stream = open_logfile(eff_logfile_name)) == (FILE *)NULL)
+	   exit(255);
 
-		if ((stream = fopen(eff_logfile_name,"w")) == (FILE *)NULL) {
-		   if (do_verbose == TRUE) {
-		      (void)fprintf(stderr,"    weatherboard ERROR: could not open logfile \"%s\"\n",eff_logfile_name);
-		      (void)fflush(stderr);
-		   }
+	start_logfile(stream);
 
-		   exit(255);
-		}
+
+	/*------------------------------------------------*/
+	/* Sample sinks: log file, standard output (if    */
+	/* there is no log file or terminal view and it   */
+	/* is not /dev/null), terminal view, weatherpipe  */
+	/*------------------------------------------------*/
+
+	stdout_stream = stdout;
+	stdout_null   = datasink(1);
+
+	(void)sink_register(record_sink,(void *)&stream,TRUE);
+	stdout_sink = sink_register(record_sink,(void *)&stdout_stream,FALSE);
+	(void)sink_register(tty_sink,(void *)NULL,tty_view);
+	(void)sink_register(pipe_sink,(void *)NULL,TRUE);
+
+	route_sinks(stream);
+
+
+
+	/*-----------------------------------------------*/
+	/* Set up quantile sketches/streaming statistics */
+	/*-----------------------------------------------*/
+
+	if (do_sketch == TRUE) {
+	   for (i=0; i<NCHANNELS; ++i)
+	      kll_init(&sketch[i],KLL_DEFAULT_K);
 	}
 
+	if (do_stats == TRUE && stats_init(ewma_alpha) < 0) {
+	   if (do_verbose == TRUE) {
+	      (void)fprintf(stderr,"    weatherboard ERROR: could not allocate streaming statistics\n");
+	      (void)fflush(stderr);
+	   }
 
+	   exit(255);
+	}
 
-	/*------------------------*/
-	/* Set up signal handlers */
-	/*------------------------*/
 
-	if (strcmp(logfile_name,"") != 0 && strcmp(logfile_name,"tty") != 0)
-	   (void)signal(SIGUSR1, (void *)&signal_handler);
+	/*------------------------------------------------*/
+	/* Set up event loop. Signals are delivered to it */
+	/* (via a signalfd) rather than to handlers. A    */
+	/* broken weatherpipe shows up as EPIPE           */
+	/*------------------------------------------------*/
 
-        (void)signal(SIGABRT, (void *)&signal_handler);
-	(void)signal(SIGQUIT, (void *)&signal_handler);
-        (void)signal(SIGINT,  (void *)&signal_handler);
-	(void)signal(SIGHUP,  (void *)&signal_handler);
-	(void)signal(SIGTERM, (void *)&signal_handler);
-        (void)signal(SIGPIPE, (void *)&signal_handler);
-	(void)signal(SIGUSR2, (void *)&signal_handler);
+        (void)signal(SIGPIPE, SIG_IGN);
 
+	if (evloop_init(loop_signals,sizeof(loop_signals)/sizeof(int)) < 0                          ||
+	    (pipe_retry_fd = timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK | TFD_CLOEXEC)) < 0   ||
+	    evloop_add(pipe_retry_fd,EPOLLIN,TAG_PIPE_RETRY) < 0                                 ) {
+	   if (do_verbose == TRUE) {
+	      (void)fprintf(stderr,"    weatherboard ERROR: could not set up event loop\n");
+	      (void)fflush(stderr);
+	   }
 
-	/*-----------*/
-        /* Main loop */
-	/*-----------*/
+	   exit(255);
+	}
 
-	if (rperiod != (-1))
-	   nowsecs = time((time_t *)NULL);
 
-	while (1) {
+	/*---------------------------------------------*/
+	/* A binary log is written a block per batch,  */
+	/* so it is always batched                     */
+	/*---------------------------------------------*/
 
-		unsigned int  itemperature,
-		              ihumidity,
-		              ipressure;
+	if (do_binlog == TRUE && logbuf_batching() == FALSE)
+	   (void)logbuf_parse_batch(BINLOG_DEFAULT_BATCH);
 
-                unsigned char dateStr[SSIZE]      = "",
-		              timeStr[SSIZE]      = "",
-		              datetimeStr[SSIZE]  = "";
 
+	/*-------------------------------------------------*/
+	/* Log writer thread (always used in realtime      */
+	/* mode). It is started first so it keeps normal   */
+	/* priority (and may block on the disk without     */
+	/* delaying sampling)                              */
+	/*-------------------------------------------------*/
 
-                /*----------*/
-                /* Get time */
-                /*----------*/
+	if (log_async == IOTHREAD_DROP && (gzlog_enabled() == TRUE || do_binlog == TRUE)) {
+	   log_async = IOTHREAD_BLOCK;
 
-                strhostdate((char *)NULL,(char *)NULL,datetimeStr);
+	   if (do_verbose == TRUE) {
+	      (void)fprintf(stderr,"    weatherboard WARNING: compressed or binary log cannot have gaps, log writer will wait rather than drop\n");
+	      (void)fflush(stderr);
+	   }
+	}
 
-		/*-----------------------------------*/
-		/* Produce "pretty" output if we are */
-		/* connected to a terminal           */
-		/*-----------------------------------*/
+	if (log_async != (-1) && iothread_start(log_async) < 0) {
+	   if (do_verbose == TRUE) {
+	      (void)fprintf(stderr,"    weatherboard ERROR: could not start log writer thread\n");
+	      (void)fflush(stderr);
+	   }
+
+	   exit(255);
+	}
 
-		if (tty_mode == TRUE && isatty(1) == 1) {
 
-			clearScreen();
 
-			(void)fprintf(stdout,"\n    Weather Board (version %s)\n",WEATHERBOARD_VERSION);
-	                (void)fprintf(stdout,"    M.A. O'Neill, Tumbling Dice, 2016-2023\n");
-			(void)fprintf(stdout,"\n    %s\n\n",datetimeStr);
+	/*-------------------------------------------------*/
+	/* Log rotation thread (if the log may be rotated) */
+	/* with the next log file opened ahead             */
+	/*-------------------------------------------------*/
 
-			(void)fprintf(stdout,"    ======== si1132 ========\n");
-			(void)fprintf(stdout,"    UV_index     : %4.2f\n",    Si1132_readUV()/100.0);
-			(void)fprintf(stdout,"    Visible      : %6.2f Lux\n",Si1132_readVisible()/100.0);
-			(void)fprintf(stdout,"    IR           : %6.2f Lux\n",Si1132_readIR()/100.0);
+	if (strcmp(archive_name,"") != 0 && do_binlog == FALSE) {
+	   (void)strcpy(archive_name,"");
+
+	   if (do_verbose == TRUE) {
+	      (void)fprintf(stderr,"    weatherboard WARNING: only binary logs (-binlog) are archived, -archive ignored\n");
+	      (void)fflush(stderr);
+	   }
+	}
 
-			if (WBVersion == 2) {
-				bme280_read_pressure_temperature_humidity( &ipressure, &itemperature, &ihumidity);
+	if (strcmp(archive_name,"") != 0)
+	   rotate_archiver(archive_log);
 
-				(void)fprintf(stdout,"    ======== bme280 ========\n");
-				(void)fprintf(stdout,"    temperature : %4.2f 'C\n", (float)itemperature/100.0);
-				(void)fprintf(stdout,"    humidity    : %4.2f %%\n", (float)ihumidity/1024.0);
-				(void)fprintf(stdout,"    dew point   : %4.2f C\n",  (float)(itemperature/100.0) - ((100.0 - (float)ihumidity/1024.0)) / 5.0);
-				(void)fprintf(stdout,"    pressure    : %6.2f hPa\n",(float)ipressure/100.0 + 10.0);
-				(void)fflush(stdout);
-			} else {
-				(void)fprintf(stdout,"    ======== bmp180 ========\n");
-				(void)fprintf(stdout,"    temperature : %4.2f 'C\n",  BMP180_readTemperature());
-				(void)fprintf(stdout,"    pressure    : %6.2f hPa\n", BMP180_readPressure()/100);
-				(void)fprintf(stdout,"    ======== si7020 ========\n");
-				(void)fprintf(stdout,"    temperature : %4.2f 'C\n",  Si702x_readTemperature());
-				(void)fprintf(stdout,"    humidity    : %4.2f %%\n",  Si702x_readHumidity());
-			}
+	if (do_rollover_enabled == TRUE || rotsize > 0 || strcmp(config_name,"") != 0) {
+	   if (rotate_start(do_compress,keep_files,keep_bytes) < 0) {
+	      if (do_verbose == TRUE) {
+	         (void)fprintf(stderr,"    weatherboard ERROR: could not start log rotation thread\n");
+	         (void)fflush(stderr);
+	      }
 
-			(void)fflush(stdout);
-		        (void)sleep(update_period);
+	      exit(255);
+	   }
 
-		}
-	
+	   if (stream != (FILE *)NULL && (do_rollover_enabled == TRUE || rotsize > 0))
+	      rotate_prepare(logfile_name);
+	}
 
-	        /*----------------------*/	
-	        /* Logging data to file */
-	        /*----------------------*/
-                /*-------------------*/
-                /* List style output */
-                /*-------------------*/
+	if (do_realtime == TRUE) {
+	   int failed;
 
-		else if (stream != (FILE *)NULL) {
+	   if ((failed = realtime_setup(rt_prio,rt_cpu)) != 0 && do_verbose == TRUE) {
+	      (void)fprintf(stderr,"    weatherboard WARNING: realtime mode incomplete (could not%s%s%s)\n",(failed & 1) != 0 ? " lock memory"   : "",
+	                                                                                                      (failed & 2) != 0 ? " pin cpu"       : "",
+	                                                                                                      (failed & 4) != 0 ? " set SCHED_FIFO" : "");
+	      (void)fflush(stderr);
+	   }
+	}
 
-                        uv_index = Si1132_readUV()/100.0;
-                        vis      = Si1132_readVisible()/100.0;
-                        ir       = Si1132_readIR()/100.0;
 
-                        if (WBVersion == 2) {
+	/*-----------*/
+        /* Main loop */
+	/*-----------*/
 
-                                bme280_read_pressure_temperature_humidity( &ipressure, &itemperature, &ihumidity);
+	if (rperiod != (-1))
+	   nowsecs = vclock_time();
 
-                                temperature = (double)itemperature / 100.0;
-                                humidity    = (double)ihumidity    / 1000.0;
-                                pressure    = (double)ipressure    / 100.0 + 10.0;
-                        } else {
-                                temperature = (BMP180_readTemperature() + Si702x_readTemperature()) / 2.0;
-                                humidity    = Si702x_readHumidity();
-                                pressure    = BMP180_readPressure();
-                                altitude    = BMP180_readAltitude(SEALEVELPRESSURE_HPA);
 
-                        }
+	setup_schedule(TRUE);
 
+	if (vclock_virtual() == FALSE && (scheduler_timerfd(&sampler) < 0 || evloop_add(sampler.fd,EPOLLIN,TAG_SAMPLER) < 0)) {
+	   if (do_verbose == TRUE) {
+	      (void)fprintf(stderr,"    weatherboard ERROR: could not create sampler timer\n");
+	      (void)fflush(stderr);
+	   }
 
-			/*----------------------------------------------------------------*/
-			/* See Lawerence et al. 2005 for details of dew point calculation */
-			/*----------------------------------------------------------------*/
+	   exit(255);
+	}
 
-			dew_point   = temperature - ((100.0 - humidity) / 5.0);
-                        (void)fprintf(stream,"%s  uvi: %8.2f  vis: %8.2f lux  ir: %8.2f lux  temp: %8.2f C  humidity: %8.2f %%  dew point %8.2f C  pressure: %8.2f hpa\n",
-                                                                                                                                                              datetimeStr,
-                                                                                                                                                                 uv_index,
-                                                                                                                                                                      vis,
-                                                                                                                                                                       ir,
-                                                                                                                                                              temperature,
-                                                                                                                                                                 humidity,
-																   		      	        dew_point,
-                                                                                                                                                                 pressure);
-                        (void)fflush(stream);
+	(void)scheduler_arm(&sampler);
 
+	while (1) {
 
-			/*-------------------------*/
-			/* Sleep until next update */
-			/*-------------------------*/
+		int           event;
 
-		        (void)sleep(update_period);
 
+		/*-----------------------------------*/
+		/* Wait for sampler tick or a signal */
+		/*-----------------------------------*/
 
-			/*-------------------------*/
-			/* Do we need to rollover? */
-			/*-------------------------*/
+		if ((event = wait_event(&deadline)) == EVENT_EXIT)
+		   shutdown_daemon(stream,eff_logfile_name);
 
 
-			if (do_rollover_enabled == TRUE) {
-			   if (strcmp(rollover_timeStr,"") != 0) {
-		              strhostdate(dateStr,timeStr,(char *)NULL);
+		/*-----------------------------------------*/
+		/* Rollover forced (SIGUSR1) - act at once */
+		/*-----------------------------------------*/
 
-			      (void)sscanf(rollover_timeStr,"%d:%d:%d",&rhour,&rminute,&rsecond);
-			      (void)sscanf(timeStr,         "%d:%d:%d",&hour, &minute, &second);
+		else if (event == EVENT_ROLLOVER) {
+		   if (stream != (FILE *)NULL)
+		      stream = rollover_logfile(stream,eff_logfile_name);
 
-			      rollsecs = (time_t)(rhour*3600 + rminute*60 + rsecond);
-			      nowsecs  = (time_t)(hour*3600  + minute*60  + second);
+		   continue;
+		}
 
-			      if (nowsecs >= rollsecs && nowsecs < rollsecs + update_period)
-			         do_rollover = TRUE;
-                           }
-		           else if (time((time_t *)NULL) - nowsecs >= rperiod) {
-			      nowsecs     = time((time_t *)NULL);
-			      do_rollover = TRUE;
-			   }
-                        }
 
+		/*------------------------------------------*/
+		/* Reload configuration file (SIGHUP)       */
+		/*------------------------------------------*/
 
-			/*---------------------------*/
-			/* Are we going to rollover? */
-			/*---------------------------*/
+		else if (event == EVENT_RELOAD) {
+		   if (stream == (FILE *)NULL)
+		      flush_staged(record_stream(stream),TRUE);
+		   else if (stream == bin_stream)
+		      stage_block();
 
-			if (do_rollover == TRUE) {
-			   (void)fclose(stream); 
+		   stream = reload_config(stream,eff_logfile_name);
+		   route_sinks(stream);
 
-		           strhostdate((char *)NULL,(char *)NULL,datetimeStr);
-			   (void)sprintf(eff_logfile_name,"%s.%s",logfile_name,datetimeStr);
+		   if (stream != (FILE *)NULL && (do_rollover_enabled == TRUE || rotsize > 0))
+		      rotate_prepare(logfile_name);
+		   continue;
+		}
 
-			   if ((stream = fopen(eff_logfile_name,"w")) == (FILE *)NULL) {
-	
-			      if (do_verbose == TRUE) {
-			         (void)fprintf(stderr,"    weatherboard ERROR: problem rolling over (new logfile \"%s\")\n",eff_logfile_name);
-				 (void)fflush(stderr);
-			      } 	
-	
-		 	      (void)exit(255);
-			   }
 
-			   else {
-			      if (do_verbose == TRUE) {
-                                 (void)fprintf(stderr,"    weatherboard rolling over (new logfile \"%s\")\n",eff_logfile_name);
-                                 (void)fflush(stderr);
-                              }
-			  }
+		/*--------------------------*/
+		/* Sensors due at this tick */
+		/*--------------------------*/
 
-	                   do_rollover = FALSE;	
-			}
+		due = wheel_advance(&sensor_wheel,deadline / sampler.period);
+		recovered = health_poll(hostsecs());
 
+		for (i=0; recovered != 0 && i<health_sensors(); ++i) {
+		   if ((recovered & (1U << i)) != 0 && do_verbose == TRUE) {
+		      (void)fprintf(stderr,"    weatherboard: %s back (re-probed)\n",health_name(i));
+		      (void)fflush(stderr);
+		   }
 		}
 
+		if (do_verbose == TRUE)
+		   scheduler_lagging(&sampler,stderr);
 
-	        /*----------------------------------------------------*/	
-	        /* Looging to stdout (if not redirected to /dev/null) */
-	        /*----------------------------------------------------*/
-                /*-------------------*/
-                /* List style output */
-                /*-------------------*/
 
+		/*--------------------------------------------------*/
+		/* Acquire once and publish the sample to the sinks */
+		/*--------------------------------------------------*/
 
-		else  {
+		if (due != 0) {
+		   acquire_sample(&sample,due,stream != (FILE *)NULL && stream == bin_stream ? (FILE *)NULL : output_stream(record_stream(stream)));
+		   sink_publish(&sample);
+		}
 
-			uv_index = Si1132_readUV()/100.0;
-			vis      = Si1132_readVisible()/100.0;
-			ir       = Si1132_readIR()/100.0;
 
-			if (WBVersion == 2) {
+		/*-------------------------------*/
+		/* Arm timer for the next update */
+		/*-------------------------------*/
 
-                                bme280_read_pressure_temperature_humidity( &ipressure, &itemperature, &ihumidity);
+	        (void)scheduler_arm(&sampler);
 
-				temperature = (double)itemperature / 100.0;
-				humidity    = (double)ihumidity    / 1024.0;
-				pressure    = (double)ipressure    / 100.0 + 10.0;
-			} else {
-				temperature = (BMP180_readTemperature() + Si702x_readTemperature()) / 2.0;
-				humidity    = Si702x_readHumidity();
-				pressure    = BMP180_readPressure();
-				altitude    = BMP180_readAltitude(SEALEVELPRESSURE_HPA);
 
-			}
+		/*-------------------------*/
+		/* Do we need to rollover? */
+		/*-------------------------*/
 
+		if (stream != (FILE *)NULL) {
+		   if (do_rollover_enabled == TRUE) {
+		      if (rollsecs != (-1)) {
+		         nowsecs = (time_t)tstamp_daysecs(vclock_now());
 
-			/*----------------------------------------------------------------*/
-			/* See Lawerence et al. 2005 for details of dew point calculation */
-			/*----------------------------------------------------------------*/
+		         if (nowsecs >= rollsecs && nowsecs < rollsecs + (tick_period + 999) / 1000) {
+		            if (rolled == FALSE)
+		               do_rollover = TRUE;
 
-			dew_point   = temperature -((100.0 - humidity) / 5.0);
+		            rolled = TRUE;
+		         } else
+		            rolled = FALSE;
+		      }
+		      else if (vclock_time() - nowsecs >= rperiod) {
+		         nowsecs     = vclock_time();
+		         do_rollover = TRUE;
+		      }
+		   }
 
-			if (datasink(1) == FALSE) {
-                           (void)fprintf(stdout,"%s  uvi: %8.2f  vis: %8.2f lux  ir: %8.2f lux  temp: %8.2f C  humidity: %8.2f %%  dew point %8.2f C  pressure: %8.2f hpa\n",
-                                                                                                                                                                 datetimeStr,
-                                                                                                                                                                    uv_index,
-                                                                                                                                                                         vis,
-                                                                                                                                                                          ir,
-                                                                                                                                                                 temperature,
-                                                                                                                                                                    humidity,
-                                                                                                                                                                   dew_point,
-                                                                                                                                                                    pressure);
 
-                           (void)fflush(stdout);
-			}
+		   if (rotsize > 0 && log_bytes >= rotsize)
+		      do_rollover = TRUE;
 
 
-			/*-------------------------*/
-			/* Sleep until next update */
-			/*-------------------------*/
+		   /*---------------------------*/
+		   /* Are we going to rollover? */
+		   /*---------------------------*/
 
-		        (void)sleep(update_period);
+		   if (do_rollover == TRUE)
+		      stream = rollover_logfile(stream,eff_logfile_name);
 		}
-
 	}
 
 	exit(0);
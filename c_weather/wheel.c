@@ -0,0 +1,193 @@
+/*---------------------------------------------
+ * Weatherboard timer wheel
+ *-------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include "wheel.h"
+
+
+
+
+/*-----------------------------------------*/
+/* Insert task into the slot of its expiry */
+/*-----------------------------------------*/
+
+static void insert(wheel_t *w, wheel_task_t *task)
+{
+	unsigned int s = (unsigned int)(task->expiry % WHEEL_SLOTS);
+
+	task->next = w->slot[s];
+	w->slot[s] = task;
+}
+
+
+
+
+/*---------------------------------------------*/
+/* First multiple of period at or after tick t */
+/*---------------------------------------------*/
+
+static long long align(long long t, long long period)
+{
+	return(((t + period - 1) / period) * period);
+}
+
+
+
+
+/*--------------------------------------------*/
+/* Initialise wheel, tick is the first (next) */
+/* tick to be processed                       */
+/*--------------------------------------------*/
+
+void wheel_init(wheel_t *w, long long tick)
+{
+	(void)memset((void *)w,0,sizeof(wheel_t));
+
+	w->tick = tick;
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Add task id (0..31) expiring every period    */
+/* ticks. Returns -1 if the wheel is full or id */
+/* is out of range                              */
+/*----------------------------------------------*/
+
+int wheel_add(wheel_t *w, unsigned int id, long long period)
+{
+	wheel_task_t *task = (wheel_task_t *)NULL;
+
+	if (w->n_tasks == WHEEL_MAX_TASKS || id >= 32 || period < 1)
+		return(-1);
+
+	task         = &w->task[w->n_tasks++];
+	task->id     = id;
+	task->period = period;
+	task->expiry = align(w->tick,period);
+
+	insert(w,task);
+	return(0);
+}
+
+
+
+
+/*-----------------------------------------------*/
+/* Change period of task id. Its next expiry is  */
+/* the first multiple of the new period not yet  */
+/* passed. Returns -1 if there is no such task   */
+/*-----------------------------------------------*/
+
+int wheel_set(wheel_t *w, unsigned int id, long long period)
+{
+	unsigned int i;
+	wheel_task_t *task = (wheel_task_t *)NULL,
+	             **p   = (wheel_task_t **)NULL;
+
+	if (period < 1)
+		return(-1);
+
+	for (i=0; i<w->n_tasks; ++i) {
+		if (w->task[i].id == id)
+			break;
+	}
+
+	if (i == w->n_tasks)
+		return(-1);
+
+	task = &w->task[i];
+	for (p = &w->slot[task->expiry % WHEEL_SLOTS]; *p != task; p = &(*p)->next)
+		;
+
+	*p           = task->next;
+	task->period = period;
+	task->expiry = align(w->tick,period);
+
+	insert(w,task);
+	return(0);
+}
+
+
+
+
+/*----------------------------------------------*/
+/* Advance wheel through tick. Returns bit mask */
+/* of the task ids which expired on the way     */
+/*----------------------------------------------*/
+
+unsigned int wheel_advance(wheel_t *w, long long tick)
+{
+	unsigned int s,
+	             i,
+	             due   = 0;
+	wheel_task_t *task = (wheel_task_t *)NULL,
+	             **p   = (wheel_task_t **)NULL;
+
+
+	/*--------------------------------------------*/
+	/* Far behind (a long overrun) - rather than  */
+	/* spin round the wheel, fire anything which  */
+	/* expired once and rehash from the next tick */
+	/*--------------------------------------------*/
+
+	if (tick - w->tick >= WHEEL_SLOTS) {
+		(void)memset((void *)w->slot,0,sizeof(w->slot));
+
+		for (i=0; i<w->n_tasks; ++i) {
+			task = &w->task[i];
+
+			if (task->expiry <= tick) {
+				due          |= 1U << task->id;
+				task->expiry  = align(tick + 1,task->period);
+			}
+
+			insert(w,task);
+		}
+
+		w->tick = tick + 1;
+		return(due);
+	}
+
+	for (; w->tick<=tick; ++w->tick) {
+		s = (unsigned int)(w->tick % WHEEL_SLOTS);
+		p = &w->slot[s];
+
+		while ((task = *p) != (wheel_task_t *)NULL) {
+			if (task->expiry != w->tick) {
+				p = &task->next;
+				continue;
+			}
+
+			*p            = task->next;
+			due          |= 1U << task->id;
+			task->expiry += task->period;
+			insert(w,task);
+		}
+	}
+
+	return(due);
+}
+
+
+
+
+/*-------------------------*/
+/* Greatest common divisor */
+/*-------------------------*/
+
+long long wheel_gcd(long long a, long long b)
+{
+	long long r;
+
+	while (b != 0) {
+		r = a % b;
+		a = b;
+		b = r;
+	}
+
+	return(a);
+}
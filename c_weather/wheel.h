@@ -0,0 +1,58 @@
+#ifndef __WHEEL_H__
+#define __WHEEL_H__
+
+/*---------------------------------------------
+ * Weatherboard timer wheel
+ *
+ * Hashed timer wheel driving per sensor
+ * acquisition tasks. Time is in ticks since
+ * the epoch, each task expiring on multiples
+ * of its own period (so tasks stay aligned to
+ * the wall clock). Advancing the wheel by a
+ * tick only visits one slot.
+ *-------------------------------------------*/
+
+
+/*-------------*/
+/* Definitions */
+/*-------------*/
+
+#define WHEEL_SLOTS            64
+#define WHEEL_MAX_TASKS        32
+
+
+/*------*/
+/* Task */
+/*------*/
+
+typedef struct wheel_task_s {
+	unsigned int        id;
+	long long           period;       // Ticks
+	long long           expiry;       // Absolute tick
+	struct wheel_task_s *next;
+} wheel_task_t;
+
+
+/*-------*/
+/* Wheel */
+/*-------*/
+
+typedef struct {
+	long long    tick;
+	unsigned int n_tasks;
+	wheel_task_t task[WHEEL_MAX_TASKS];
+	wheel_task_t *slot[WHEEL_SLOTS];
+} wheel_t;
+
+
+/*---------------------*/
+/* Function prototypes */
+/*---------------------*/
+
+extern void         wheel_init   (wheel_t *w, long long tick);
+extern int          wheel_add    (wheel_t *w, unsigned int id, long long period);
+extern int          wheel_set    (wheel_t *w, unsigned int id, long long period);
+extern unsigned int wheel_advance(wheel_t *w, long long tick);
+extern long long    wheel_gcd    (long long a, long long b);
+
+#endif //__WHEEL_H__